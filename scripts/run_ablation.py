@@ -11,6 +11,19 @@ is unique per run).
 
 Usage: python scripts/run_ablation.py
 
+With --bench every driver runs in benchmark mode (per-epoch wall_s, cpu_s,
+samples_per_s and elapsed_s columns in its results CSV). Each ablations.csv row
+then also gets its training time, throughput, time to the dataset's target
+accuracy (BENCH_TARGETS, or --target ACC for all) and accuracy per second, and
+experiments/bench_summary.csv ranks the configurations of each dataset by time
+to target (viz/plot_bench.py plots both).
+
+With --halving the grid is instead run by the C successive-halving scheduler
+(src/main_sweep.c): every configuration trains for a short budget, only the
+top 1/eta (ranked on held-out accuracy) continue from their in-memory state,
+and the rows land in the same experiments/ablations.csv (plus an 'epochs'
+column recording how far each configuration got).
+
 Requires gcc to be available on PATH and python3.
 """
 import os
@@ -38,6 +51,12 @@ datasets = [
     ('mnist', SRC / 'main_mnist.c'),
 ]
 
+# --bench: accuracy each configuration has to reach (first epoch at or above it);
+# test_acc is used when the log has one (MNIST), else the logged acc
+BENCH_TARGETS = {'xor': 1.0, 'spirals': 0.95, 'mnist': 0.95}
+BENCH_FIELDS = ['train_s', 'cpu_s', 'samples_per_s', 'target_acc', 'time_to_target_s',
+                'epochs_to_target', 'acc_per_s']
+
 act_choices = ['POLY_CUBIC', 'PRELU', 'SWISH', 'PIECEWISE', 'FIXED_RELU']
 strat_choices = ['ACT_INIT_DEFAULT', 'ACT_INIT_RANDOM_SMALL', 'ACT_INIT_NOISY']
 
@@ -84,15 +103,15 @@ def patch_main_for_config(src_path, act_choice, strat_choice, out_log_name):
 
 def compile_main(temp_path, out_exe):
     # Build compile command similar to earlier invocations
-    srcs = ['utils.c', 'config.c', 'activations.c', 'layer.c', 'network.c', 'data.c', 'optimizer.c']
+    srcs = ['utils.c', 'mem.c', 'rng.c', 'config.c', 'activations.c', 'layer.c', 'conv.c', 'network.c', 'data.c', 'optimizer.c', 'quant.c', 'sweep.c', 'async_eval.c', 'infer.c', 'tune.c', 'prune.c', 'fold.c', 'synth.c', 'hogwild.c', 'dist.c', 'pipeline.c', 'finetune.c', 'bench.c', 'tiny.c']
     srcs = [str(SRC / s) for s in srcs] + [str(temp_path)]
-    cmd = ['gcc', '-I', str(SRC), '-std=c99', '-O2'] + srcs + ['-o', str(out_exe), '-lm']
+    cmd = ['gcc', '-I', str(SRC), '-std=c99', '-O2'] + srcs + ['-o', str(out_exe), '-lm', '-pthread']
     print('Compiling:', ' '.join(cmd))
     subprocess.run(cmd, check=True)
 
-def run_exe(exe_path):
+def run_exe(exe_path, args=()):
     print('Running:', exe_path)
-    subprocess.run([str(exe_path)], check=True)
+    subprocess.run([str(exe_path)] + list(args), check=True)
 
 def read_final_metrics(log_csv):
     p = Path(log_csv)
@@ -117,12 +136,107 @@ def append_ablation_row(out_csv, row):
             w.writerow(['dataset', 'act_hidden', 'act_init', 'seed', 'final_loss', 'final_acc', 'logfile'])
         w.writerow(row)
 
+def bench_metrics(log_csv, target):
+    """Timing summary of one benchmark-mode results CSV (None without timings)."""
+    p = Path(log_csv)
+    if not p.is_absolute():
+        p = ROOT / p
+    if not p.exists():
+        return None
+    with p.open() as f:
+        rows = list(csv.DictReader(f))
+    if not rows or 'elapsed_s' not in rows[0]:
+        return None
+
+    def acc_of(r):
+        t = r.get('test_acc', '')
+        if t not in ('', None) and t.lower() != 'nan':
+            return float(t)
+        return float(r['acc'])
+
+    train_s = float(rows[-1]['elapsed_s'])
+    cpu_s = sum(float(r['cpu_s']) for r in rows)
+    samples = sum(float(r['samples_per_s']) * float(r['wall_s']) for r in rows)
+    hit = next((i for i, r in enumerate(rows) if acc_of(r) >= target), None)
+    final_acc = acc_of(rows[-1])
+    return {
+        'train_s': f'{train_s:.6f}',
+        'cpu_s': f'{cpu_s:.6f}',
+        'samples_per_s': f'{samples / train_s:.1f}' if train_s > 0 else '',
+        'target_acc': target,
+        'time_to_target_s': f"{float(rows[hit]['elapsed_s']):.6f}" if hit is not None else '',
+        'epochs_to_target': hit + 1 if hit is not None else '',
+        'acc_per_s': f'{final_acc / train_s:.6f}' if train_s > 0 else '',
+    }
+
+def add_bench_columns(out_csv, target_override=None):
+    """Append the BENCH_FIELDS to every ablations.csv row and write
+    experiments/bench_summary.csv: per dataset, configurations that reached the
+    target first (fastest first), then the rest by accuracy per second."""
+    if not Path(out_csv).exists():
+        return
+    with open(out_csv, newline='') as f:
+        reader = csv.DictReader(f)
+        header = list(reader.fieldnames)
+        rows = list(reader)
+    for r in rows:
+        target = target_override if target_override is not None else BENCH_TARGETS.get(r['dataset'], 0.95)
+        m = bench_metrics(r['logfile'], target) or {k: '' for k in BENCH_FIELDS}
+        r.update(m)
+    with open(out_csv, 'w', newline='') as f:
+        w = csv.DictWriter(f, fieldnames=header + BENCH_FIELDS)
+        w.writeheader()
+        w.writerows(rows)
+
+    def key(r):
+        ttt = r['time_to_target_s']
+        aps = float(r['acc_per_s']) if r['acc_per_s'] != '' else 0.0
+        return (r['dataset'], ttt == '', float(ttt) if ttt != '' else 0.0, -aps)
+
+    summary = ROOT / 'experiments' / 'bench_summary.csv'
+    cols = ['dataset', 'rank', 'act_hidden', 'act_init', 'target_acc', 'time_to_target_s', 'epochs_to_target',
+            'final_acc', 'train_s', 'samples_per_s', 'acc_per_s']
+    with open(summary, 'w', newline='') as f:
+        w = csv.writer(f)
+        w.writerow(cols)
+        rank, prev = 0, None
+        for r in sorted(rows, key=key):
+            rank = rank + 1 if r['dataset'] == prev else 1
+            prev = r['dataset']
+            w.writerow([r['dataset'], rank] + [r[c] for c in cols[2:]])
+            if rank <= 3:
+                ttt = f"{float(r['time_to_target_s']):.4g} s" if r['time_to_target_s'] else 'not reached'
+                print(f"[BENCH] {r['dataset']} #{rank}: {r['act_hidden']}/{r['act_init']} "
+                      f"target {r['target_acc']} in {ttt}, final acc {float(r['final_acc']):.4f}")
+    print('Wrote', summary)
+
+def run_halving(include_mnist, dry_run, bench=False):
+    """Successive-halving sweep: one in-process scheduler run per dataset."""
+    exe = OBJ / 'sweep.exe'
+    if dry_run:
+        print('  [dry-run] would compile', SRC / 'main_sweep.c', 'and run it per dataset')
+        return
+    compile_main(SRC / 'main_sweep.c', exe)
+    for ds_name, _ in datasets:
+        if ds_name == 'mnist' and not include_mnist:
+            print('Skipping MNIST (use --include-mnist to enable)')
+            continue
+        try:
+            subprocess.run([str(exe), ds_name] + (['--bench'] if bench else []), check=True, cwd=str(ROOT))
+        except subprocess.CalledProcessError:
+            print('Sweep failed for', ds_name)
+
 def main():
     out_csv = ROOT / 'experiments' / 'ablations.csv'
     seed = 42
     # CLI flags
     dry_run = '--dry-run' in sys.argv
     include_mnist = '--include-mnist' in sys.argv or '--all' in sys.argv
+    halving = '--halving' in sys.argv
+    bench = '--bench' in sys.argv
+    target = None
+    if '--target' in sys.argv:
+        target = float(sys.argv[sys.argv.index('--target') + 1])
 
     # Clear previous outputs so every run replaces old files
     print('Cleaning previous results in', RESULTS)
@@ -141,8 +255,10 @@ def main():
 
     if dry_run:
         print('Dry-run mode: no compilation or execution will be performed.')
+    if halving:
+        run_halving(include_mnist, dry_run, bench)
     # Keep runs small for tests (limit combinations)
-    for ds_name, main_path in datasets:
+    for ds_name, main_path in ([] if halving else datasets):
         # optionally skip MNIST unless explicitly requested
         if ds_name == 'mnist' and not include_mnist:
             print('Skipping MNIST (use --include-mnist to enable)')
@@ -169,7 +285,7 @@ def main():
                     continue
                 # run
                 try:
-                    run_exe(exe)
+                    run_exe(exe, ['--bench'] if bench else [])
                 except subprocess.CalledProcessError:
                     print('Run failed for', exp_name)
                     continue
@@ -187,6 +303,9 @@ def main():
         print('\nDry-run complete. To actually run experiments and generate plots, re-run without --dry-run')
         return
 
+    if bench:
+        add_bench_columns(out_csv, target)
+
     print('\nGenerating visualizations by calling viz/run_all_plots.py')
     try:
         subprocess.run([sys.executable, str(ROOT / 'viz' / 'run_all_plots.py')], check=True)
@@ -74,7 +74,7 @@ int check_activation(ActType t, int dim)
 
 int main()
 {
-    srand(123);
+    srand_seed(123);
     int ok = 1;
     ok &= check_activation(PRELU, 8);
     ok &= check_activation(POLY_CUBIC, 8);
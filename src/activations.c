@@ -1,5 +1,6 @@
 #include "activations.h"
 #include "config.h"
+#include <string.h>
 
 Activation init_act(ActType t, int dim, ActInitStrategy strat)
 {
@@ -8,8 +9,10 @@ Activation init_act(ActType t, int dim, ActInitStrategy strat)
     a.n_params = 0;
     a.params = NULL;
     a.grad_act = NULL;
-    a.z = alloc_matrix(1024, dim); // Preallocate for common case
-    a.out = alloc_matrix(1024, dim);
+    /* z/out are sized on first use (act_reserve) to the batch actually run */
+    a.z.rows = a.out.rows = 0;
+    a.z.cols = a.out.cols = dim;
+    a.z.data = a.out.data = NULL;
     switch (t)
     {
     case PRELU:
@@ -27,8 +30,8 @@ Activation init_act(ActType t, int dim, ActInitStrategy strat)
     }
     if (a.n_params > 0)
     {
-        a.params = malloc(a.n_params * sizeof(mat_t));
-        a.grad_act = calloc(a.n_params, sizeof(mat_t)); // Zero grads
+        a.params = mem_alloc(a.n_params * sizeof(mat_t), MEM_WEIGHTS);
+        a.grad_act = mem_calloc(a.n_params, sizeof(mat_t), MEM_GRADS); // Zero grads
         /* Type-specific initialization strategies. Support multiple
            strategies via 'strat' so experiments can compare inits.
         */
@@ -104,40 +107,31 @@ Activation init_act(ActType t, int dim, ActInitStrategy strat)
 void free_act(Activation *a) {
     free_matrix(a->z);
     free_matrix(a->out);
-    free(a->params);
-    free(a->grad_act);  // Free grads
+    mem_free(a->params);
+    mem_free(a->grad_act);  // Free grads
 }
 
-void act_forward(Activation *a, Matrix in)
+void act_eval(ActType type, const mat_t *params, const mat_t *zs, mat_t *out, int n)
 {
-    // Ensure buffers are large enough for this batch
-    if (in.rows > a->z.rows || in.cols != a->z.cols) {
-        free_matrix(a->z);
-        free_matrix(a->out);
-        a->z = alloc_matrix(in.rows, in.cols);
-        a->out = alloc_matrix(in.rows, in.cols);
-    }
-    copy_matrix(a->z, in); // copy top rows
-    int n = in.rows * in.cols; // elements in current batch
-    switch (a->type)
+    switch (type)
     {
     case PRELU:
     {
-        mat_t alpha = a->params[0];
+        mat_t alpha = params[0];
         for (int i = 0; i < n; ++i)
         {
-            mat_t z = a->z.data[i];
-            a->out.data[i] = (z >= 0 ? z : alpha * z);
+            mat_t z = zs[i];
+            out[i] = (z >= 0 ? z : alpha * z);
         }
         break;
     }
     case POLY_CUBIC:
     {
-        mat_t a0 = a->params[0], a1 = a->params[1], a2 = a->params[2], a3 = a->params[3];
+        mat_t a0 = params[0], a1 = params[1], a2 = params[2], a3 = params[3];
         for (int i = 0; i < n; ++i)
         {
-            mat_t z = a->z.data[i], z2 = z * z, z3 = z2 * z;
-            a->out.data[i] = a0 + a1 * z + a2 * z2 + a3 * z3;
+            mat_t z = zs[i], z2 = z * z, z3 = z2 * z;
+            out[i] = a0 + a1 * z + a2 * z2 + a3 * z3;
         }
         break;
     }
@@ -147,18 +141,18 @@ void act_forward(Activation *a, Matrix in)
            Derived taus: tau0 = p0; tau1 = p0 + exp(p1); tau2 = tau1 + exp(p2)
            This guarantees tau0 < tau1 < tau2 (strictly) and keeps learnable raw params.
         */
-        mat_t p0 = a->params[0];
-        mat_t p1 = a->params[1];
-        mat_t p2 = a->params[2];
+        mat_t p0 = params[0];
+        mat_t p1 = params[1];
+        mat_t p2 = params[2];
         mat_t tau0 = p0;
         mat_t tau1 = p0 + exp(p1);
         mat_t tau2 = tau1 + exp(p2);
         mat_t taus[3] = {tau0, tau1, tau2};
-        mat_t slopes[4] = {a->params[3], a->params[4], a->params[5], a->params[6]};
+        mat_t slopes[4] = {params[3], params[4], params[5], params[6]};
         mat_t B = ACT_Z_CLIP_B; // Bound for z (configurable)
         for (int i = 0; i < n; ++i)
         {
-            mat_t z = fmin(B, fmax(-B, a->z.data[i])); // Clip
+            mat_t z = fmin(B, fmax(-B, zs[i])); // Clip
             int seg = 0;
             if (z > taus[0])
                 seg = 1;
@@ -170,37 +164,117 @@ void act_forward(Activation *a, Matrix in)
             mat_t c = 0.0;
             for (int m = 0; m < seg; ++m)
                 c += (slopes[m] - slopes[m + 1]) * taus[m];
-            a->out.data[i] = slopes[seg] * z + c;
+            out[i] = slopes[seg] * z + c;
         }
         break;
     }
     case SWISH:
     {
-        mat_t beta = a->params[0];
+        mat_t beta = params[0];
         for (int i = 0; i < n; ++i)
         {
-            mat_t z = a->z.data[i], bz = beta * z;
-            a->out.data[i] = z * sigmoid(bz);
+            mat_t z = zs[i], bz = beta * z;
+            out[i] = z * sigmoid(bz);
         }
         break;
     }
     case FIXED_RELU:
     {
         for (int i = 0; i < n; ++i)
-            a->out.data[i] = fmax(0, a->z.data[i]);
+            out[i] = fmax(0, zs[i]);
         break;
     }
     case FIXED_SIG:
     {
         for (int i = 0; i < n; ++i)
-            a->out.data[i] = sigmoid(a->z.data[i]);
+            out[i] = sigmoid(zs[i]);
         break;
     }
     }
-    // Caller will copy a->out into the layer output buffer.
+}
+
+void act_reserve(Activation *a, int rows, int cols)
+{
+    if (rows <= a->z.rows && cols == a->z.cols)
+        return;
+    free_matrix(a->z);
+    free_matrix(a->out);
+    a->z = alloc_matrix_tag(rows, cols, MEM_CACHE);
+    a->out = alloc_matrix_tag(rows, cols, MEM_CACHE);
+}
+
+void act_forward(Activation *a, Matrix in)
+{
+    /* Layers compute z straight into a->z (after act_reserve); only foreign
+       inputs are copied in. */
+    if (in.data != a->z.data)
+    {
+        act_reserve(a, in.rows, in.cols);
+        copy_matrix(a->z, in); // copy top rows
+    }
+    int n = in.rows * in.cols; // elements in current batch
+    act_eval(a->type, a->params, a->z.data, a->out.data, n);
 }
 
 void act_backward(Activation *a, Matrix delta_out, Matrix delta_z)
+{
+    act_backward_z(a, a->z.data, delta_out, delta_z);
+}
+
+/* PIECEWISE param grads of one element in segment seg: df/dtau_m into grad_tau
+   (mapped to p0..p2 by piecewise_grad_p), df/ds_k straight into grad_act */
+static void piecewise_accum(Activation *a, const mat_t *taus, const mat_t *slopes, int seg, mat_t z, mat_t d,
+                            mat_t *grad_tau)
+{
+    /* df/dtau_m = (m < seg) ? (s_m - s_{m+1}) : 0 - accumulate into grad_tau */
+    for (int m = 0; m < 3; ++m)
+    {
+        if (m < seg)
+            grad_tau[m] += d * (slopes[m] - slopes[m + 1]);
+    }
+    /* grads for slopes: for k in [0..3] */
+    for (int k = 0; k < 4; ++k)
+    {
+        mat_t contrib = 0.0;
+        if (k == seg)
+            contrib += z;
+        mat_t left = 0.0, right = 0.0;
+        if (k < seg)
+            left = taus[k];
+        if ((k - 1) >= 0 && (k - 1) < seg)
+            right = taus[k - 1];
+        contrib += (left - right);
+        a->grad_act[3 + k] += d * contrib;
+    }
+}
+
+/* Map grad_tau -> grad w.r.t params p0,p1,p2 via chain rule:
+   tau0 = p0
+   tau1 = p0 + exp(p1)
+   tau2 = p0 + exp(p1) + exp(p2)
+   therefore:
+     dL/dp0 = dL/dtau0 + dL/dtau1 + dL/dtau2
+     dL/dp1 = exp(p1) * (dL/dtau1 + dL/dtau2)
+     dL/dp2 = exp(p2) * (dL/dtau2)
+*/
+static void piecewise_grad_p(Activation *a, mat_t p1, mat_t p2, const mat_t *grad_tau)
+{
+    a->grad_act[0] += grad_tau[0] + grad_tau[1] + grad_tau[2];
+    a->grad_act[1] += exp(p1) * (grad_tau[1] + grad_tau[2]);
+    a->grad_act[2] += exp(p2) * (grad_tau[2]);
+}
+
+// Derived PIECEWISE taus and slopes (parameterization in act_eval)
+static void piecewise_knots(const mat_t *params, mat_t *taus, mat_t *slopes)
+{
+    taus[0] = params[0];
+    taus[1] = params[0] + exp(params[1]);
+    taus[2] = taus[1] + exp(params[2]);
+    for (int k = 0; k < 4; ++k)
+        slopes[k] = params[3 + k];
+}
+
+void act_backward_z(Activation *a, const mat_t *zs, Matrix delta_out, Matrix delta_z)
 {
     int n = delta_out.rows * delta_out.cols;
     // First, delta_z = delta_out * df/dz
@@ -211,7 +285,7 @@ void act_backward(Activation *a, Matrix delta_out, Matrix delta_z)
         mat_t alpha = a->params[0];
         for (int i = 0; i < n; ++i)
         {
-            mat_t z = a->z.data[i];
+            mat_t z = zs[i];
             mat_t dfdz = (z >= 0 ? 1.0 : alpha);
             delta_z.data[i] = delta_out.data[i] * dfdz;
             // Grad alpha: accum (temp in params as grad; reset post-update)
@@ -224,7 +298,7 @@ void act_backward(Activation *a, Matrix delta_out, Matrix delta_z)
         mat_t a1 = a->params[1], a2 = a->params[2], a3 = a->params[3];
         for (int i = 0; i < n; ++i)
         {
-            mat_t z = a->z.data[i], z2 = z * z;
+            mat_t z = zs[i], z2 = z * z;
             mat_t dfdz = a1 + 2 * a2 * z + 3 * a3 * z2;
             delta_z.data[i] = delta_out.data[i] * dfdz;
             // Grads: ∂L/∂a_i += delta_out * z^i
@@ -251,9 +325,10 @@ void act_backward(Activation *a, Matrix delta_out, Matrix delta_z)
         mat_t slopes[4] = {a->params[3], a->params[4], a->params[5], a->params[6]};
         /* Accumulators for grads wrt taus (to be mapped to p afterwards) */
         mat_t grad_tau[3] = {0.0, 0.0, 0.0};
+        mat_t B = ACT_Z_CLIP_B;
         for (int i = 0; i < n; ++i)
         {
-            mat_t z = a->z.data[i];
+            mat_t z = fmin(B, fmax(-B, zs[i])); // the z act_eval used (segment and slope grads)
             int seg = 0;
             if (z > taus[0])
                 seg = 1;
@@ -263,39 +338,9 @@ void act_backward(Activation *a, Matrix delta_out, Matrix delta_z)
                 seg = 3;
             /* df/dz */
             delta_z.data[i] = delta_out.data[i] * slopes[seg];
-            /* df/dtau_m = (m < seg) ? (s_m - s_{m+1}) : 0 - accumulate into grad_tau */
-            for (int m = 0; m < 3; ++m)
-            {
-                if (m < seg)
-                    grad_tau[m] += delta_out.data[i] * (slopes[m] - slopes[m + 1]);
-            }
-            /* grads for slopes: for k in [0..3] */
-            for (int k = 0; k < 4; ++k)
-            {
-                mat_t contrib = 0.0;
-                if (k == seg)
-                    contrib += z;
-                mat_t left = 0.0, right = 0.0;
-                if (k < seg)
-                    left = taus[k];
-                if ((k - 1) >= 0 && (k - 1) < seg)
-                    right = taus[k - 1];
-                contrib += (left - right);
-                a->grad_act[3 + k] += delta_out.data[i] * contrib;
-            }
+            piecewise_accum(a, taus, slopes, seg, z, delta_out.data[i], grad_tau);
         }
-        /* Map grad_tau -> grad w.r.t params p0,p1,p2 via chain rule:
-           tau0 = p0
-           tau1 = p0 + exp(p1)
-           tau2 = p0 + exp(p1) + exp(p2)
-           therefore:
-             dL/dp0 = dL/dtau0 + dL/dtau1 + dL/dtau2
-             dL/dp1 = exp(p1) * (dL/dtau1 + dL/dtau2)
-             dL/dp2 = exp(p2) * (dL/dtau2)
-        */
-        a->grad_act[0] += grad_tau[0] + grad_tau[1] + grad_tau[2];
-        a->grad_act[1] += exp(p1) * (grad_tau[1] + grad_tau[2]);
-        a->grad_act[2] += exp(p2) * (grad_tau[2]);
+        piecewise_grad_p(a, p1, p2, grad_tau);
         break;
     }
     case SWISH:
@@ -303,7 +348,7 @@ void act_backward(Activation *a, Matrix delta_out, Matrix delta_z)
         mat_t beta = a->params[0];
         for (int i = 0; i < n; ++i)
         {
-            mat_t z = a->z.data[i];
+            mat_t z = zs[i];
             mat_t bz = beta * z;
             mat_t s = sigmoid(bz);
             mat_t s_prime = s * (1 - s);
@@ -320,7 +365,7 @@ void act_backward(Activation *a, Matrix delta_out, Matrix delta_z)
     {
         for (int i = 0; i < n; ++i)
         {
-            mat_t z = a->z.data[i];
+            mat_t z = zs[i];
             delta_z.data[i] = delta_out.data[i] * (z > 0 ? 1.0 : 0.0);
         }
         break;
@@ -329,7 +374,7 @@ void act_backward(Activation *a, Matrix delta_out, Matrix delta_z)
     {
         for (int i = 0; i < n; ++i)
         {
-            delta_z.data[i] = delta_out.data[i] * sigmoid_deriv(a->z.data[i]);
+            delta_z.data[i] = delta_out.data[i] * sigmoid_deriv(zs[i]);
         }
         break;
     }
@@ -337,6 +382,110 @@ void act_backward(Activation *a, Matrix delta_out, Matrix delta_z)
     // Note: a->grad_act now holds accumulated gradients for params; optimizer will apply updates.
 }
 
+int act_mask_bits(const Activation *a)
+{
+    switch (a->type)
+    {
+    case FIXED_RELU:
+        return 1;
+    case PRELU:
+        return fabs(a->params[0]) >= ACT_MASK_MIN_SCALE ? 1 : 0; // negative z is recovered as out / alpha
+    case PIECEWISE:
+        for (int k = 3; k < 7; ++k)
+            if (fabs(a->params[k]) < ACT_MASK_MIN_SCALE) // z = (out - c_seg) / s_seg
+                return 0;
+        return 2;
+    default:
+        return 0;
+    }
+}
+
+size_t act_mask_bytes(int bits, size_t n)
+{
+    return (n * bits + 7) / 8;
+}
+
+void act_pack_mask(const Activation *a, const mat_t *zs, unsigned char *mask, int n)
+{
+    if (a->type == PIECEWISE)
+    {
+        mat_t taus[3], slopes[4], B = ACT_Z_CLIP_B;
+        piecewise_knots(a->params, taus, slopes);
+        for (int i0 = 0; i0 < n; i0 += 4)
+        {
+            unsigned char byte = 0;
+            for (int j = 0; j < 4 && i0 + j < n; ++j)
+            {
+                mat_t z = fmin(B, fmax(-B, zs[i0 + j])); // the segment act_eval used
+                int seg = (z > taus[0]) + (z > taus[1]) + (z > taus[2]);
+                byte |= (unsigned char)(seg << (2 * j));
+            }
+            mask[i0 >> 2] = byte;
+        }
+        return;
+    }
+    for (int i0 = 0; i0 < n; i0 += 8)
+    {
+        unsigned char byte = 0;
+        for (int j = 0; j < 8 && i0 + j < n; ++j)
+        {
+            mat_t z = zs[i0 + j];
+            int bit = a->type == PRELU ? z >= 0 : z > 0; // df/dz == 1
+            byte |= (unsigned char)(bit << j);
+        }
+        mask[i0 >> 3] = byte;
+    }
+}
+
+void act_backward_mask(Activation *a, const unsigned char *mask, const mat_t *outs, Matrix delta_out, Matrix delta_z)
+{
+    int n = delta_out.rows * delta_out.cols;
+    switch (a->type)
+    {
+    case PRELU:
+    {
+        mat_t alpha = a->params[0];
+        for (int i = 0; i < n; ++i)
+        {
+            if ((mask[i >> 3] >> (i & 7)) & 1)
+            {
+                delta_z.data[i] = delta_out.data[i] * 1.0;
+                continue;
+            }
+            delta_z.data[i] = delta_out.data[i] * alpha;
+            a->grad_act[0] += delta_out.data[i] * (outs[i] / alpha); // out = alpha * z
+        }
+        break;
+    }
+    case PIECEWISE:
+    {
+        mat_t taus[3], slopes[4], c[4] = {0.0, 0.0, 0.0, 0.0};
+        piecewise_knots(a->params, taus, slopes);
+        for (int seg = 1; seg < 4; ++seg) // continuity constants, summed as in act_eval
+            for (int m = 0; m < seg; ++m)
+                c[seg] += (slopes[m] - slopes[m + 1]) * taus[m];
+        mat_t grad_tau[3] = {0.0, 0.0, 0.0};
+        for (int i = 0; i < n; ++i)
+        {
+            int seg = (mask[i >> 2] >> (2 * (i & 3))) & 3;
+            mat_t z = (outs[i] - c[seg]) / slopes[seg]; // clipped z, as act_eval saw it
+            delta_z.data[i] = delta_out.data[i] * slopes[seg];
+            piecewise_accum(a, taus, slopes, seg, z, delta_out.data[i], grad_tau);
+        }
+        piecewise_grad_p(a, a->params[1], a->params[2], grad_tau);
+        break;
+    }
+    case FIXED_RELU:
+    {
+        for (int i = 0; i < n; ++i)
+            delta_z.data[i] = delta_out.data[i] * (((mask[i >> 3] >> (i & 7)) & 1) ? 1.0 : 0.0);
+        break;
+    }
+    default:
+        break; // act_mask_bits is 0: never packed
+    }
+}
+
 // Helper: return pointer to params and count
 mat_t *act_get_params(Activation *a) { return a->params; }
 
@@ -362,4 +511,41 @@ mat_t act_reg(Activation *a, mat_t lambda)
     }
     // Similar for others...
     return reg;
-}
\ No newline at end of file
+}
+
+const char *act_type_name(ActType t)
+{
+    switch (t)
+    {
+    case PRELU: return "PRELU";
+    case POLY_CUBIC: return "POLY_CUBIC";
+    case PIECEWISE: return "PIECEWISE";
+    case SWISH: return "SWISH";
+    case FIXED_RELU: return "FIXED_RELU";
+    case FIXED_SIG: return "FIXED_SIG";
+    }
+    return "UNKNOWN";
+}
+
+int act_type_from_name(const char *s, ActType *t)
+{
+    for (int i = PRELU; i <= FIXED_SIG; ++i)
+        if (strcmp(s, act_type_name((ActType)i)) == 0)
+        {
+            *t = (ActType)i;
+            return 1;
+        }
+    return 0;
+}
+
+const char *act_init_name(ActInitStrategy s)
+{
+    switch (s)
+    {
+    case ACT_INIT_DEFAULT: return "ACT_INIT_DEFAULT";
+    case ACT_INIT_NOISY: return "ACT_INIT_NOISY";
+    case ACT_INIT_RANDOM_SMALL: return "ACT_INIT_RANDOM_SMALL";
+    case ACT_INIT_IDENTITY: return "ACT_INIT_IDENTITY";
+    }
+    return "UNKNOWN";
+}
@@ -34,11 +34,31 @@ typedef enum {
 Activation init_act(ActType t, int dim, ActInitStrategy strat); // dim for alloc
 void free_act(Activation *a);
 
-// Forward: in -> out
+// Forward: in -> out. in may be a view of a->z (computed in place, no copy)
 void act_forward(Activation *a, Matrix in);
 
+// Make z/out hold at least rows x cols (contents are not kept when they grow)
+void act_reserve(Activation *a, int rows, int cols);
+
+// Stateless forward of n values (no caches); shared by act_forward and inference paths
+void act_eval(ActType type, const mat_t *params, const mat_t *zs, mat_t *out, int n);
+
 // Backward: delta_out -> delta_in, update act grads (via a->grad_act)
 void act_backward(Activation *a, Matrix delta_out, Matrix delta_z);
+// Same, with the pre-activations read from zs instead of a->z (e.g. a decompressed stash)
+void act_backward_z(Activation *a, const mat_t *zs, Matrix delta_out, Matrix delta_z);
+
+/* Bit-packed z for backward (ACT_STASH_MASK): bits per element of the code
+   act_pack_mask writes - 1 for FIXED_RELU / PRELU (z's side of 0), 2 for
+   PIECEWISE (segment of the clipped z) - or 0 when the type (or an alpha /
+   slope below ACT_MASK_MIN_SCALE, where z recovered by dividing by it loses too
+   many bits) cannot run backward from the code and the forward output alone */
+#define ACT_MASK_MIN_SCALE 1e-3
+int act_mask_bits(const Activation *a);
+size_t act_mask_bytes(int bits, size_t n);
+void act_pack_mask(const Activation *a, const mat_t *zs, unsigned char *mask, int n);
+// act_backward_z from the code and the act outputs (z = out / alpha, (out - c) / s)
+void act_backward_mask(Activation *a, const unsigned char *mask, const mat_t *outs, Matrix delta_out, Matrix delta_z);
 
 // Reg term (for loss)
 mat_t act_reg(Activation *a, mat_t lambda);
@@ -47,4 +67,10 @@ mat_t act_reg(Activation *a, mat_t lambda);
 mat_t *act_get_params(Activation *a);
 int act_get_nparams(Activation *a);
 
+// Enum names as written in logs and CSVs ("PRELU", "ACT_INIT_NOISY", ...)
+const char *act_type_name(ActType t);
+// Inverse of act_type_name; returns 0 for an unknown name
+int act_type_from_name(const char *s, ActType *t);
+const char *act_init_name(ActInitStrategy s);
+
 // #endif
\ No newline at end of file
@@ -0,0 +1,183 @@
+#include "async_eval.h"
+#include "config.h"
+#include <math.h>
+#include <string.h>
+
+static void *eval_worker(void *arg)
+{
+    AsyncEval *ev = arg;
+    pthread_mutex_lock(&ev->mu);
+    for (;;)
+    {
+        while (ev->staged_epoch < 0 && !ev->stop)
+            pthread_cond_wait(&ev->cv, &ev->mu);
+        if (ev->staged_epoch < 0)
+            break; // stopped with nothing pending
+        int epoch = ev->staged_epoch;
+        net_set_params(&ev->net, ev->staged);
+        ev->staged_epoch = -1; // slot free for the next epoch
+        ev->busy = 1;
+        pthread_cond_broadcast(&ev->cv);
+        pthread_mutex_unlock(&ev->mu);
+
+        mat_t acc = eval_acc(&ev->net, ev->x, ev->y); // own clone: own caches
+
+        pthread_mutex_lock(&ev->mu);
+        ev->test_acc[epoch] = acc;
+        ev->busy = 0;
+        pthread_cond_broadcast(&ev->cv);
+    }
+    pthread_mutex_unlock(&ev->mu);
+    return NULL;
+}
+
+static void write_row(AsyncEval *ev, AsyncEvalRow *r, mat_t test_acc)
+{
+    FILE *f = fopen(ev->logfile, "a");
+    if (!f)
+    {
+        fprintf(stderr, "Failed to open %s\n", ev->logfile);
+        return;
+    }
+    fprintf(f, "%d,%.6f,%.6f,%.6f", r->epoch, r->loss, r->acc, test_acc);
+    if (BENCH_LOG)
+        bench_csv_fields(f, &r->bench);
+    for (int i = 0; i < r->n_params; ++i)
+        fprintf(f, ",%.6f", r->params[i]);
+    fprintf(f, "\n");
+    fclose(f);
+}
+
+// Write queued rows, in order, as far as their test accuracy is known
+static void flush_rows(AsyncEval *ev)
+{
+    while (ev->next_row < ev->n_rows)
+    {
+        AsyncEvalRow *r = &ev->rows[ev->next_row];
+        pthread_mutex_lock(&ev->mu);
+        mat_t t = r->epoch < ev->cap ? ev->test_acc[r->epoch] : NAN;
+        pthread_mutex_unlock(&ev->mu);
+        if (isnan(t))
+            return;
+        write_row(ev, r, t);
+        free(r->params);
+        r->params = NULL;
+        ev->next_row++;
+    }
+}
+
+int async_eval_start(AsyncEval *ev, Network *net, Matrix x, Matrix y, const char *logfile,
+                     int n_names, const char **names)
+{
+    memset(ev, 0, sizeof(*ev));
+    ev->x = x;
+    ev->y = y;
+    ev->logfile = logfile;
+    ev->staged_epoch = -1;
+    ev->net = net_clone(net);
+    ev->n_params = net_param_count(net);
+    ev->staged = mem_alloc(ev->n_params * sizeof(mat_t), MEM_WEIGHTS); // snapshot of the params
+    FILE *f = fopen(logfile, "w");
+    if (!ev->staged || !f)
+    {
+        fprintf(stderr, "async_eval_start: cannot set up %s\n", logfile);
+        if (f)
+            fclose(f);
+        mem_free(ev->staged);
+        free_net(&ev->net);
+        return 0;
+    }
+    fprintf(f, "epoch,loss,acc,test_acc%s", BENCH_LOG ? BENCH_CSV_HEADER : "");
+    for (int i = 0; i < n_names; ++i)
+        fprintf(f, ",%s", names[i]);
+    fprintf(f, "\n");
+    fclose(f);
+    pthread_mutex_init(&ev->mu, NULL);
+    pthread_cond_init(&ev->cv, NULL);
+    if (pthread_create(&ev->thread, NULL, eval_worker, ev) != 0)
+    {
+        fprintf(stderr, "async_eval_start: pthread_create failed\n");
+        pthread_mutex_destroy(&ev->mu);
+        pthread_cond_destroy(&ev->cv);
+        mem_free(ev->staged);
+        free_net(&ev->net);
+        return 0;
+    }
+    return 1;
+}
+
+void async_eval_submit(AsyncEval *ev, Network *net, int epoch)
+{
+    pthread_mutex_lock(&ev->mu);
+    while (ev->staged_epoch >= 0)
+        pthread_cond_wait(&ev->cv, &ev->mu);
+    if (epoch >= ev->cap)
+    {
+        int cap = ev->cap ? ev->cap : 16;
+        while (cap <= epoch)
+            cap *= 2;
+        ev->test_acc = realloc(ev->test_acc, cap * sizeof(mat_t));
+        for (int i = ev->cap; i < cap; ++i)
+            ev->test_acc[i] = NAN;
+        ev->cap = cap;
+    }
+    net_get_params(net, ev->staged);
+    ev->staged_epoch = epoch;
+    pthread_cond_broadcast(&ev->cv);
+    pthread_mutex_unlock(&ev->mu);
+    flush_rows(ev);
+}
+
+void async_eval_log(AsyncEval *ev, int epoch, mat_t loss, mat_t acc, int n_params, mat_t *params)
+{
+    if (ev->n_rows == ev->rows_cap)
+    {
+        ev->rows_cap = ev->rows_cap ? 2 * ev->rows_cap : 16;
+        ev->rows = realloc(ev->rows, ev->rows_cap * sizeof(AsyncEvalRow));
+    }
+    AsyncEvalRow *r = &ev->rows[ev->n_rows++];
+    r->epoch = epoch;
+    r->loss = loss;
+    r->acc = acc;
+    r->bench = bench_last();
+    r->n_params = n_params;
+    r->params = NULL;
+    if (n_params > 0)
+    {
+        r->params = malloc(n_params * sizeof(mat_t));
+        memcpy(r->params, params, n_params * sizeof(mat_t));
+    }
+    flush_rows(ev);
+}
+
+mat_t async_eval_wait(AsyncEval *ev, int epoch)
+{
+    pthread_mutex_lock(&ev->mu);
+    while (epoch >= ev->cap || isnan(ev->test_acc[epoch]))
+        pthread_cond_wait(&ev->cv, &ev->mu);
+    mat_t acc = ev->test_acc[epoch];
+    pthread_mutex_unlock(&ev->mu);
+    return acc;
+}
+
+void async_eval_finish(AsyncEval *ev)
+{
+    pthread_mutex_lock(&ev->mu);
+    ev->stop = 1; // the worker still drains a staged snapshot first
+    pthread_cond_broadcast(&ev->cv);
+    pthread_mutex_unlock(&ev->mu);
+    pthread_join(ev->thread, NULL);
+    flush_rows(ev);
+    /* Rows for epochs never submitted are written without a test accuracy */
+    for (; ev->next_row < ev->n_rows; ev->next_row++)
+    {
+        write_row(ev, &ev->rows[ev->next_row], NAN);
+        free(ev->rows[ev->next_row].params);
+    }
+    pthread_mutex_destroy(&ev->mu);
+    pthread_cond_destroy(&ev->cv);
+    free(ev->rows);
+    free(ev->test_acc);
+    mem_free(ev->staged);
+    free_net(&ev->net);
+}
@@ -0,0 +1,59 @@
+#ifndef ASYNC_EVAL_H
+#define ASYNC_EVAL_H
+
+#include "network.h"
+#include "bench.h"
+#include <pthread.h>
+
+/* Test-set evaluation on a background thread. At an epoch boundary the
+   training loop hands over a snapshot of the params (one memcpy with flat
+   storage); the worker copies it into its own clone of the network, so its
+   forward passes never touch the training caches, and evaluates x/y while
+   training continues. Results CSV rows are queued by async_eval_log and
+   written in epoch order once their test accuracy is known. */
+typedef struct
+{
+    int epoch;
+    mat_t loss, acc;
+    BenchEpoch bench; // timings at async_eval_log (written with BENCH_LOG)
+    int n_params;
+    mat_t *params;
+} AsyncEvalRow;
+
+typedef struct
+{
+    Network net;     // worker-owned clone
+    Matrix x, y;     // test set (read-only while the worker runs)
+    size_t n_params;
+    mat_t *staged;   // snapshot slot handed to the worker
+    int staged_epoch; // -1: slot free
+    int busy, stop;
+    mat_t *test_acc; // per epoch, NaN until evaluated
+    int cap;
+    const char *logfile;
+    AsyncEvalRow *rows; // queued CSV rows, written in order from next_row
+    int n_rows, rows_cap, next_row;
+    pthread_t thread;
+    pthread_mutex_t mu;
+    pthread_cond_t cv;
+} AsyncEval;
+
+// Clone net and start the worker. logfile gets the header
+// epoch,loss,acc,test_acc[,bench fields],<names>. Returns 0 on failure.
+int async_eval_start(AsyncEval *ev, Network *net, Matrix x, Matrix y, const char *logfile,
+                     int n_names, const char **names);
+
+// Snapshot net's params for epoch. Returns immediately unless the previous
+// snapshot has not been picked up yet (worker more than an epoch behind).
+void async_eval_submit(AsyncEval *ev, Network *net, int epoch);
+
+// Queue a results row; it is written (with test_acc) once epoch is evaluated
+void async_eval_log(AsyncEval *ev, int epoch, mat_t loss, mat_t acc, int n_params, mat_t *params);
+
+// Block until epoch has been evaluated; returns its test accuracy
+mat_t async_eval_wait(AsyncEval *ev, int epoch);
+
+// Drain pending evaluations, write the remaining rows, stop the worker and free
+void async_eval_finish(AsyncEval *ev);
+
+#endif
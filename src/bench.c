@@ -0,0 +1,61 @@
+#include "bench.h"
+
+static BenchEpoch bench_prev; // what log_csv writes next
+
+void bench_init(BenchClock *c)
+{
+    c->wall0 = c->cpu0 = 0.0;
+    c->wall_p = c->cpu_p = 0.0;
+    c->cpu_total = 0.0;
+    c->samples = 0;
+    c->epochs = 0;
+    c->last.wall = c->last.cpu = c->last.samples_per_s = c->last.elapsed = 0.0;
+}
+
+void bench_epoch_begin(BenchClock *c)
+{
+    c->wall0 = wall_seconds();
+    c->cpu0 = cpu_seconds();
+}
+
+void bench_pause(BenchClock *c)
+{
+    c->wall_p = wall_seconds();
+    c->cpu_p = cpu_seconds();
+}
+
+void bench_resume(BenchClock *c)
+{
+    c->wall0 += wall_seconds() - c->wall_p;
+    c->cpu0 += cpu_seconds() - c->cpu_p;
+}
+
+void bench_epoch_end(BenchClock *c, long samples)
+{
+    BenchEpoch *b = &c->last;
+    b->wall = wall_seconds() - c->wall0;
+    b->cpu = cpu_seconds() - c->cpu0;
+    b->samples_per_s = b->wall > 0.0 ? samples / b->wall : 0.0;
+    b->elapsed += b->wall;
+    c->cpu_total += b->cpu;
+    c->samples += samples;
+    c->epochs++;
+    bench_prev = *b;
+}
+
+BenchEpoch bench_last(void)
+{
+    return bench_prev;
+}
+
+void bench_csv_fields(FILE *f, const BenchEpoch *b)
+{
+    fprintf(f, ",%.6f,%.6f,%.1f,%.6f", b->wall, b->cpu, b->samples_per_s, b->elapsed);
+}
+
+void bench_report(const BenchClock *c, const char *label)
+{
+    double t = c->last.elapsed;
+    printf("[BENCH] %s: %d epochs, %.4f s training wall, %.4f s CPU, %.0f samples/s\n", label, c->epochs, t,
+           c->cpu_total, t > 0.0 ? c->samples / t : 0.0);
+}
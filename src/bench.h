@@ -0,0 +1,54 @@
+#ifndef BENCH_H
+#define BENCH_H
+
+#include "utils.h"
+
+/* Benchmark mode (BENCH_LOG, --bench on the training drivers). Training loops
+   bracket each epoch with bench_epoch_begin / bench_epoch_end, and while
+   BENCH_LOG is on the results CSVs (log_csv, the async evaluator) carry
+       wall_s,cpu_s,samples_per_s,elapsed_s
+   right after acc / test_acc. elapsed_s sums the training time of the epochs
+   so far (evaluation and logging between epochs excluded), so the time to a
+   target accuracy can be read straight off a log (scripts/run_ablation.py
+   --bench). cpu_s is process CPU time and includes helper threads such as the
+   async evaluator and GEMM workers. */
+
+#define BENCH_CSV_HEADER ",wall_s,cpu_s,samples_per_s,elapsed_s"
+
+typedef struct
+{
+    double wall, cpu;     // seconds spent in the epoch
+    double samples_per_s; // rows trained / wall
+    double elapsed;       // training wall seconds up to the end of the epoch
+} BenchEpoch;
+
+typedef struct
+{
+    double wall0, cpu0; // start of the open epoch (moved forward by paused time)
+    double wall_p, cpu_p; // start of the open pause
+    double cpu_total;
+    long samples;
+    int epochs;
+    BenchEpoch last; // last closed epoch
+} BenchClock;
+
+void bench_init(BenchClock *c);
+void bench_epoch_begin(BenchClock *c);
+// Close the open epoch after training `samples` rows. Its timings are also
+// remembered as the row the next log_csv call writes.
+void bench_epoch_end(BenchClock *c, long samples);
+
+// Leave work inside an epoch out of its timings (e.g. per-batch train accuracy)
+void bench_pause(BenchClock *c);
+void bench_resume(BenchClock *c);
+
+// Timings of the most recently closed epoch (of any clock)
+BenchEpoch bench_last(void);
+
+// The BENCH_CSV_HEADER fields of b
+void bench_csv_fields(FILE *f, const BenchEpoch *b);
+
+// [BENCH] line: epochs, training wall/CPU seconds and mean samples/s
+void bench_report(const BenchClock *c, const char *label);
+
+#endif
@@ -6,6 +6,19 @@ mat_t ACT_PARAM_MAX = 10.0;
 mat_t ACT_Z_CLIP_B = 5.0;
 mat_t ACT_GRAD_CLIP_NORM = 1.0;
 mat_t GRAD_CLIP_NORM = 1.0;
+int NET_FLAT_STORAGE = 0;
+long ACT_MEM_BUDGET = 0;
+mat_t SPARSE_INPUT_DENSITY = 0.25;
+mat_t PRUNE_CSR_DENSITY = 0.3;
+int ACT_STASH_BF16 = 0;
+int ACT_STASH_MASK = 0;
+int MEM_LOG = 0;
+int BENCH_LOG = 0;
+long ACT_FT_MMAP_BYTES = 256L << 20;
+int GEMM_BLOCK_M = 64;
+int GEMM_BLOCK_K = 256;
+int GEMM_BLOCK_N = 256;
+int GEMM_THREADS = 1;
 
 void config_set_act_bounds(mat_t pmin, mat_t pmax)
 {
@@ -22,3 +35,56 @@ void config_set_act_grad_clip(mat_t norm)
 {
     ACT_GRAD_CLIP_NORM = norm;
 }
+
+void config_set_flat_storage(int on)
+{
+    NET_FLAT_STORAGE = on;
+}
+
+void config_set_act_mem_budget(long bytes)
+{
+    ACT_MEM_BUDGET = bytes;
+}
+
+void config_set_sparse_input_density(mat_t d)
+{
+    SPARSE_INPUT_DENSITY = d;
+}
+
+void config_set_prune_csr_density(mat_t d)
+{
+    PRUNE_CSR_DENSITY = d;
+}
+
+void config_set_act_stash_bf16(int on)
+{
+    ACT_STASH_BF16 = on;
+}
+
+void config_set_act_stash_mask(int on)
+{
+    ACT_STASH_MASK = on;
+}
+
+void config_set_gemm(int block_m, int block_k, int block_n, int threads)
+{
+    GEMM_BLOCK_M = block_m;
+    GEMM_BLOCK_K = block_k;
+    GEMM_BLOCK_N = block_n;
+    GEMM_THREADS = threads < 1 ? 1 : threads;
+}
+
+void config_set_mem_log(int on)
+{
+    MEM_LOG = on;
+}
+
+void config_set_bench_log(int on)
+{
+    BENCH_LOG = on;
+}
+
+void config_set_act_ft_mmap_bytes(long bytes)
+{
+    ACT_FT_MMAP_BYTES = bytes;
+}
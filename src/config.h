@@ -14,9 +14,66 @@ extern mat_t ACT_GRAD_CLIP_NORM;
 /* Global weight/bias gradient clipping (default) */
 extern mat_t GRAD_CLIP_NORM;
 
+/* Lay out all params/grads/optimizer state of a Network in contiguous
+   slabs (read by init_net; 0 = per-tensor mallocs, the default) */
+extern int NET_FLAT_STORAGE;
+
+/* Activation-memory budget in bytes for one training step (0 = unlimited).
+   train_step splits larger logical batches into micro-batches that fit and
+   accumulates their gradients before a single clip + update. */
+extern long ACT_MEM_BUDGET;
+
+/* Sparse-input fast path for the first layer: a batch whose fraction of
+   non-zeros is below this uses CSR kernels (0 = always dense) */
+extern mat_t SPARSE_INPUT_DENSITY;
+
+/* Pruned dense layers whose kept fraction of W is at or below this run their
+   products on a CSR copy of W (forward, input gradient, net_infer); 0 = never */
+extern mat_t PRUNE_CSR_DENSITY;
+
+/* Keep the backward stashes of dense layers (their input x and pre-activation
+   z) as bfloat16 instead of double: full-precision z/out then only exist in
+   two network-wide scratch buffers during the forward pass. Nets with conv
+   layers keep the full-precision path. 0 = off (default). */
+extern int ACT_STASH_BF16;
+
+/* Dense FIXED_RELU / PRELU / PIECEWISE layers keep only a bit-packed code of z
+   for backward (1-bit sign, 2-bit PIECEWISE segment) instead of act.z; z itself
+   goes to a shared scratch and the param grads recover it from act.out.
+   ACT_STASH_BF16 takes precedence. 0 = off (default). */
+extern int ACT_STASH_MASK;
+
+/* matmul tiling: rows x inner x cols of out per cache block (<= 0 = no
+   blocking along that dimension), and worker threads splitting the rows of
+   out (1 = single-threaded). Every layout sums each output in the same k
+   order, so results do not depend on these; tune.c picks them per machine. */
+extern int GEMM_BLOCK_M, GEMM_BLOCK_K, GEMM_BLOCK_N;
+extern int GEMM_THREADS;
+
+/* Print a [MEM] line (mem.c accounting) at every epoch boundary; default off */
+extern int MEM_LOG;
+
+/* Benchmark mode: per-epoch wall/CPU seconds, samples/s and elapsed training
+   time in the results CSVs (bench.h); default off */
+extern int BENCH_LOG;
+
+/* Activation-only fine-tuning (finetune.c): layer-0 pre-activation caches
+   larger than this many bytes go to a memory-mapped temp file instead of RAM */
+extern long ACT_FT_MMAP_BYTES;
+
 /* Utility to set these at runtime if desired */
 void config_set_act_bounds(mat_t pmin, mat_t pmax);
 void config_set_z_clip(mat_t B);
 void config_set_act_grad_clip(mat_t norm);
+void config_set_flat_storage(int on);
+void config_set_act_mem_budget(long bytes);
+void config_set_sparse_input_density(mat_t d);
+void config_set_prune_csr_density(mat_t d);
+void config_set_act_stash_bf16(int on);
+void config_set_act_stash_mask(int on);
+void config_set_gemm(int block_m, int block_k, int block_n, int threads);
+void config_set_mem_log(int on);
+void config_set_bench_log(int on);
+void config_set_act_ft_mmap_bytes(long bytes);
 
 #endif
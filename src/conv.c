@@ -0,0 +1,261 @@
+#include "conv.h"
+#include <string.h>
+
+// Output columns ox whose input column ox + kx - pad lies inside the image
+static void ox_range(const ConvShape *c, int kx, int *lo, int *hi)
+{
+    int off = kx - c->pad;
+    *lo = off < 0 ? -off : 0;
+    *hi = c->in_w - off;
+    if (*hi > c->conv_w)
+        *hi = c->conv_w;
+}
+
+/* One sample: z (out_c x conv_h x conv_w) = W * x + b.
+   For each output row and channel block the accumulator rows (block x conv_w)
+   stay in L1 while every input row is streamed once per kernel tap. */
+static void conv_direct(const ConvShape *c, const mat_t *x, const mat_t *W, const mat_t *bias, mat_t *z)
+{
+    int plane = c->conv_h * c->conv_w;
+    for (int co0 = 0; co0 < c->out_c; co0 += CONV_CO_BLOCK)
+    {
+        int nb = c->out_c - co0 < CONV_CO_BLOCK ? c->out_c - co0 : CONV_CO_BLOCK;
+        for (int oy = 0; oy < c->conv_h; ++oy)
+        {
+            for (int cb = 0; cb < nb; ++cb)
+            {
+                mat_t *row = z + (size_t)(co0 + cb) * plane + oy * c->conv_w;
+                for (int ox = 0; ox < c->conv_w; ++ox)
+                    row[ox] = bias[co0 + cb];
+            }
+            for (int ci = 0; ci < c->in_c; ++ci)
+            {
+                for (int ky = 0; ky < c->k; ++ky)
+                {
+                    int iy = oy + ky - c->pad;
+                    if (iy < 0 || iy >= c->in_h)
+                        continue;
+                    const mat_t *xrow = x + ((size_t)ci * c->in_h + iy) * c->in_w;
+                    for (int kx = 0; kx < c->k; ++kx)
+                    {
+                        int lo, hi, off = kx - c->pad;
+                        ox_range(c, kx, &lo, &hi);
+                        const mat_t *wrow = W + ((size_t)(ci * c->k + ky) * c->k + kx) * c->out_c + co0;
+                        for (int cb = 0; cb < nb; ++cb)
+                        {
+                            mat_t wv = wrow[cb];
+                            mat_t *row = z + (size_t)(co0 + cb) * plane + oy * c->conv_w;
+                            for (int ox = lo; ox < hi; ++ox)
+                                row[ox] += wv * xrow[ox + off];
+                        }
+                    }
+                }
+            }
+        }
+    }
+}
+
+// One sample: gW += x (*) dz (correlation), gb += sum of dz per channel
+static void conv_grad_w(const ConvShape *c, const mat_t *x, const mat_t *dz, mat_t *gW, mat_t *gb)
+{
+    int plane = c->conv_h * c->conv_w;
+    for (int co = 0; co < c->out_c; ++co)
+    {
+        mat_t s = 0.0;
+        for (int p = 0; p < plane; ++p)
+            s += dz[(size_t)co * plane + p];
+        gb[co] += s;
+    }
+    for (int co0 = 0; co0 < c->out_c; co0 += CONV_CO_BLOCK)
+    {
+        int nb = c->out_c - co0 < CONV_CO_BLOCK ? c->out_c - co0 : CONV_CO_BLOCK;
+        for (int oy = 0; oy < c->conv_h; ++oy)
+        {
+            for (int ci = 0; ci < c->in_c; ++ci)
+            {
+                for (int ky = 0; ky < c->k; ++ky)
+                {
+                    int iy = oy + ky - c->pad;
+                    if (iy < 0 || iy >= c->in_h)
+                        continue;
+                    const mat_t *xrow = x + ((size_t)ci * c->in_h + iy) * c->in_w;
+                    for (int kx = 0; kx < c->k; ++kx)
+                    {
+                        int lo, hi, off = kx - c->pad;
+                        ox_range(c, kx, &lo, &hi);
+                        mat_t *grow = gW + ((size_t)(ci * c->k + ky) * c->k + kx) * c->out_c + co0;
+                        for (int cb = 0; cb < nb; ++cb)
+                        {
+                            const mat_t *drow = dz + (size_t)(co0 + cb) * plane + oy * c->conv_w;
+                            mat_t s = 0.0;
+                            for (int ox = lo; ox < hi; ++ox)
+                                s += drow[ox] * xrow[ox + off];
+                            grow[cb] += s;
+                        }
+                    }
+                }
+            }
+        }
+    }
+}
+
+// One sample: dx = full correlation of dz with the flipped kernels (dx zeroed here)
+static void conv_grad_x(const ConvShape *c, const mat_t *dz, const mat_t *W, mat_t *dx)
+{
+    int plane = c->conv_h * c->conv_w;
+    memset(dx, 0, (size_t)c->in_c * c->in_h * c->in_w * sizeof(mat_t));
+    for (int co0 = 0; co0 < c->out_c; co0 += CONV_CO_BLOCK)
+    {
+        int nb = c->out_c - co0 < CONV_CO_BLOCK ? c->out_c - co0 : CONV_CO_BLOCK;
+        for (int oy = 0; oy < c->conv_h; ++oy)
+        {
+            for (int ci = 0; ci < c->in_c; ++ci)
+            {
+                for (int ky = 0; ky < c->k; ++ky)
+                {
+                    int iy = oy + ky - c->pad;
+                    if (iy < 0 || iy >= c->in_h)
+                        continue;
+                    mat_t *dxrow = dx + ((size_t)ci * c->in_h + iy) * c->in_w;
+                    for (int kx = 0; kx < c->k; ++kx)
+                    {
+                        int lo, hi, off = kx - c->pad;
+                        ox_range(c, kx, &lo, &hi);
+                        const mat_t *wrow = W + ((size_t)(ci * c->k + ky) * c->k + kx) * c->out_c + co0;
+                        for (int cb = 0; cb < nb; ++cb)
+                        {
+                            mat_t wv = wrow[cb];
+                            const mat_t *drow = dz + (size_t)(co0 + cb) * plane + oy * c->conv_w;
+                            for (int ox = lo; ox < hi; ++ox)
+                                dxrow[ox + off] += wv * drow[ox];
+                        }
+                    }
+                }
+            }
+        }
+    }
+}
+
+// One sample: max-pool a (out_c x conv_h x conv_w); idx (optional) receives base + argmax offsets
+static void max_pool(const ConvShape *c, const mat_t *a, mat_t *out, int *idx, int base)
+{
+    int plane = c->conv_h * c->conv_w, p = c->pool;
+    int o = 0;
+    for (int co = 0; co < c->out_c; ++co)
+    {
+        for (int py = 0; py < c->out_h; ++py)
+        {
+            for (int px = 0; px < c->out_w; ++px, ++o)
+            {
+                int best = co * plane + (py * p) * c->conv_w + px * p;
+                for (int dy = 0; dy < p; ++dy)
+                    for (int dx = 0; dx < p; ++dx)
+                    {
+                        int q = co * plane + (py * p + dy) * c->conv_w + px * p + dx;
+                        if (a[q] > a[best])
+                            best = q;
+                    }
+                out[o] = a[best];
+                if (idx)
+                    idx[o] = base + best;
+            }
+        }
+    }
+}
+
+Matrix conv_forward(Layer *l, Matrix x)
+{
+    const ConvShape *c = &l->conv;
+    int batch = x.rows;
+    int act_dim = c->out_c * c->conv_h * c->conv_w;
+    l->x_cache = x; // view, as for dense layers
+    act_reserve(&l->act, batch, act_dim);
+    Matrix z = {batch, act_dim, l->act.z.data};
+    for (int b = 0; b < batch; ++b)
+        conv_direct(c, x.data + (size_t)b * l->in_dim, l->W.data, l->b.data, z.data + (size_t)b * act_dim);
+    act_forward(&l->act, z); // learnable activation per feature-map element, in place
+    if (c->pool == 1)
+    {
+        Matrix out = {batch, l->out_dim, l->act.out.data};
+        return out;
+    }
+    if (l->pool_cap < batch * l->out_dim)
+    {
+        mem_free(l->pool_idx);
+        free_matrix(l->pool_out);
+        l->pool_cap = batch * l->out_dim;
+        l->pool_idx = mem_alloc(l->pool_cap * sizeof(int), MEM_CACHE);
+        l->pool_out = alloc_matrix_tag(batch, l->out_dim, MEM_CACHE);
+    }
+    for (int b = 0; b < batch; ++b)
+        max_pool(c, l->act.out.data + (size_t)b * act_dim, l->pool_out.data + (size_t)b * l->out_dim,
+                 l->pool_idx + (size_t)b * l->out_dim, b * act_dim);
+    Matrix out = {batch, l->out_dim, l->pool_out.data};
+    return out;
+}
+
+void conv_infer(const Layer *l, Matrix x, mat_t *z, Matrix out)
+{
+    const ConvShape *c = &l->conv;
+    int batch = x.rows;
+    size_t act_dim = (size_t)c->out_c * c->conv_h * c->conv_w;
+    for (int b = 0; b < batch; ++b)
+        conv_direct(c, x.data + (size_t)b * l->in_dim, l->W.data, l->b.data, z + b * act_dim);
+    act_eval(l->act.type, l->act.params, z, z, (int)(batch * act_dim));
+    if (c->pool == 1)
+    {
+        if (out.data != z)
+            memcpy(out.data, z, batch * act_dim * sizeof(mat_t));
+        return;
+    }
+    for (int b = 0; b < batch; ++b)
+        max_pool(c, z + b * act_dim, out.data + (size_t)b * l->out_dim, NULL, 0);
+}
+
+void conv_backward(Layer *l, Matrix delta_out, Matrix delta_in, mat_t gscale)
+{
+    const ConvShape *c = &l->conv;
+    int batch = delta_out.rows;
+    int act_dim = c->out_c * c->conv_h * c->conv_w;
+    // Route the pooled deltas back to the argmax positions
+    Matrix d_act = alloc_matrix(batch, act_dim);
+    if (c->pool == 1)
+    {
+        copy_matrix(d_act, delta_out);
+    }
+    else
+    {
+        memset(d_act.data, 0, (size_t)batch * act_dim * sizeof(mat_t));
+        for (int i = 0; i < batch * l->out_dim; ++i)
+            d_act.data[l->pool_idx[i]] += delta_out.data[i];
+    }
+    Matrix delta_z = alloc_matrix(batch, act_dim);
+    act_backward(&l->act, d_act, delta_z);
+
+    // grad_W / grad_b as batch means, like the dense layer (skipped when frozen)
+    Matrix gW = {0, 0, NULL}, gb = {0, 0, NULL};
+    if (!l->frozen)
+    {
+        gW = alloc_matrix(l->W.rows, l->W.cols);
+        gb = alloc_matrix(1, c->out_c);
+        mat_scale(gW, 0.0);
+        mat_scale(gb, 0.0);
+        for (int b = 0; b < batch; ++b)
+            conv_grad_w(c, l->x_cache.data + (size_t)b * l->in_dim, delta_z.data + (size_t)b * act_dim, gW.data,
+                        gb.data);
+        mat_scale(gW, gscale / batch);
+        mat_scale(gb, gscale / batch);
+        add_matrix(l->grad_W, gW);
+        add_matrix(l->grad_b, gb);
+    }
+
+    if (delta_in.data)
+    {
+        for (int b = 0; b < batch; ++b)
+            conv_grad_x(c, delta_z.data + (size_t)b * act_dim, l->W.data, delta_in.data + (size_t)b * l->in_dim);
+    }
+    free_matrix(gW);
+    free_matrix(gb);
+    free_matrix(delta_z);
+    free_matrix(d_act);
+}
@@ -0,0 +1,24 @@
+#ifndef CONV_H
+#define CONV_H
+
+#include "layer.h"
+
+/* Direct convolution kernels for LAYER_CONV layers (see ConvShape).
+   Output channels are processed in blocks of CONV_CO_BLOCK with one output
+   row of accumulators per channel, so each input row loaded for a (ci, ky)
+   pair is reused across the whole channel block while it sits in L1. */
+#define CONV_CO_BLOCK 8
+
+// Forward: x (batch x in_c*in_h*in_w) -> view of batch x out_c*out_h*out_w
+// (act.out, or pool_out when pooling); same view rules as layer_forward_view
+Matrix conv_forward(Layer *l, Matrix x);
+
+// Cache-free forward for inference: z is scratch of batch x out_c*conv_h*conv_w
+// (may equal out.data when pool == 1); touches no layer state
+void conv_infer(const Layer *l, Matrix x, mat_t *z, Matrix out);
+
+// Backward through pool, activation and convolution; grad_W/grad_b weighted by gscale / batch.
+// delta_in may have data == NULL (first layer).
+void conv_backward(Layer *l, Matrix delta_out, Matrix delta_in, mat_t gscale);
+
+#endif
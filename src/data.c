@@ -1,4 +1,5 @@
 #include "data.h"
+#include "rng.h"
 
 int load_data(const char *fname, Matrix *X, Matrix *Y)
 {
@@ -9,14 +10,21 @@ int load_data(const char *fname, Matrix *X, Matrix *Y)
     fread(&n, sizeof(int), 1, f);
     fread(&in_d, sizeof(int), 1, f);
     fread(&out_d, sizeof(int), 1, f);
-    *X = alloc_matrix(n, in_d);
-    *Y = alloc_matrix(n, out_d);
-    fread(X->data, sizeof(mat_t), n * in_d, f);
-    fread(Y->data, sizeof(mat_t), n * out_d, f);
+    *X = alloc_matrix_tag(n, in_d, MEM_DATA);
+    *Y = alloc_matrix_tag(n, out_d, MEM_DATA);
+    fread(X->data, sizeof(mat_t), (size_t)n * in_d, f);
+    fread(Y->data, sizeof(mat_t), (size_t)n * out_d, f);
     fclose(f);
     return 1;
 }
 
+mat_t data_density(Matrix X)
+{
+    if (X.rows * X.cols == 0)
+        return 0.0;
+    return (mat_t)mat_count_nonzero(X) / ((mat_t)X.rows * X.cols);
+}
+
 void gen_xor(Matrix *X, Matrix *Y)
 {
     *X = alloc_matrix(4, 2);
@@ -35,8 +43,9 @@ void gen_xor(Matrix *X, Matrix *Y)
     Y->data[3] = 0;
 }
 
-void gen_spirals(Matrix *X, Matrix *Y)
+void gen_spirals(Matrix *X, Matrix *Y, uint64_t stream)
 {
+    Rng rng = rng_stream(stream); // same points whatever was drawn before
     int per_class = 100;
     int n = per_class * 2;
     *X = alloc_matrix(n, 2);
@@ -46,14 +55,14 @@ void gen_spirals(Matrix *X, Matrix *Y)
         double r = (double)i / per_class * 5.0;
     double t = 1.75 * (double)i / per_class * 3.141592653589793;
         // class 0
-        (*X).data[i * 2 + 0] = r * cos(t) + ((double)rand() / RAND_MAX - 0.5) * 0.1;
-        (*X).data[i * 2 + 1] = r * sin(t) + ((double)rand() / RAND_MAX - 0.5) * 0.1;
+        (*X).data[i * 2 + 0] = r * cos(t) + (rng_uniform(&rng) - 0.5) * 0.1;
+        (*X).data[i * 2 + 1] = r * sin(t) + (rng_uniform(&rng) - 0.5) * 0.1;
         (*Y).data[i] = 0.0;
         // class 1
     int j = i + per_class;
     double t2 = t + 3.141592653589793;
-        (*X).data[j * 2 + 0] = r * cos(t2) + ((double)rand() / RAND_MAX - 0.5) * 0.1;
-        (*X).data[j * 2 + 1] = r * sin(t2) + ((double)rand() / RAND_MAX - 0.5) * 0.1;
+        (*X).data[j * 2 + 0] = r * cos(t2) + (rng_uniform(&rng) - 0.5) * 0.1;
+        (*X).data[j * 2 + 1] = r * sin(t2) + (rng_uniform(&rng) - 0.5) * 0.1;
         (*Y).data[j] = 1.0;
     }
 }
\ No newline at end of file
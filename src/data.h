@@ -2,13 +2,19 @@
 #define DATA_H
 
 #include "utils.h"
+#include "rng.h"
 
 // Load bin: header (int n_samples, in_dim, out_dim), then data
 int load_data(const char *fname, Matrix *X, Matrix *Y);
 
+// Fraction of non-zero entries (sparse-input path triggers below SPARSE_INPUT_DENSITY)
+mat_t data_density(Matrix X);
+
 // Gen XOR: 4 samples, 2in 1out
 void gen_xor(Matrix *X, Matrix *Y);
-// Generate simple 2-spiral dataset with n=100 per class (default: 200 samples)
-void gen_spirals(Matrix *X, Matrix *Y);
+// Generate simple 2-spiral dataset with n=100 per class (default: 200 samples).
+// The noise comes from RNG stream `stream` (RNG_STREAM_DATA for training,
+// RNG_STREAM_DATA_VAL for a held-out set: same spirals, different noise)
+void gen_spirals(Matrix *X, Matrix *Y, uint64_t stream);
 
 #endif
\ No newline at end of file
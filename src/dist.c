@@ -0,0 +1,526 @@
+#define _POSIX_C_SOURCE 200809L
+#define _DEFAULT_SOURCE // MAP_ANONYMOUS
+#include "dist.h"
+#include <errno.h>
+#include <string.h>
+#ifndef _WIN32
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+static const char *dist_names[] = {"shm", "socket"};
+
+const char *dist_backend_name(DistBackend b)
+{
+    return b >= DIST_SHM && b <= DIST_SOCKET ? dist_names[b] : "unknown";
+}
+
+int dist_backend_from_name(const char *s, DistBackend *b)
+{
+    for (int i = 0; i <= DIST_SOCKET; ++i)
+        if (strcmp(s, dist_names[i]) == 0)
+        {
+            *b = (DistBackend)i;
+            return 1;
+        }
+    return 0;
+}
+
+void dist_shard(int rows, int rank, int world, int *start, int *count)
+{
+    int lo = (int)((long)rows * rank / world), hi = (int)((long)rows * (rank + 1) / world);
+    *start = lo;
+    *count = hi - lo;
+}
+
+/* ---- ring all-reduce ---- */
+
+static void chunk_range(size_t n, int world, int k, size_t *lo, size_t *cnt)
+{
+    *lo = n * k / world;
+    *cnt = n * (k + 1) / world - *lo;
+}
+
+/* Chunk k of the buffer belongs to rank k - 1 after the reduce-scatter. Steps
+   go in pieces of DIST_PIECE_BYTES, send before receive: a piece never fills
+   a ring edge on its own, and the ranks cannot all block in send at once (at
+   most one unreceived piece per rank is in flight), so the ring cannot deadlock. */
+int dist_allreduce_sum(DistTransport *t, mat_t *buf, size_t n, mat_t *tmp)
+{
+    int P = t->world, r = t->rank;
+    size_t piece = DIST_PIECE_BYTES / sizeof(mat_t);
+    for (int phase = 0; phase < 2 && P > 1; ++phase)
+        for (int s = 0; s < P - 1; ++s)
+        {
+            /* reduce-scatter: send chunk r - s, add chunk r - s - 1 from the left;
+               all-gather: pass on the finished chunk r + 1 - s, take chunk r - s */
+            int ks = ((phase == 0 ? r - s : r + 1 - s) % P + P) % P;
+            int kr = ((phase == 0 ? r - s - 1 : r - s) % P + P) % P;
+            size_t slo, sn, rlo, rn;
+            chunk_range(n, P, ks, &slo, &sn);
+            chunk_range(n, P, kr, &rlo, &rn);
+            for (size_t off = 0; off < sn || off < rn; off += piece)
+            {
+                if (off < sn)
+                {
+                    size_t m = sn - off < piece ? sn - off : piece;
+                    if (!t->send_next(t, buf + slo + off, m * sizeof(mat_t)))
+                        return 0;
+                }
+                if (off < rn)
+                {
+                    size_t m = rn - off < piece ? rn - off : piece;
+                    mat_t *dst = buf + rlo + off;
+                    if (!t->recv_prev(t, phase == 0 ? tmp : dst, m * sizeof(mat_t)))
+                        return 0;
+                    if (phase == 0)
+                        for (size_t i = 0; i < m; ++i)
+                            dst[i] += tmp[i];
+                }
+            }
+        }
+    return 1;
+}
+
+/* ---- trainer: per-layer reduction on a comm thread ---- */
+
+static void *comm_worker(void *arg)
+{
+    DistTrainer *d = arg;
+    pthread_mutex_lock(&d->mu);
+    for (;;)
+    {
+        while (d->q_done == d->q_len && !d->stop)
+            pthread_cond_wait(&d->cv, &d->mu);
+        if (d->q_done == d->q_len)
+            break;
+        DistSegment seg = d->queue[d->q_done];
+        pthread_mutex_unlock(&d->mu);
+
+        double t0 = wall_seconds();
+        int ok = dist_allreduce_sum(d->t, seg.p, seg.n, d->tmp);
+        double dt = wall_seconds() - t0;
+
+        pthread_mutex_lock(&d->mu);
+        d->comm_seconds += dt;
+        d->failed |= !ok;
+        d->q_done++;
+        pthread_cond_broadcast(&d->cv);
+    }
+    pthread_mutex_unlock(&d->mu);
+    return NULL;
+}
+
+static void enqueue(DistTrainer *d, mat_t *p, size_t n)
+{
+    pthread_mutex_lock(&d->mu);
+    d->queue[d->q_len++] = (DistSegment){p, n};
+    pthread_cond_broadcast(&d->cv);
+    pthread_mutex_unlock(&d->mu);
+}
+
+// Layer i's grad_W and grad_b are final: weight them by this rank's share of the
+// global batch (grads are slice means) and hand the span to the comm thread
+static void grad_ready(void *ctx, int layer)
+{
+    DistTrainer *d = ctx;
+    Layer *l = &d->net->layers[layer];
+    mat_t *p = l->grad_W.data;
+    size_t n = (size_t)(l->grad_b.data + (size_t)l->grad_b.rows * l->grad_b.cols - p); // W then b in the slab
+    for (size_t i = 0; i < n; ++i)
+        p[i] *= d->weight;
+    enqueue(d, p, n);
+}
+
+void dist_trainer_init(DistTrainer *d, DistTransport *t, Network *net)
+{
+    if (!net->flat)
+    {
+        fprintf(stderr, "dist: needs flat storage (config_set_flat_storage(1) before init_net)\n");
+        exit(1);
+    }
+    memset(d, 0, sizeof(*d));
+    d->t = t;
+    d->net = net;
+    d->q_cap = net->n_layers + 2; // layers, act region, loss
+    d->queue = malloc(d->q_cap * sizeof(DistSegment));
+    d->tmp = malloc(DIST_PIECE_BYTES);
+    if (!d->queue || !d->tmp)
+    {
+        fprintf(stderr, "Alloc fail\n");
+        exit(1);
+    }
+    pthread_mutex_init(&d->mu, NULL);
+    pthread_cond_init(&d->cv, NULL);
+    if (pthread_create(&d->thread, NULL, comm_worker, d) != 0)
+    {
+        fprintf(stderr, "dist: failed to start the comm thread\n");
+        exit(1);
+    }
+    net->grad_ready = grad_ready;
+    net->grad_ready_ctx = d;
+}
+
+void dist_trainer_free(DistTrainer *d)
+{
+    pthread_mutex_lock(&d->mu);
+    d->stop = 1;
+    pthread_cond_broadcast(&d->cv);
+    pthread_mutex_unlock(&d->mu);
+    pthread_join(d->thread, NULL);
+    d->net->grad_ready = NULL;
+    d->net->grad_ready_ctx = NULL;
+    pthread_mutex_destroy(&d->mu);
+    pthread_cond_destroy(&d->cv);
+    free(d->queue);
+    free(d->tmp);
+    d->queue = NULL;
+    d->tmp = NULL;
+}
+
+static void wait_comm(DistTrainer *d)
+{
+    pthread_mutex_lock(&d->mu);
+    while (d->q_done < d->q_len)
+        pthread_cond_wait(&d->cv, &d->mu);
+    int failed = d->failed;
+    pthread_mutex_unlock(&d->mu);
+    if (failed)
+    {
+        fprintf(stderr, "dist: rank %d lost its ring peers\n", d->t->rank);
+        exit(1);
+    }
+}
+
+mat_t dist_train_step(DistTrainer *d, Matrix x, Matrix y, SGD *opt, int is_ce, int global_rows)
+{
+    Network *net = d->net;
+    d->weight = (mat_t)x.rows / global_rows;
+    pthread_mutex_lock(&d->mu);
+    d->q_len = d->q_done = 0;
+    pthread_mutex_unlock(&d->mu);
+
+    mat_t loss[1] = {0.0};
+    if (x.rows > 0)
+        loss[0] = net_compute_grads(net, x, y, is_ce) * d->weight;
+    else
+        for (int i = net->n_layers - 1; i >= 0; --i)
+            grad_ready(d, i); // empty slice: still take part in every reduction
+    // Act grads are batch sums: summed as they are, after the dense layers
+    if (net->n_total > net->n_dense)
+        enqueue(d, net->grads + net->n_dense, net->n_total - net->n_dense);
+    enqueue(d, loss, 1);
+    double t0 = wall_seconds();
+    wait_comm(d);
+    d->wait_seconds += wall_seconds() - t0;
+
+    // Identical grads on every rank from here: train_step's reg, clip and update
+    mat_t reg = 0.0;
+    for (int i = 0; i < net->n_layers; ++i)
+        reg += act_reg(&net->layers[i].act, 1e-4);
+    net_clip_grads(net);
+    net_apply_update(net, opt);
+    mat_t total = loss[0] + reg;
+    if (isnan(total) || isinf(total))
+    {
+        fprintf(stderr, "Invalid loss in dist_train_step (rank %d): %f\n", d->t->rank, total);
+        exit(1);
+    }
+    return total;
+}
+
+/* ---- transports ---- */
+
+#ifndef _WIN32
+
+typedef struct
+{
+    pthread_mutex_t mu;
+    pthread_cond_t cv;
+    size_t head, tail; // bytes written / read so far
+    unsigned char data[DIST_SHM_RING_BYTES];
+} ShmRing;
+
+typedef struct
+{
+    ShmRing *rings; // world rings in a shared mapping; ring k carries rank k -> k + 1
+    size_t map_bytes;
+} ShmImpl;
+
+static int shm_send(DistTransport *t, const void *buf, size_t n)
+{
+    ShmRing *q = &((ShmImpl *)t->impl)->rings[t->rank];
+    const unsigned char *src = buf;
+    pthread_mutex_lock(&q->mu);
+    while (n > 0)
+    {
+        while (q->head - q->tail == DIST_SHM_RING_BYTES)
+            pthread_cond_wait(&q->cv, &q->mu);
+        size_t pos = q->head % DIST_SHM_RING_BYTES;
+        size_t k = DIST_SHM_RING_BYTES - (q->head - q->tail); // free bytes
+        k = k < DIST_SHM_RING_BYTES - pos ? k : DIST_SHM_RING_BYTES - pos;
+        k = k < n ? k : n;
+        memcpy(q->data + pos, src, k);
+        q->head += k;
+        src += k;
+        n -= k;
+        pthread_cond_broadcast(&q->cv);
+    }
+    pthread_mutex_unlock(&q->mu);
+    return 1;
+}
+
+static int shm_recv(DistTransport *t, void *buf, size_t n)
+{
+    ShmRing *q = &((ShmImpl *)t->impl)->rings[(t->rank + t->world - 1) % t->world];
+    unsigned char *dst = buf;
+    pthread_mutex_lock(&q->mu);
+    while (n > 0)
+    {
+        while (q->head == q->tail)
+            pthread_cond_wait(&q->cv, &q->mu);
+        size_t pos = q->tail % DIST_SHM_RING_BYTES;
+        size_t k = q->head - q->tail;
+        k = k < DIST_SHM_RING_BYTES - pos ? k : DIST_SHM_RING_BYTES - pos;
+        k = k < n ? k : n;
+        memcpy(dst, q->data + pos, k);
+        q->tail += k;
+        dst += k;
+        n -= k;
+        pthread_cond_broadcast(&q->cv);
+    }
+    pthread_mutex_unlock(&q->mu);
+    return 1;
+}
+
+static void shm_close(DistTransport *t)
+{
+    ShmImpl *s = t->impl;
+    munmap(s->rings, s->map_bytes);
+    free(s);
+    free(t);
+}
+
+// Created before fork so every rank inherits the same mapping
+static ShmImpl *shm_create(int world)
+{
+    ShmImpl *s = malloc(sizeof(ShmImpl));
+    if (!s)
+        return NULL;
+    s->map_bytes = world * sizeof(ShmRing);
+    s->rings = mmap(NULL, s->map_bytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (s->rings == MAP_FAILED)
+    {
+        free(s);
+        return NULL;
+    }
+    pthread_mutexattr_t ma;
+    pthread_condattr_t ca;
+    pthread_mutexattr_init(&ma);
+    pthread_mutexattr_setpshared(&ma, PTHREAD_PROCESS_SHARED);
+    pthread_condattr_init(&ca);
+    pthread_condattr_setpshared(&ca, PTHREAD_PROCESS_SHARED);
+    for (int k = 0; k < world; ++k)
+    {
+        pthread_mutex_init(&s->rings[k].mu, &ma);
+        pthread_cond_init(&s->rings[k].cv, &ca);
+        s->rings[k].head = s->rings[k].tail = 0;
+    }
+    pthread_mutexattr_destroy(&ma);
+    pthread_condattr_destroy(&ca);
+    return s;
+}
+
+static DistTransport *shm_transport(ShmImpl *s, int rank, int world)
+{
+    DistTransport *t = malloc(sizeof(DistTransport));
+    if (!t)
+        return NULL;
+    *t = (DistTransport){rank, world, "shm", shm_send, shm_recv, shm_close, s};
+    return t;
+}
+
+typedef struct
+{
+    int send_fd, recv_fd;
+} FdImpl;
+
+static int fd_send(DistTransport *t, const void *buf, size_t n)
+{
+    const char *p = buf;
+    while (n > 0)
+    {
+        ssize_t k = write(((FdImpl *)t->impl)->send_fd, p, n);
+        if (k < 0 && errno == EINTR)
+            continue;
+        if (k <= 0)
+            return 0;
+        p += k;
+        n -= (size_t)k;
+    }
+    return 1;
+}
+
+static int fd_recv(DistTransport *t, void *buf, size_t n)
+{
+    char *p = buf;
+    while (n > 0)
+    {
+        ssize_t k = read(((FdImpl *)t->impl)->recv_fd, p, n);
+        if (k < 0 && errno == EINTR)
+            continue;
+        if (k <= 0)
+            return 0; // error or peer closed
+        p += k;
+        n -= (size_t)k;
+    }
+    return 1;
+}
+
+static void fd_close(DistTransport *t)
+{
+    FdImpl *f = t->impl;
+    close(f->send_fd);
+    if (f->recv_fd != f->send_fd)
+        close(f->recv_fd);
+    free(f);
+    free(t);
+}
+
+DistTransport *dist_fd_transport(int rank, int world, int send_fd, int recv_fd)
+{
+    DistTransport *t = malloc(sizeof(DistTransport));
+    FdImpl *f = malloc(sizeof(FdImpl));
+    if (!t || !f)
+    {
+        fprintf(stderr, "Alloc fail\n");
+        exit(1);
+    }
+    *f = (FdImpl){send_fd, recv_fd};
+    *t = (DistTransport){rank, world, "socket", fd_send, fd_recv, fd_close, f};
+    return t;
+}
+
+int dist_launch(int world, DistBackend backend, DistWorkerFn fn, void *arg)
+{
+    if (world < 1)
+        return 0;
+    ShmImpl *shm = NULL;
+    int(*fds)[2] = NULL; // fds[k]: ring edge k -> k + 1 ([0] written by k, [1] read by k + 1)
+    if (backend == DIST_SHM)
+    {
+        if (!(shm = shm_create(world)))
+        {
+            fprintf(stderr, "dist: shared mapping failed\n");
+            return 0;
+        }
+    }
+    else
+    {
+        fds = malloc(world * sizeof(*fds));
+        if (!fds)
+        {
+            fprintf(stderr, "Alloc fail\n");
+            exit(1);
+        }
+        for (int k = 0; k < world; ++k)
+            if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds[k]) != 0)
+            {
+                fprintf(stderr, "dist: socketpair failed: %s\n", strerror(errno));
+                return 0;
+            }
+    }
+    pid_t *pids = malloc(world * sizeof(pid_t));
+    if (!pids)
+    {
+        fprintf(stderr, "Alloc fail\n");
+        exit(1);
+    }
+    fflush(NULL); // children must not replay buffered output
+    int ok = 1, started = 0;
+    for (int r = 0; r < world && ok; ++r)
+    {
+        pid_t pid = fork();
+        if (pid == 0)
+        {
+            DistTransport *t;
+            if (shm)
+                t = shm_transport(shm, r, world);
+            else
+            {
+                int prev = (r + world - 1) % world;
+                for (int k = 0; k < world; ++k)
+                {
+                    if (k != r)
+                        close(fds[k][0]);
+                    if (k != prev)
+                        close(fds[k][1]);
+                }
+                t = dist_fd_transport(r, world, fds[r][0], fds[prev][1]);
+            }
+            int rc = t ? fn(t, arg) : 1;
+            if (t)
+                t->close(t);
+            exit(rc == 0 ? 0 : 1);
+        }
+        if (pid < 0)
+        {
+            fprintf(stderr, "dist: fork failed: %s\n", strerror(errno));
+            ok = 0;
+            break;
+        }
+        pids[started++] = pid;
+    }
+    if (!ok) // fork failed part way: the started ranks would wait on the ring forever
+        for (int i = 0; i < started; ++i)
+            kill(pids[i], SIGTERM);
+    if (fds)
+        for (int k = 0; k < world; ++k)
+        {
+            close(fds[k][0]);
+            close(fds[k][1]);
+        }
+    /* Reap; the first failure kills the rest (they would block on the ring) */
+    for (int left = started; left > 0; --left)
+    {
+        int status;
+        pid_t pid = wait(&status);
+        if (pid < 0)
+            break;
+        if (!WIFEXITED(status) || WEXITSTATUS(status) != 0)
+        {
+            if (ok && started == world)
+                for (int i = 0; i < started; ++i)
+                    if (pids[i] != pid)
+                        kill(pids[i], SIGTERM);
+            ok = 0;
+        }
+    }
+    free(pids);
+    free(fds);
+    if (shm)
+    {
+        munmap(shm->rings, shm->map_bytes);
+        free(shm);
+    }
+    return ok;
+}
+
+#else
+
+DistTransport *dist_fd_transport(int rank, int world, int send_fd, int recv_fd)
+{
+    fprintf(stderr, "dist: fd transports need POSIX\n");
+    return NULL;
+}
+
+int dist_launch(int world, DistBackend backend, DistWorkerFn fn, void *arg)
+{
+    fprintf(stderr, "dist: multi-process training needs POSIX (fork)\n");
+    return 0;
+}
+
+#endif
@@ -0,0 +1,99 @@
+#ifndef DIST_H
+#define DIST_H
+
+#include "network.h"
+#include <pthread.h>
+
+/* Multi-process data-parallel training. dist_launch forks `world` worker
+   processes joined in a ring by a transport. Every step each rank runs
+   forward/backward on its slice of the global batch, the grads are summed
+   with a ring all-reduce (reduce-scatter, then all-gather: each rank sends
+   2 (world - 1) / world of the grads) and every rank applies the same update,
+   so the replicas stay bit-identical. A comm thread reduces each layer's
+   grad_W / grad_b as soon as backward has produced them (Network.grad_ready),
+   overlapping with the backward of the layers below.
+
+   Transports are a small vtable: blocking byte send to rank + 1 and receive
+   from rank - 1. DIST_SHM uses byte rings in one MAP_SHARED mapping with
+   process-shared mutexes; DIST_SOCKET uses a stream fd per ring edge
+   (AF_UNIX socketpairs here; a TCP backend only has to connect the fds and
+   hand them to dist_fd_transport). Launching needs fork, so dist_launch
+   fails on Windows. */
+
+typedef struct DistTransport DistTransport;
+struct DistTransport
+{
+    int rank, world;
+    const char *name;
+    // Blocking; return 1 on success, 0 if the peer has gone away
+    int (*send_next)(DistTransport *t, const void *buf, size_t n);
+    int (*recv_prev)(DistTransport *t, void *buf, size_t n);
+    void (*close)(DistTransport *t); // also frees t
+    void *impl;
+};
+
+typedef enum
+{
+    DIST_SHM,
+    DIST_SOCKET
+} DistBackend;
+
+#define DIST_PIECE_BYTES (32 * 1024)    // ring step granularity; at most half a transport buffer
+#define DIST_SHM_RING_BYTES (64 * 1024) // per ring edge
+
+const char *dist_backend_name(DistBackend b);
+int dist_backend_from_name(const char *s, DistBackend *b);
+
+// Runs in every rank; returns 0 on success
+typedef int (*DistWorkerFn)(DistTransport *t, void *arg);
+
+// Fork world processes (ranks 0 .. world-1), run fn in each and wait for all;
+// a failing rank takes the others down. Returns 1 if every rank returned 0.
+int dist_launch(int world, DistBackend backend, DistWorkerFn fn, void *arg);
+
+// Stream-fd transport (socket, pipe, TCP connection): sends on send_fd to
+// rank + 1, receives on recv_fd from rank - 1; takes ownership of the fds
+DistTransport *dist_fd_transport(int rank, int world, int send_fd, int recv_fd);
+
+// In-place sum of buf[0..n) over all ranks (same n everywhere; results are
+// bit-identical on every rank). tmp holds DIST_PIECE_BYTES. Returns 1 on success.
+int dist_allreduce_sum(DistTransport *t, mat_t *buf, size_t n, mat_t *tmp);
+
+// Rows [*start, *start + *count) of a global batch of `rows` for rank
+void dist_shard(int rows, int rank, int world, int *start, int *count);
+
+typedef struct
+{
+    mat_t *p;
+    size_t n;
+} DistSegment;
+
+typedef struct
+{
+    DistTransport *t;
+    Network *net;
+    mat_t weight;         // this rank's rows / global rows, current step
+    DistSegment *queue;   // segments of the current step, reduced in order
+    int q_len, q_done, q_cap;
+    int stop, failed;
+    mat_t *tmp;
+    double comm_seconds;  // comm thread busy time (all-reduce)
+    double wait_seconds;  // train step blocked on comm after backward (exposed comm)
+    pthread_t thread;
+    pthread_mutex_t mu;
+    pthread_cond_t cv;
+} DistTrainer;
+
+// Installs the grad_ready hook and starts the comm thread (d must stay put
+// until dist_trainer_free); exits unless net uses flat storage. Every rank
+// must start from the same params.
+void dist_trainer_init(DistTrainer *d, DistTransport *t, Network *net);
+void dist_trainer_free(DistTrainer *d);
+
+// train_step across ranks: x/y are this rank's slice (dist_shard) of a global
+// batch of global_rows. Dense grads are averaged over the global batch and act
+// grads summed (they are batch sums), matching train_step on the whole batch.
+// Returns the global loss (identical on every rank).
+mat_t dist_train_step(DistTrainer *d, Matrix x, Matrix y, SGD *opt, int is_ce, int global_rows);
+
+#endif
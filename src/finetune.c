@@ -0,0 +1,201 @@
+#define _POSIX_C_SOURCE 200809L
+#include "finetune.h"
+#include "config.h"
+#include <math.h>
+#include <string.h>
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+#define FT_INIT_CHUNK 1024 // rows of X per layer-0 forward while filling the cache
+
+// File-backed cache: an anonymous temp file (gone once closed) mapped shared,
+// so the kernel can write cold pages back to it instead of keeping them in RAM
+static void *ft_map(size_t bytes)
+{
+#ifdef _WIN32
+    (void)bytes;
+    return NULL;
+#else
+    FILE *f = tmpfile();
+    if (!f)
+        return NULL;
+    void *p = NULL;
+    if (ftruncate(fileno(f), (off_t)bytes) == 0)
+    {
+        p = mmap(NULL, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fileno(f), 0);
+        if (p == MAP_FAILED)
+            p = NULL;
+    }
+    fclose(f); // the mapping keeps the file alive
+    return p;
+#endif
+}
+
+int finetune_init(Finetune *ft, Network *net, Matrix X)
+{
+    Layer *l0 = &net->layers[0];
+    if (l0->kind != LAYER_DENSE)
+        return 0;
+    size_t n = (size_t)X.rows * l0->out_dim;
+    ft->net = net;
+    ft->map = NULL;
+    ft->map_bytes = 0;
+    if (ACT_FT_MMAP_BYTES > 0 && n * sizeof(mat_t) > (size_t)ACT_FT_MMAP_BYTES)
+    {
+        ft->map = ft_map(n * sizeof(mat_t));
+        ft->map_bytes = ft->map ? n * sizeof(mat_t) : 0;
+    }
+    ft->z0.rows = X.rows;
+    ft->z0.cols = l0->out_dim;
+    ft->z0.data = ft->map ? ft->map : mem_alloc(n * sizeof(mat_t), MEM_CACHE);
+    if (!ft->z0.data)
+        return 0;
+    for (int start = 0; start < X.rows; start += FT_INIT_CHUNK)
+    {
+        int m = X.rows - start < FT_INIT_CHUNK ? X.rows - start : FT_INIT_CHUNK;
+        Matrix xc = {m, X.cols, X.data + (size_t)start * X.cols};
+        layer_forward_view(l0, xc); // z lands in act.z
+        memcpy(ft->z0.data + (size_t)start * l0->out_dim, l0->act.z.data, (size_t)m * l0->out_dim * sizeof(mat_t));
+    }
+    for (int i = 0; i < net->n_layers; ++i)
+        net->layers[i].frozen = 1;
+    return 1;
+}
+
+mat_t finetune_step(Finetune *ft, int start, Matrix y, SGD *opt, int is_ce)
+{
+    Network *net = ft->net;
+    Layer *l0 = &net->layers[0];
+    int m = y.rows, d0 = l0->out_dim;
+    const mat_t *z0 = ft->z0.data + (size_t)start * d0;
+
+    // Forward: layer 0 from the cached z, the rest as usual
+    act_reserve(&l0->act, m, d0);
+    act_eval(l0->act.type, l0->act.params, z0, l0->act.out.data, m * d0);
+    Matrix curr = {m, d0, l0->act.out.data};
+    for (int i = 1; i < net->n_layers; ++i)
+        curr = layer_forward_view(&net->layers[i], curr);
+    Matrix delta_out = alloc_matrix(curr.rows, curr.cols);
+    mat_t loss = is_ce ? loss_softmax_ce(curr, y, delta_out) : loss_mse(curr, y, delta_out);
+
+    // Backward: act grads and deltas only (frozen layers skip grad_W / grad_b)
+    int widest = 0;
+    for (int i = 1; i < net->n_layers; ++i)
+        widest = net->layers[i].in_dim > widest ? net->layers[i].in_dim : widest;
+    mat_t *buf[2] = {NULL, NULL};
+    if (net->n_layers > 1)
+    {
+        buf[0] = mem_alloc((size_t)m * widest * sizeof(mat_t), MEM_TEMP);
+        buf[1] = mem_alloc((size_t)m * widest * sizeof(mat_t), MEM_TEMP);
+    }
+    Matrix curr_delta = delta_out;
+    for (int i = net->n_layers - 1; i >= 1; --i)
+    {
+        Matrix prev_delta = {m, net->layers[i].in_dim, buf[i & 1]};
+        layer_backward(&net->layers[i], curr_delta, prev_delta);
+        curr_delta = prev_delta;
+    }
+    Matrix delta_z = alloc_matrix(m, d0);
+    act_backward_z(&l0->act, z0, curr_delta, delta_z);
+    free_matrix(delta_z);
+    mem_free(buf[0]);
+    mem_free(buf[1]);
+    free_matrix(delta_out);
+
+    // Reg and update, as in train_step (W/b have no grads to apply)
+    for (int i = 0; i < net->n_layers; ++i)
+        loss += act_reg(&net->layers[i].act, 1e-4);
+    for (int i = 0; i < net->n_layers; ++i)
+        sgd_update_act(&net->layers[i], opt);
+    if (isnan(loss) || isinf(loss))
+    {
+        fprintf(stderr, "Invalid loss in finetune_step: %f\n", loss);
+        exit(1);
+    }
+    return loss;
+}
+
+void finetune_free(Finetune *ft)
+{
+    for (int i = 0; i < ft->net->n_layers; ++i)
+        ft->net->layers[i].frozen = 0;
+#ifndef _WIN32
+    if (ft->map)
+        munmap(ft->map, ft->map_bytes);
+    else
+#endif
+        mem_free(ft->z0.data);
+    ft->z0.data = NULL;
+    ft->map = NULL;
+}
+
+void finetune_report(Network *net, ActType type, Matrix X, Matrix Y, Matrix X_test, Matrix Y_test,
+                     int epochs, int batch_size, SGD *opt)
+{
+    int n = net->n_layers;
+    ActType *acts = malloc(n * sizeof(ActType));
+    ActInitStrategy *strats = malloc(n * sizeof(ActInitStrategy));
+    if (!acts || !strats)
+    {
+        fprintf(stderr, "Alloc fail\n");
+        exit(1);
+    }
+    for (int i = 0; i < n; ++i)
+    {
+        acts[i] = i < n - 1 ? type : net->layers[i].act.type; // output layer keeps its act
+        strats[i] = ACT_INIT_DEFAULT;
+    }
+
+    // Baseline: one full train_step epoch on the swapped net (every param learns)
+    Network full = net_swap_acts(net, acts, strats);
+    double t0 = wall_seconds();
+    for (int start = 0; start < X.rows; start += batch_size)
+    {
+        int m = X.rows - start < batch_size ? X.rows - start : batch_size;
+        Matrix xb = {m, X.cols, X.data + (size_t)start * X.cols}, yb = {m, Y.cols, Y.data + (size_t)start * Y.cols};
+        train_step(&full, xb, yb, opt, 1);
+    }
+    double full_secs = wall_seconds() - t0;
+    free_net(&full);
+
+    Network ft_net = net_swap_acts(net, acts, strats);
+    printf("[FT] hidden acts -> %s: test accuracy %.4f before fine-tuning\n", act_type_name(type),
+           eval_acc(&ft_net, X_test, Y_test));
+    Finetune ft;
+    t0 = wall_seconds();
+    if (!finetune_init(&ft, &ft_net, X))
+    {
+        printf("[FT] skipped: layer 0 is not dense or the cache could not be allocated\n");
+        free_net(&ft_net);
+        free(acts);
+        free(strats);
+        return;
+    }
+    printf("[FT] layer-0 z cache: %d x %d (%.1f MB, %s), built in %.2f s\n", ft.z0.rows, ft.z0.cols,
+           (double)ft.z0.rows * ft.z0.cols * sizeof(mat_t) / (1 << 20), ft.map ? "mmap" : "RAM",
+           wall_seconds() - t0);
+    double ft_secs = 0.0;
+    for (int e = 0; e < epochs; ++e)
+    {
+        mat_t loss = 0.0;
+        t0 = wall_seconds();
+        for (int start = 0; start < X.rows; start += batch_size)
+        {
+            int m = X.rows - start < batch_size ? X.rows - start : batch_size;
+            Matrix yb = {m, Y.cols, Y.data + (size_t)start * Y.cols};
+            loss += finetune_step(&ft, start, yb, opt, 1) * m;
+        }
+        double secs = wall_seconds() - t0;
+        ft_secs += secs;
+        printf("[FT] epoch %d: loss %.4f, %.2f s\n", e, loss / X.rows, secs);
+    }
+    finetune_free(&ft);
+    printf("[FT] test accuracy %.4f after %d act-only epochs; %.2f s/epoch vs %.2f s for a train_step epoch (%.1fx)\n",
+           eval_acc(&ft_net, X_test, Y_test), epochs, ft_secs / epochs, full_secs,
+           full_secs / (ft_secs / epochs));
+    free_net(&ft_net);
+    free(acts);
+    free(strats);
+}
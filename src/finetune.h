@@ -0,0 +1,40 @@
+#ifndef FINETUNE_H
+#define FINETUNE_H
+
+#include "network.h"
+#include "optimizer.h"
+
+/* Activation-only fine-tuning: W and b of every layer are frozen and only the
+   activation params learn (e.g. after net_swap_acts replaced PRELU with
+   POLY_CUBIC). Layer 0's pre-activation z = x W0 + b0 then never changes, so
+   finetune_init computes it once for the whole dataset and each step starts
+   from the cached rows: no layer-0 GEMM forward, and no layer-0 backward past
+   its act grads. Later layers run the usual forward and propagate deltas
+   through W^T, but skip grad_W / grad_b (Layer.frozen). The cache lives in RAM,
+   or above ACT_FT_MMAP_BYTES in a memory-mapped temp file (POSIX) that the OS
+   pages in and out. */
+typedef struct
+{
+    Network *net;
+    Matrix z0;      // rows x layers[0].out_dim
+    void *map;      // mmap base when the cache is file-backed (NULL: MEM_CACHE)
+    size_t map_bytes;
+} Finetune;
+
+// Freeze net and cache layer 0's z for every row of X; layer 0 must be dense.
+// Returns 0 when it is not or the cache cannot be allocated.
+int finetune_init(Finetune *ft, Network *net, Matrix X);
+
+// One step on rows [start, start + y.rows) of the cached X: forward, loss,
+// act-only backward and act update. Returns data loss + act reg like train_step.
+mat_t finetune_step(Finetune *ft, int start, Matrix y, SGD *opt, int is_ce);
+
+// Unfreeze the net and release the cache
+void finetune_free(Finetune *ft);
+
+// Swap the hidden activations of net to type (output layer kept), then time
+// epochs of finetune_step against one train_step epoch and print [FT] lines
+void finetune_report(Network *net, ActType type, Matrix X, Matrix Y, Matrix X_test, Matrix Y_test,
+                     int epochs, int batch_size, SGD *opt);
+
+#endif
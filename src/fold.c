@@ -0,0 +1,141 @@
+#include "fold.h"
+
+mat_t fold_fit(ActType type, const mat_t *params, mat_t zmin, mat_t zmax, mat_t *slope, mat_t *icept)
+{
+    mat_t zs[FOLD_GRID], fs[FOLD_GRID];
+    for (int i = 0; i < FOLD_GRID; ++i)
+        zs[i] = zmin + (zmax - zmin) * i / (FOLD_GRID - 1);
+    act_eval(type, params, zs, fs, FOLD_GRID);
+    mat_t zm = 0.0, fm = 0.0;
+    for (int i = 0; i < FOLD_GRID; ++i)
+    {
+        zm += zs[i];
+        fm += fs[i];
+    }
+    zm /= FOLD_GRID;
+    fm /= FOLD_GRID;
+    mat_t szz = 0.0, szf = 0.0;
+    for (int i = 0; i < FOLD_GRID; ++i)
+    {
+        szz += (zs[i] - zm) * (zs[i] - zm);
+        szf += (zs[i] - zm) * (fs[i] - fm);
+    }
+    *slope = szz > 0.0 ? szf / szz : 0.0; // a single observed z: the act is a constant there
+    *icept = fm - *slope * zm;
+    mat_t dev = 0.0, lo = fs[0], hi = fs[0];
+    for (int i = 0; i < FOLD_GRID; ++i)
+    {
+        dev = fmax(dev, fabs(fs[i] - (*slope * zs[i] + *icept)));
+        lo = fmin(lo, fs[i]);
+        hi = fmax(hi, fs[i]);
+    }
+    return hi > lo ? dev / (hi - lo) : 0.0;
+}
+
+// Dense layer with W, b and the activation (params, lr multipliers) of src
+static Layer layer_with(Matrix W, Matrix b, Layer *src)
+{
+    Layer l = init_layer(W.rows, W.cols, src->act.type, ACT_INIT_DEFAULT);
+    copy_matrix(l.W, W);
+    copy_matrix(l.b, b);
+    for (int p = 0; p < src->act.n_params; ++p)
+    {
+        l.act.params[p] = src->act.params[p];
+        l.act_lr.data[p] = src->act_lr.data[p];
+    }
+    return l;
+}
+
+Network fold_linear_acts(Network *net, Matrix calib, mat_t tol)
+{
+    for (int i = 0; i < net->n_layers; ++i)
+        if (net->layers[i].kind != LAYER_DENSE)
+        {
+            printf("[FOLD] skipped: layer %d is not dense\n", i);
+            return net_clone(net);
+        }
+    int n = net->n_layers, n_out = 0;
+    Layer *ls = malloc(n * sizeof(Layer));
+    if (!ls)
+    {
+        fprintf(stderr, "Alloc fail\n");
+        exit(1);
+    }
+    /* cur is the layer being built (src's W/b, possibly merged with earlier
+       layers); h is calib pushed through the layers already emitted */
+    Layer cur = layer_with(net->layers[0].W, net->layers[0].b, &net->layers[0]);
+    Matrix h = {calib.rows, calib.cols, calib.data};
+    int h_owned = 0;
+    for (int i = 0; i < n; ++i)
+    {
+        Layer *src = &net->layers[i];
+        Matrix z = alloc_matrix(calib.rows, cur.out_dim);
+        matmul(h, cur.W, z);
+        mat_add_bias(z, cur.b);
+        mat_t zmin = INFINITY, zmax = -INFINITY;
+        for (int k = 0; k < z.rows * z.cols; ++k)
+        {
+            zmin = fmin(zmin, z.data[k]);
+            zmax = fmax(zmax, z.data[k]);
+        }
+        mat_t s = 1.0, c = 0.0, rel = INFINITY;
+        if (calib.rows > 0)
+            rel = fold_fit(src->act.type, src->act.params, zmin, zmax, &s, &c);
+        Layer *next = i + 1 < n ? &net->layers[i + 1] : NULL;
+        long macs_kept = next ? (long)cur.in_dim * cur.out_dim + (long)cur.out_dim * next->out_dim : 0;
+        long macs_fold = next ? (long)cur.in_dim * next->out_dim : 0;
+        if (next && rel <= tol && macs_fold < macs_kept)
+        {
+            printf("[FOLD] layer %d: %s linear within %.2e on z in [%.3f, %.3f] (s=%.4f c=%.4f), "
+                   "merged into layer %d: %d->%d\n",
+                   i, act_type_name(src->act.type), rel, zmin, zmax, s, c, i + 1, cur.in_dim, next->out_dim);
+            Matrix W = alloc_matrix(cur.in_dim, next->out_dim), b = alloc_matrix(1, next->out_dim);
+            matmul(cur.W, next->W, W);
+            mat_scale(W, s);
+            for (int j = 0; j < cur.out_dim; ++j)
+                cur.b.data[j] = s * cur.b.data[j] + c;
+            matmul(cur.b, next->W, b);
+            for (int j = 0; j < b.cols; ++j)
+                b.data[j] += next->b.data[j];
+            free_layer(&cur);
+            cur = layer_with(W, b, next);
+            free_matrix(W);
+            free_matrix(b);
+            free_matrix(z);
+            continue;
+        }
+        if (next && rel <= tol)
+            printf("[FOLD] layer %d: %s linear within %.2e but merging adds MACs; kept\n", i,
+                   act_type_name(src->act.type), rel);
+        else if (next)
+            printf("[FOLD] layer %d: %s deviates %.2e from a line on z in [%.3f, %.3f]; kept\n", i,
+                   act_type_name(src->act.type), rel, zmin, zmax);
+        act_eval(src->act.type, src->act.params, z.data, z.data, z.rows * z.cols);
+        if (h_owned)
+            free_matrix(h);
+        h = z;
+        h_owned = 1;
+        ls[n_out++] = cur;
+        if (next)
+            cur = layer_with(next->W, next->b, next);
+    }
+    if (h_owned)
+        free_matrix(h);
+    Network f = init_net_layers(net->input_dim, ls, n_out);
+    free(ls);
+    return f;
+}
+
+void fold_report(Network *net, Matrix calib, Matrix x, Matrix y, mat_t tol)
+{
+    Network f = fold_linear_acts(net, calib, tol);
+    long macs = 0, fmacs = 0;
+    for (int i = 0; i < net->n_layers; ++i)
+        macs += (long)net->layers[i].in_dim * net->layers[i].out_dim;
+    for (int i = 0; i < f.n_layers; ++i)
+        fmacs += (long)f.layers[i].in_dim * f.layers[i].out_dim;
+    mat_t acc = eval_acc(net, x, y), facc = eval_acc(&f, x, y);
+    printf("[FOLD] %d -> %d layers, MACs/sample %ld -> %ld | folded acc=%.4f acc=%.4f delta=%+.4f\n", net->n_layers,
+           f.n_layers, macs, fmacs, facc, acc, facc - acc);
+    free_net(&f);
+}
@@ -0,0 +1,27 @@
+#ifndef FOLD_H
+#define FOLD_H
+
+#include "network.h"
+
+/* Post-training graph simplification. act_reg pulls POLY_CUBIC toward a line
+   (a2, a3 -> 0) and PRELU toward alpha = 1, so a trained layer can end up
+   affine over the pre-activations it actually sees. Such a layer,
+   act(x W1 + b1) ~ s (x W1 + b1) + c, merges with the next dense layer into
+       W = s W1 W2,   b = (s b1 + c) W2 + b2
+   keeping the next layer's activation. */
+#define FOLD_TOL 1e-2 // max |act - line| over the z range, relative to the span of act
+#define FOLD_GRID 257 // points of [zmin, zmax] used to fit and test the line
+
+// Least-squares line through act on [zmin, zmax]; returns the max deviation
+// relative to the span of act there (0 for a constant act)
+mat_t fold_fit(ActType type, const mat_t *params, mat_t zmin, mat_t zmax, mat_t *slope, mat_t *icept);
+
+// New network with every foldable layer merged into its successor. The z
+// range of each layer comes from a forward pass over calib; a pair is merged
+// only if it also costs fewer MACs. The last layer and conv nets are kept.
+Network fold_linear_acts(Network *net, Matrix calib, mat_t tol);
+
+// Fold, evaluate both networks on (x, y) and print the accuracy delta and MACs
+void fold_report(Network *net, Matrix calib, Matrix x, Matrix y, mat_t tol);
+
+#endif
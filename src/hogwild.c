@@ -0,0 +1,154 @@
+#include "hogwild.h"
+#include <pthread.h>
+
+typedef struct
+{
+    Hogwild *h;
+    int id;
+    Matrix x, y;
+    SGD *opt;
+    int is_ce, batch_size, n_batches;
+    int *next; // shared batch counter
+} HogwildTask;
+
+// Point a clone's W / b / act param views at the same offsets of the shared slab
+static void share_params(Network *w, Network *shared)
+{
+    for (int i = 0; i < w->n_layers; ++i)
+    {
+        Layer *l = &w->layers[i];
+        l->W.data = shared->params + (l->W.data - w->params);
+        l->b.data = shared->params + (l->b.data - w->params);
+        if (l->act.n_params > 0)
+            l->act.params = shared->params + (l->act.params - w->params);
+    }
+}
+
+Hogwild hogwild_init(Network *net, int n_threads)
+{
+    if (!net->flat)
+    {
+        fprintf(stderr, "hogwild: needs flat storage (config_set_flat_storage(1) before init_net)\n");
+        exit(1);
+    }
+    Hogwild h;
+    h.net = net;
+    h.n_threads = n_threads < 1 ? 1 : n_threads < GEMM_MAX_THREADS ? n_threads : GEMM_MAX_THREADS;
+    h.shuffle = 1;
+    h.order_rng = rng_stream(RNG_STREAM_SHUFFLE);
+    h.order = NULL;
+    h.order_cap = 0;
+    h.workers = malloc(h.n_threads * sizeof(Network));
+    h.samples = calloc(h.n_threads, sizeof(long));
+    h.loss_sum = calloc(h.n_threads, sizeof(mat_t));
+    if (!h.workers || !h.samples || !h.loss_sum)
+    {
+        fprintf(stderr, "Alloc fail\n");
+        exit(1);
+    }
+    for (int t = 0; t < h.n_threads; ++t)
+    {
+        h.workers[t] = net_clone(net);
+        if (!h.workers[t].flat || h.workers[t].n_total != net->n_total)
+        {
+            fprintf(stderr, "hogwild: clone does not share the slab layout\n");
+            exit(1);
+        }
+        share_params(&h.workers[t], net);
+    }
+    return h;
+}
+
+void hogwild_free(Hogwild *h)
+{
+    // The clones own their (now unused) slabs; free_net detaches the views first
+    for (int t = 0; t < h->n_threads; ++t)
+        free_net(&h->workers[t]);
+    free(h->workers);
+    free(h->order);
+    free(h->samples);
+    free(h->loss_sum);
+    h->workers = NULL;
+    h->order = NULL;
+}
+
+static void *hogwild_worker(void *arg)
+{
+    HogwildTask *t = arg;
+    Hogwild *h = t->h;
+    Network *w = &h->workers[t->id];
+    for (;;)
+    {
+        int k = __atomic_fetch_add(t->next, 1, __ATOMIC_RELAXED);
+        if (k >= t->n_batches)
+            break;
+        int start = h->order[k] * t->batch_size;
+        int m = t->x.rows - start < t->batch_size ? t->x.rows - start : t->batch_size;
+        Matrix xb = {m, t->x.cols, t->x.data + (size_t)start * t->x.cols};
+        Matrix yb = {m, t->y.cols, t->y.data + (size_t)start * t->y.cols};
+
+        /* train_step with the update redirected at the shared slab */
+        mat_t loss = net_compute_grads(w, xb, yb, t->is_ce);
+        for (int i = 0; i < w->n_layers; ++i)
+            loss += act_reg(&w->layers[i].act, 1e-4);
+        net_clip_grads(w);
+        sgd_update_dense_shared(h->net->params, w->vels, w->grads, w->n_dense, t->opt);
+        for (int i = 0; i < w->n_layers; ++i)
+            sgd_update_act_shared(&w->layers[i], t->opt);
+        if (isnan(loss) || isinf(loss))
+        {
+            fprintf(stderr, "Invalid loss in hogwild worker %d: %f\n", t->id, loss);
+            exit(1);
+        }
+        h->samples[t->id] += m;
+        h->loss_sum[t->id] += loss * m;
+    }
+    return NULL;
+}
+
+mat_t hogwild_epoch(Hogwild *h, Matrix x, Matrix y, SGD *opt, int is_ce, int batch_size)
+{
+    int n_batches = (x.rows + batch_size - 1) / batch_size;
+    if (n_batches > h->order_cap)
+    {
+        free(h->order);
+        h->order = malloc(n_batches * sizeof(int));
+        if (!h->order)
+        {
+            fprintf(stderr, "Alloc fail\n");
+            exit(1);
+        }
+        h->order_cap = n_batches;
+    }
+    for (int k = 0; k < n_batches; ++k)
+        h->order[k] = k;
+    if (h->shuffle)
+        rng_shuffle(&h->order_rng, h->order, n_batches);
+
+    int next = 0;
+    pthread_t th[GEMM_MAX_THREADS];
+    int started[GEMM_MAX_THREADS] = {0};
+    HogwildTask tasks[GEMM_MAX_THREADS];
+    for (int t = 0; t < h->n_threads; ++t)
+    {
+        h->samples[t] = 0;
+        h->loss_sum[t] = 0.0;
+        tasks[t] = (HogwildTask){h, t, x, y, opt, is_ce, batch_size, n_batches, &next};
+    }
+    // Workers 1.. on their own threads, worker 0 on the caller
+    for (int t = 1; t < h->n_threads; ++t)
+        started[t] = pthread_create(&th[t], NULL, hogwild_worker, &tasks[t]) == 0;
+    hogwild_worker(&tasks[0]);
+    for (int t = 1; t < h->n_threads; ++t)
+        if (started[t])
+            pthread_join(th[t], NULL);
+
+    long n = 0;
+    mat_t loss = 0.0;
+    for (int t = 0; t < h->n_threads; ++t)
+    {
+        n += h->samples[t];
+        loss += h->loss_sum[t];
+    }
+    return n > 0 ? loss / n : 0.0;
+}
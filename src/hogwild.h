@@ -0,0 +1,40 @@
+#ifndef HOGWILD_H
+#define HOGWILD_H
+
+#include "network.h"
+#include "rng.h"
+
+/* Hogwild-style lock-free asynchronous SGD. Each worker thread owns a clone of
+   the network whose W, b and act param views point into the shared net's
+   params slab, plus its own grads, velocities and forward caches. Workers pull
+   mini-batch indices from one atomic counter, run forward/backward against
+   whatever the shared params are at that moment, and apply their update
+   straight to the slab (sgd_update_dense_shared / sgd_update_act_shared: relaxed
+   atomic load/store, no locks). Concurrent updates to the same element can be
+   lost; that is the Hogwild trade, and it is harmless when updates are small
+   relative to the params. Momentum is per worker.
+
+   Needs flat storage (config_set_flat_storage(1) before init_net). Pruning
+   masks are not applied. With one thread an epoch is exactly the train_step
+   loop over the same batch order. */
+typedef struct
+{
+    Network *net;      // shared params
+    Network *workers;  // per-thread clones (views re-pointed into net->params)
+    int n_threads;
+    int shuffle;       // shuffle the batch order each epoch (default 1)
+    Rng order_rng;     // RNG_STREAM_SHUFFLE
+    int *order, order_cap;
+    long *samples;     // per worker, last epoch
+    mat_t *loss_sum;   // per worker, sum of batch loss * batch rows
+} Hogwild;
+
+// Clones net once per thread; exits if net does not use flat storage
+Hogwild hogwild_init(Network *net, int n_threads);
+void hogwild_free(Hogwild *h);
+
+// One epoch over x/y in batches of batch_size; returns the mean training loss
+// (train_step's loss, weighted by batch rows)
+mat_t hogwild_epoch(Hogwild *h, Matrix x, Matrix y, SGD *opt, int is_ce, int batch_size);
+
+#endif
@@ -0,0 +1,51 @@
+#include "infer.h"
+#include "conv.h"
+#include "config.h"
+
+InferCtx infer_ctx_init(Network *net, int max_batch)
+{
+    InferCtx c;
+    c.max_batch = max_batch;
+    c.width = 0;
+    for (int i = 0; i < net->n_layers; ++i)
+    {
+        Layer *l = &net->layers[i];
+        size_t w = (size_t)(l->act.z.cols > l->out_dim ? l->act.z.cols : l->out_dim);
+        c.width = w > c.width ? w : c.width;
+    }
+    for (int k = 0; k < 3; ++k)
+        c.buf[k] = mem_alloc((size_t)max_batch * c.width * sizeof(mat_t), MEM_CACHE);
+    return c;
+}
+
+void infer_ctx_free(InferCtx *c)
+{
+    for (int k = 0; k < 3; ++k)
+        mem_free(c->buf[k]);
+}
+
+Matrix net_infer(Network *net, InferCtx *c, Matrix x)
+{
+    int batch = x.rows;
+    Matrix curr = x;
+    for (int i = 0; i < net->n_layers; ++i)
+    {
+        Layer *l = &net->layers[i];
+        Matrix out = {batch, l->out_dim, c->buf[i & 1]};
+        if (l->kind == LAYER_CONV)
+        {
+            conv_infer(l, curr, l->conv.pool == 1 ? out.data : c->buf[2], out);
+        }
+        else
+        {
+            if (l->w_mask && !l->w_csr_stale && l->w_density <= PRUNE_CSR_DENSITY)
+                dense_spmm(curr, l->w_csr, out); // pruned: built by prune_finalize
+            else
+                matmul(curr, l->W, out);
+            mat_add_bias(out, l->b);
+            act_eval(l->act.type, l->act.params, out.data, out.data, batch * l->out_dim); // in place
+        }
+        curr = out;
+    }
+    return curr;
+}
@@ -0,0 +1,23 @@
+#ifndef INFER_H
+#define INFER_H
+
+#include "network.h"
+
+/* Cache-free batched forward for serving. All intermediates live in the
+   context's scratch buffers (sized once for max_batch rows), so the network is
+   only read: no x_cache, act.z/out or pool indices are touched, and one
+   trained Network can back several contexts. */
+typedef struct
+{
+    int max_batch;
+    size_t width;  // widest layer output / pre-activation, in values per row
+    mat_t *buf[3]; // two ping-pong outputs + conv pre-activation scratch
+} InferCtx;
+
+InferCtx infer_ctx_init(Network *net, int max_batch);
+void infer_ctx_free(InferCtx *c);
+
+// x.rows <= max_batch; returns a view of the output inside c (valid until the next call)
+Matrix net_infer(Network *net, InferCtx *c, Matrix x);
+
+#endif
@@ -0,0 +1,1654 @@
+#include "network.h"
+#include "conv.h"
+#include "config.h"
+#include "prune.h"
+#include "infer.h"
+#include "fold.h"
+#include "rng.h"
+#include "synth.h"
+#include "data.h"
+#include "hogwild.h"
+#include "dist.h"
+#include "pipeline.h"
+#include "finetune.h"
+#include "tiny.h"
+#include "tiny_net.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <float.h>
+#include <math.h>
+
+/* Differential checks of the optimized kernels against plain scalar references
+   (long double accumulation where sums are involved), plus finite-difference
+   checks of layer_backward and net_compute_grads (the gradient half of
+   train_step). Shapes are randomized and include odd / tail sizes so blocked or
+   vectorized paths hit their remainders. Exit code 0 when every check passes.
+
+   Bounds: sums of k products must stay within (k + 2) * eps * sum|a*b| of the
+   reference; elementwise kernels within KC_MAX_ULP ulps; finite differences
+   within KC_FD_TOL relative error (points where the one-sided differences
+   disagree sit on a kink and are skipped). */
+
+#define KC_SHAPES 24
+#define KC_MAX_ULP 4.0
+#define KC_ACT_EPS 8.0 // act_forward vs the long double definitions, in eps of the summed |terms|
+#define KC_FD_TOL 1e-4
+#define KC_BF16_TOL 2e-2 // gradients from bf16 stashes vs full precision
+#define KC_MASK_TOL 1e-10 // act grads from z recovered out of act.out (ACT_STASH_MASK)
+#define KC_FD_SAMPLES 12 // entries probed per tensor in the gradient checks
+
+static const int kc_dims[] = {1, 2, 3, 5, 7, 8, 9, 16, 17, 31, 33, 64, 65};
+static const ActType kc_acts[] = {PRELU, POLY_CUBIC, PIECEWISE, SWISH, FIXED_RELU, FIXED_SIG};
+#define KC_N_ACTS ((int)(sizeof(kc_acts) / sizeof(kc_acts[0])))
+
+static int fails = 0;
+
+static int rand_dim(void)
+{
+    return kc_dims[rand() % (int)(sizeof(kc_dims) / sizeof(kc_dims[0]))];
+}
+
+static mat_t rand_unif(mat_t lo, mat_t hi)
+{
+    return lo + (hi - lo) * (rand() / (mat_t)RAND_MAX);
+}
+
+static void report(const char *name, int cases, double worst, const char *unit, int ok)
+{
+    printf("[CHECK] %-24s %5d cases  worst %.3e %-8s %s\n", name, cases, worst, unit, ok ? "OK" : "FAIL");
+    if (!ok)
+        ++fails;
+}
+
+// Distance in units in the last place between two doubles
+static double ulp_diff(double a, double b)
+{
+    if (a == b)
+        return 0.0;
+    if (isnan(a) || isnan(b))
+        return INFINITY;
+    int64_t ia, ib;
+    memcpy(&ia, &a, sizeof(ia));
+    memcpy(&ib, &b, sizeof(ib));
+    if (ia < 0)
+        ia = INT64_MIN - ia;
+    if (ib < 0)
+        ib = INT64_MIN - ib;
+    return fabs((double)ia - (double)ib);
+}
+
+// |got - ref| as a fraction of the worst-case error of a k-term sum
+static double sum_ratio(mat_t got, long double ref, long double mag, int k)
+{
+    return fabs((double)((long double)got - ref)) / ((k + 2) * DBL_EPSILON * (double)mag + DBL_MIN);
+}
+
+// Random params in ranges the optimizer can reach (PIECEWISE gaps kept moderate)
+static void rand_act_params(Activation *a)
+{
+    for (int p = 0; p < a->n_params; ++p)
+        a->params[p] = rand_unif(-1.0, 1.0);
+    if (a->type == PIECEWISE)
+    {
+        a->params[1] = rand_unif(-1.5, 0.5);
+        a->params[2] = rand_unif(-1.5, 0.5);
+    }
+}
+
+static void check_matmul(void)
+{
+    double worst = 0.0;
+    for (int t = 0; t < KC_SHAPES; ++t)
+    {
+        int m = rand_dim(), k = rand_dim(), n = rand_dim();
+        Matrix a = alloc_matrix(m, k), b = alloc_matrix(k, n), c = alloc_matrix(m, n);
+        mat_rand_uniform(a, -2.0, 2.0);
+        mat_rand_uniform(b, -2.0, 2.0);
+        matmul(a, b, c);
+        for (int i = 0; i < m; ++i)
+            for (int j = 0; j < n; ++j)
+            {
+                long double ref = 0.0L, mag = 0.0L;
+                for (int p = 0; p < k; ++p)
+                {
+                    long double v = (long double)a.data[i * k + p] * b.data[p * n + j];
+                    ref += v;
+                    mag += fabsl(v);
+                }
+                double r = sum_ratio(c.data[i * n + j], ref, mag, k);
+                worst = r > worst ? r : worst;
+            }
+        free_matrix(a);
+        free_matrix(b);
+        free_matrix(c);
+    }
+    report("matmul", KC_SHAPES, worst, "x bound", worst <= 1.0);
+}
+
+// Every GEMM_* blocking / thread layout must reproduce the default bit for bit
+static void check_matmul_layouts(void)
+{
+    static const int layouts[][4] = {{0, 0, 0, 1}, {1, 1, 1, 1}, {3, 5, 7, 1}, {16, 64, 512, 3}, {0, 0, 0, 4}, {7, 3, 5, 8}};
+    int n_layouts = (int)(sizeof(layouts) / sizeof(layouts[0]));
+    int bm = GEMM_BLOCK_M, bk = GEMM_BLOCK_K, bn = GEMM_BLOCK_N, th = GEMM_THREADS;
+    double worst = 0.0;
+    int cases = 0;
+    for (int t = 0; t <= KC_SHAPES; ++t)
+    {
+        // the last shape is big enough for the threaded path (GEMM_PAR_MIN_FLOPS)
+        int m = t < KC_SHAPES ? rand_dim() : 67, k = t < KC_SHAPES ? rand_dim() : 129, n = t < KC_SHAPES ? rand_dim() : 70;
+        Matrix a = alloc_matrix(m, k), b = alloc_matrix(k, n), c0 = alloc_matrix(m, n), c = alloc_matrix(m, n);
+        mat_rand_uniform(a, -2.0, 2.0);
+        mat_rand_uniform(b, -2.0, 2.0);
+        config_set_gemm(bm, bk, bn, 1);
+        matmul(a, b, c0);
+        for (int l = 0; l < n_layouts; ++l, ++cases)
+        {
+            config_set_gemm(layouts[l][0], layouts[l][1], layouts[l][2], layouts[l][3]);
+            mat_rand_uniform(c, -1.0, 1.0); // stale output must be overwritten
+            matmul(a, b, c);
+            for (int i = 0; i < m * n; ++i)
+            {
+                double d = ulp_diff(c.data[i], c0.data[i]);
+                worst = d > worst ? d : worst;
+            }
+        }
+        free_matrix(a);
+        free_matrix(b);
+        free_matrix(c0);
+        free_matrix(c);
+    }
+    config_set_gemm(bm, bk, bn, th);
+    report("matmul layouts", cases, worst, "ulp", worst == 0.0);
+}
+
+// spmm and spmm_tn_accum against dense references on ~20% dense inputs
+static void check_spmm(void)
+{
+    double worst = 0.0;
+    for (int t = 0; t < KC_SHAPES; ++t)
+    {
+        int m = rand_dim(), k = rand_dim(), n = rand_dim();
+        Matrix a = alloc_matrix(m, k), b = alloc_matrix(k, n), c = alloc_matrix(m, n);
+        Matrix d = alloc_matrix(m, n), g = alloc_matrix(k, n), g0 = alloc_matrix(k, n);
+        mat_rand_uniform(a, -2.0, 2.0);
+        for (int i = 0; i < m * k; ++i)
+            if (rand() % 5)
+                a.data[i] = 0.0;
+        mat_rand_uniform(b, -2.0, 2.0);
+        mat_rand_uniform(d, -2.0, 2.0);
+        mat_rand_uniform(g, -1.0, 1.0);
+        copy_matrix(g0, g);
+        mat_t scale = rand_unif(0.1, 2.0);
+        SparseMatrix s;
+        memset(&s, 0, sizeof(s));
+        sparse_from_dense(&s, a);
+        spmm(s, b, c);
+        spmm_tn_accum(s, d, g, scale);
+        for (int i = 0; i < m; ++i)
+            for (int j = 0; j < n; ++j)
+            {
+                long double ref = 0.0L, mag = 0.0L;
+                for (int p = 0; p < k; ++p)
+                {
+                    long double v = (long double)a.data[i * k + p] * b.data[p * n + j];
+                    ref += v;
+                    mag += fabsl(v);
+                }
+                double r = sum_ratio(c.data[i * n + j], ref, mag, k);
+                worst = r > worst ? r : worst;
+            }
+        for (int p = 0; p < k; ++p)
+            for (int j = 0; j < n; ++j)
+            {
+                long double ref = g0.data[p * n + j], mag = fabsl(ref);
+                for (int i = 0; i < m; ++i)
+                {
+                    long double v = (long double)scale * a.data[i * k + p] * d.data[i * n + j];
+                    ref += v;
+                    mag += fabsl(v);
+                }
+                double r = sum_ratio(g.data[p * n + j], ref, mag, m + 1);
+                worst = r > worst ? r : worst;
+            }
+        free_sparse(&s);
+        free_matrix(a);
+        free_matrix(b);
+        free_matrix(c);
+        free_matrix(d);
+        free_matrix(g);
+        free_matrix(g0);
+    }
+    report("spmm / spmm_tn_accum", KC_SHAPES, worst, "x bound", worst <= 1.0);
+}
+
+// Batched act_forward (copying and in-place paths) vs act_eval one element at a time
+/* Each activation straight from its definition in long double, written
+   independently of act_eval (PIECEWISE as s0 z + sum over passed knots of
+   (s_{m+1} - s_m)(z - tau_m) instead of the segment slope plus constant).
+   *mag gets the sum of the |terms|, the scale of act_eval's rounding. */
+static long double ref_act(ActType type, const mat_t *p, mat_t zd, long double *mag)
+{
+    long double z = zd, r;
+    switch (type)
+    {
+    case PRELU:
+        r = z >= 0 ? z : p[0] * z;
+        *mag = fabsl(r);
+        return r;
+    case POLY_CUBIC:
+        *mag = fabsl((long double)p[0]) + fabsl(p[1] * z) + fabsl(p[2] * z * z) + fabsl(p[3] * z * z * z);
+        return p[0] + p[1] * z + p[2] * z * z + p[3] * z * z * z;
+    case PIECEWISE:
+    {
+        long double B = ACT_Z_CLIP_B;
+        z = z > B ? B : z < -B ? -B : z;
+        long double tau[3] = {p[0], p[0] + expl(p[1]), p[0] + expl(p[1]) + expl(p[2])};
+        r = p[3] * z;
+        *mag = fabsl(r);
+        for (int m = 0; m < 3; ++m)
+            if (z > tau[m])
+            {
+                long double kink = ((long double)p[4 + m] - p[3 + m]) * (z - tau[m]);
+                r += kink;
+                *mag += (fabsl((long double)p[4 + m]) + fabsl((long double)p[3 + m])) * (fabsl(z) + fabsl(tau[m]));
+            }
+        return r;
+    }
+    case SWISH:
+        r = z / (1.0L + expl(-p[0] * z));
+        *mag = fabsl(r);
+        return r;
+    case FIXED_RELU:
+        r = z > 0 ? z : 0.0L;
+        *mag = r;
+        return r;
+    case FIXED_SIG:
+        r = 1.0L / (1.0L + expl(-z));
+        *mag = r;
+        return r;
+    }
+    *mag = 0.0L;
+    return 0.0L;
+}
+
+static void check_act_forward(void)
+{
+    double worst = 0.0;
+    int cases = 0;
+    for (int ai = 0; ai < KC_N_ACTS; ++ai)
+        for (int t = 0; t < KC_SHAPES / 4; ++t, ++cases)
+        {
+            int rows = rand_dim(), cols = rand_dim();
+            Activation a = init_act(kc_acts[ai], cols, ACT_INIT_DEFAULT);
+            rand_act_params(&a);
+            Matrix z = alloc_matrix(rows, cols), out = alloc_matrix(rows, cols);
+            mat_rand_uniform(z, -3.0, 3.0);
+            act_forward(&a, z);
+            copy_matrix(out, a.out);
+            Matrix zv = {rows, cols, a.z.data}; // in-place path: z already in a.z
+            act_forward(&a, zv);
+            for (int i = 0; i < rows * cols; ++i)
+            {
+                long double mag, ref = ref_act(a.type, a.params, z.data[i], &mag);
+                double e = (double)(fabsl(out.data[i] - ref) / (mag * DBL_EPSILON + 1e-300L));
+                e = out.data[i] == a.out.data[i] ? e : 1e300; // both paths, same bits
+                worst = e > worst ? e : worst;
+            }
+            free_matrix(z);
+            free_matrix(out);
+            free_act(&a);
+        }
+    report("act_forward", cases, worst, "eps", worst <= KC_ACT_EPS);
+}
+
+/* Central difference of g at *p with kink detection: returns 0 when the
+   one-sided differences disagree (non-differentiable point within h). */
+typedef mat_t (*LossFn)(void *ctx);
+
+static int fd_grad(LossFn f, void *ctx, mat_t *p, mat_t *num)
+{
+    mat_t old = *p, h = 1e-6 * fmax(1.0, fabs(old));
+    mat_t f0 = f(ctx);
+    *p = old + h;
+    mat_t fp = f(ctx);
+    *p = old - h;
+    mat_t fm = f(ctx);
+    *p = old;
+    mat_t up = (fp - f0) / h, dn = (f0 - fm) / h;
+    if (fabs(up - dn) > 1e-3 * (1.0 + fabs(up) + fabs(dn)))
+        return 0;
+    *num = (fp - fm) / (2.0 * h);
+    return 1;
+}
+
+// Relative error; the 1e-5 floor sits well above the ~1e-10 round-off of the differences
+static double fd_err(mat_t analytic, mat_t num)
+{
+    return fabs(analytic - num) / (fabs(analytic) + fabs(num) + 1e-5);
+}
+
+typedef struct
+{
+    Activation *a;
+    Matrix z, delta;
+    mat_t *zi; // single element probed by act_scalar_loss
+} ActCtx;
+
+// sum(delta * f(z)) over the batch, via the scalar reference
+static mat_t act_batch_loss(void *ctx)
+{
+    ActCtx *c = ctx;
+    long double s = 0.0L;
+    for (int i = 0; i < c->z.rows * c->z.cols; ++i)
+    {
+        mat_t o;
+        act_eval(c->a->type, c->a->params, &c->z.data[i], &o, 1);
+        s += (long double)c->delta.data[i] * o;
+    }
+    return (mat_t)s;
+}
+
+static mat_t act_scalar_loss(void *ctx)
+{
+    ActCtx *c = ctx;
+    mat_t o;
+    act_eval(c->a->type, c->a->params, c->zi, &o, 1);
+    return o;
+}
+
+// act_backward: delta_z vs delta * f'(z), grad_act vs d/dp sum(delta * f)
+static void check_act_backward(void)
+{
+    double worst = 0.0;
+    int cases = 0, skipped = 0;
+    for (int ai = 0; ai < KC_N_ACTS; ++ai)
+        for (int t = 0; t < KC_SHAPES / 4; ++t, ++cases)
+        {
+            int rows = 1 + rand() % 5, cols = rand_dim();
+            Activation a = init_act(kc_acts[ai], cols, ACT_INIT_DEFAULT);
+            rand_act_params(&a);
+            Matrix z = alloc_matrix(rows, cols), delta = alloc_matrix(rows, cols), dz = alloc_matrix(rows, cols);
+            mat_rand_uniform(z, -3.0, 3.0);
+            mat_rand_uniform(delta, -1.0, 1.0);
+            act_forward(&a, z);
+            for (int p = 0; p < a.n_params; ++p)
+                a.grad_act[p] = 0.0;
+            act_backward(&a, delta, dz);
+            ActCtx c = {&a, z, delta, NULL};
+            for (int i = 0; i < rows * cols; ++i)
+            {
+                mat_t num;
+                c.zi = &z.data[i];
+                if (!fd_grad(act_scalar_loss, &c, c.zi, &num))
+                {
+                    ++skipped;
+                    continue;
+                }
+                double e = fd_err(dz.data[i], delta.data[i] * num);
+                worst = e > worst ? e : worst;
+            }
+            for (int p = 0; p < a.n_params; ++p)
+            {
+                mat_t num;
+                if (!fd_grad(act_batch_loss, &c, &a.params[p], &num))
+                {
+                    ++skipped;
+                    continue;
+                }
+                double e = fd_err(a.grad_act[p], num);
+                worst = e > worst ? e : worst;
+            }
+            free_matrix(z);
+            free_matrix(delta);
+            free_matrix(dz);
+            free_act(&a);
+        }
+    report("act_backward (fd)", cases, worst, "rel", worst <= KC_FD_TOL);
+    if (skipped)
+        printf("        %d kink points skipped\n", skipped);
+}
+
+// Fused loss kernels vs a long double softmax / squared error
+static void check_losses(void)
+{
+    double worst = 0.0;
+    const mat_t spans[] = {1.0, 10.0, 50.0};
+    for (int t = 0; t < KC_SHAPES; ++t)
+    {
+        int batch = rand_dim(), C = 2 + rand_dim() % 16;
+        mat_t span = spans[t % 3];
+        Matrix z = alloc_matrix(batch, C), y = alloc_matrix(batch, 1), d = alloc_matrix(batch, C);
+        mat_rand_uniform(z, -span, span);
+        for (int b = 0; b < batch; ++b)
+            y.data[b] = rand() % C;
+        mat_t loss = loss_softmax_ce(z, y, d);
+        long double ref_loss = 0.0L, mag = 0.0L;
+        for (int b = 0; b < batch; ++b)
+        {
+            const mat_t *zr = z.data + b * C;
+            int lbl = (int)y.data[b];
+            long double m = zr[0], se = 0.0L;
+            for (int j = 1; j < C; ++j)
+                m = zr[j] > m ? zr[j] : m;
+            for (int j = 0; j < C; ++j)
+                se += expl(zr[j] - m);
+            for (int j = 0; j < C; ++j)
+            {
+                long double p = expl(zr[j] - m) / se - (j == lbl ? 1.0L : 0.0L);
+                double r = fabs((double)((long double)d.data[b * C + j] - p)) / ((C + 8) * DBL_EPSILON);
+                worst = r > worst ? r : worst;
+            }
+            ref_loss += logl(se) + m - zr[lbl];
+            mag += fabsl(logl(se)) + fabsl(m) + fabsl(zr[lbl]);
+        }
+        double r = sum_ratio(loss, ref_loss / batch, mag / batch, batch + C + 8);
+        worst = r > worst ? r : worst;
+
+        // MSE against a per-sample target vector
+        Matrix t2 = alloc_matrix(batch, C);
+        mat_rand_uniform(t2, -1.0, 1.0);
+        loss = loss_mse(z, t2, d);
+        ref_loss = 0.0L;
+        mag = 0.0L;
+        for (int i = 0; i < batch * C; ++i)
+        {
+            long double e = (long double)z.data[i] - t2.data[i];
+            ref_loss += e * e;
+            mag += e * e;
+            double rd = sum_ratio(d.data[i], e, fabsl(e), 1);
+            worst = rd > worst ? rd : worst;
+        }
+        r = sum_ratio(loss, ref_loss / (batch * C), mag / (batch * C), batch * C + 2);
+        worst = r > worst ? r : worst;
+        free_matrix(t2);
+        free_matrix(z);
+        free_matrix(y);
+        free_matrix(d);
+    }
+    report("softmax-CE / MSE loss", KC_SHAPES, worst, "x bound", worst <= 1.0);
+}
+
+// sgd_update_dense vs the scalar momentum rule, and flat vs per-layer training
+static void check_sgd(void)
+{
+    double worst = 0.0;
+    SGD opt = {0.05, 0.9, 0.01, 0.9, 1.0};
+    for (int t = 0; t < KC_SHAPES; ++t)
+    {
+        int n = rand_dim() * rand_dim();
+        mat_t *p = malloc(n * sizeof(mat_t)), *v = malloc(n * sizeof(mat_t)), *g = malloc(n * sizeof(mat_t));
+        mat_t *rp = malloc(n * sizeof(mat_t)), *rv = malloc(n * sizeof(mat_t));
+        for (int i = 0; i < n; ++i)
+        {
+            rp[i] = p[i] = rand_unif(-1.0, 1.0);
+            rv[i] = v[i] = rand_unif(-0.1, 0.1);
+            g[i] = rand_unif(-1.0, 1.0);
+            rv[i] = opt.momentum * rv[i] - opt.lr * g[i];
+            rp[i] += rv[i];
+        }
+        sgd_update_dense(p, v, g, n, &opt);
+        for (int i = 0; i < n; ++i)
+        {
+            double u = ulp_diff(p[i], rp[i]);
+            double w = ulp_diff(v[i], rv[i]);
+            u = u > w ? u : w;
+            if (g[i] != 0.0)
+                u = INFINITY; // grads must be reset
+            worst = u > worst ? u : worst;
+        }
+        free(p);
+        free(v);
+        free(g);
+        free(rp);
+        free(rv);
+    }
+    report("sgd_update_dense", KC_SHAPES, worst, "ulp", worst <= KC_MAX_ULP);
+
+    /* Same init, same data: flat slabs and per-layer tensors must train alike */
+    int arch[] = {7, 17, 9, 3};
+    ActType acts[] = {SWISH, POLY_CUBIC, FIXED_SIG};
+    ActInitStrategy strats[] = {ACT_INIT_NOISY, ACT_INIT_NOISY, ACT_INIT_IDENTITY};
+    Matrix x = alloc_matrix(13, 7), y = alloc_matrix(13, 3);
+    mat_rand_uniform(x, -1.0, 1.0);
+    mat_rand_uniform(y, 0.0, 1.0);
+    Network nets[2];
+    for (int f = 0; f < 2; ++f)
+    {
+        config_set_flat_storage(f);
+        srand_seed(7);
+        nets[f] = init_net(7, arch, 4, acts, strats);
+        for (int s = 0; s < 5; ++s)
+            train_step(&nets[f], x, y, &opt, 0);
+    }
+    config_set_flat_storage(0);
+    double rel = 0.0;
+    for (int i = 0; i < nets[0].n_layers; ++i)
+    {
+        Layer *a = &nets[0].layers[i], *b = &nets[1].layers[i];
+        for (int j = 0; j < a->W.rows * a->W.cols; ++j)
+            rel = fmax(rel, fabs(a->W.data[j] - b->W.data[j]) / (fabs(a->W.data[j]) + 1e-12));
+        for (int j = 0; j < a->b.cols; ++j)
+            rel = fmax(rel, fabs(a->b.data[j] - b->b.data[j]) / (fabs(a->b.data[j]) + 1e-12));
+        for (int j = 0; j < a->act.n_params; ++j)
+            rel = fmax(rel, fabs(a->act.params[j] - b->act.params[j]) / (fabs(a->act.params[j]) + 1e-12));
+    }
+    report("flat vs per-layer update", 5, rel, "rel", rel <= 1e-12);
+    free_net(&nets[0]);
+    free_net(&nets[1]);
+    free_matrix(x);
+    free_matrix(y);
+}
+
+// Blocked direct convolution (act.z) and max-pool output vs naive loops
+static void check_conv(void)
+{
+    double worst = 0.0;
+    int pool_bad = 0;
+    const int out_cs[] = {1, 3, 8, 11};
+    for (int t = 0; t < KC_SHAPES; ++t)
+    {
+        int in_c = 1 + rand() % 3, k = 1 + 2 * (rand() % 3), pad = rand() % (k / 2 + 1);
+        int in_h = k + rand() % 7, in_w = k + rand() % 7;
+        int out_c = out_cs[rand() % 4], pool = 1 + rand() % 3;
+        if ((in_h + 2 * pad - k + 1) < pool || (in_w + 2 * pad - k + 1) < pool)
+            pool = 1;
+        Layer l = init_conv_layer(in_c, in_h, in_w, out_c, k, pad, pool, FIXED_RELU, ACT_INIT_DEFAULT);
+        mat_rand_uniform(l.b, -0.5, 0.5);
+        int batch = 1 + rand() % 3;
+        Matrix x = alloc_matrix(batch, l.in_dim);
+        mat_rand_uniform(x, -1.0, 1.0);
+        Matrix out = layer_forward_view(&l, x);
+        const ConvShape *c = &l.conv;
+        int plane = c->conv_h * c->conv_w, act_dim = out_c * plane;
+        for (int b = 0; b < batch; ++b)
+            for (int co = 0; co < out_c; ++co)
+                for (int oy = 0; oy < c->conv_h; ++oy)
+                    for (int ox = 0; ox < c->conv_w; ++ox)
+                    {
+                        long double ref = l.b.data[co], mag = fabsl(ref);
+                        for (int ci = 0; ci < in_c; ++ci)
+                            for (int ky = 0; ky < k; ++ky)
+                                for (int kx = 0; kx < k; ++kx)
+                                {
+                                    int iy = oy + ky - pad, ix = ox + kx - pad;
+                                    if (iy < 0 || iy >= in_h || ix < 0 || ix >= in_w)
+                                        continue;
+                                    long double v = (long double)x.data[(size_t)b * l.in_dim + (ci * in_h + iy) * in_w + ix] *
+                                                    l.W.data[((ci * k + ky) * k + kx) * out_c + co];
+                                    ref += v;
+                                    mag += fabsl(v);
+                                }
+                        mat_t got = l.act.z.data[(size_t)b * act_dim + co * plane + oy * c->conv_w + ox];
+                        double r = sum_ratio(got, ref, mag, in_c * k * k + 1);
+                        worst = r > worst ? r : worst;
+                    }
+        for (int b = 0; b < batch; ++b)
+            for (int co = 0; co < out_c; ++co)
+                for (int py = 0; py < c->out_h; ++py)
+                    for (int px = 0; px < c->out_w; ++px)
+                    {
+                        const mat_t *a = l.act.out.data + (size_t)b * act_dim + co * plane;
+                        mat_t m = -INFINITY;
+                        for (int dy = 0; dy < pool; ++dy)
+                            for (int dx = 0; dx < pool; ++dx)
+                                m = fmax(m, a[(py * pool + dy) * c->conv_w + px * pool + dx]);
+                        if (out.data[(size_t)b * l.out_dim + (co * c->out_h + py) * c->out_w + px] != m)
+                            ++pool_bad;
+                    }
+        free_matrix(x);
+        free_layer(&l);
+    }
+    report("conv_forward", KC_SHAPES, worst, "x bound", worst <= 1.0 && pool_bad == 0);
+    if (pool_bad)
+        printf("        %d pooled outputs differ from the window max\n", pool_bad);
+}
+
+typedef struct
+{
+    Layer *l;
+    Matrix x, r;
+} LayerCtx;
+
+// sum(r * layer(x)): layer_backward with delta_out = r yields its gradients
+static mat_t layer_proj_loss(void *ctx)
+{
+    LayerCtx *c = ctx;
+    Matrix out = layer_forward_view(c->l, c->x);
+    long double s = 0.0L;
+    for (int i = 0; i < out.rows * out.cols; ++i)
+        s += (long double)c->r.data[i] * out.data[i];
+    return (mat_t)s;
+}
+
+// Probe up to KC_FD_SAMPLES entries of p against analytic g * gscale
+static void fd_tensor(LossFn f, void *ctx, mat_t *p, const mat_t *g, int n, mat_t gscale,
+                      double *worst, int *skipped)
+{
+    int probes = n < KC_FD_SAMPLES ? n : KC_FD_SAMPLES;
+    for (int s = 0; s < probes; ++s)
+    {
+        int i = n <= KC_FD_SAMPLES ? s : rand() % n;
+        mat_t num;
+        if (!fd_grad(f, ctx, &p[i], &num))
+        {
+            ++*skipped;
+            continue;
+        }
+        double e = fd_err(g[i] * gscale, num);
+        *worst = e > *worst ? e : *worst;
+    }
+}
+
+// layer_backward (dense and conv, every ActType) vs finite differences
+static void check_layer_backward(void)
+{
+    double worst = 0.0;
+    int cases = 0, skipped = 0;
+    for (int ai = 0; ai < KC_N_ACTS; ++ai)
+        for (int kind = 0; kind < 2; ++kind, ++cases)
+        {
+            Layer l = kind == 0 ? init_layer(rand_dim(), rand_dim(), kc_acts[ai], ACT_INIT_DEFAULT)
+                                : init_conv_layer(2, 5, 6, 3, 3, 1, 2, kc_acts[ai], ACT_INIT_DEFAULT);
+            rand_act_params(&l.act);
+            mat_rand_uniform(l.b, -0.5, 0.5);
+            int batch = 1 + rand() % 4;
+            Matrix x = alloc_matrix(batch, l.in_dim), r = alloc_matrix(batch, l.out_dim);
+            Matrix dx = alloc_matrix(batch, l.in_dim);
+            mat_rand_uniform(x, -1.0, 1.0);
+            mat_rand_uniform(r, -1.0, 1.0);
+            layer_forward_view(&l, x);
+            mat_scale(l.grad_W, 0.0);
+            mat_scale(l.grad_b, 0.0);
+            for (int p = 0; p < l.act.n_params; ++p)
+                l.act.grad_act[p] = 0.0;
+            layer_backward(&l, r, dx);
+            LayerCtx c = {&l, x, r};
+            // grad_W / grad_b are batch means of the per-sample gradients
+            fd_tensor(layer_proj_loss, &c, l.W.data, l.grad_W.data, l.W.rows * l.W.cols, batch, &worst, &skipped);
+            fd_tensor(layer_proj_loss, &c, l.b.data, l.grad_b.data, l.b.cols, batch, &worst, &skipped);
+            fd_tensor(layer_proj_loss, &c, l.act.params, l.act.grad_act, l.act.n_params, 1.0, &worst, &skipped);
+            fd_tensor(layer_proj_loss, &c, x.data, dx.data, batch * l.in_dim, 1.0, &worst, &skipped);
+            free_matrix(x);
+            free_matrix(r);
+            free_matrix(dx);
+            free_layer(&l);
+        }
+    report("layer_backward (fd)", cases, worst, "rel", worst <= KC_FD_TOL);
+    if (skipped)
+        printf("        %d kink points skipped\n", skipped);
+}
+
+typedef struct
+{
+    Network *net;
+    Matrix x, y;
+    int is_ce;
+} NetCtx;
+
+static mat_t net_data_loss(void *ctx)
+{
+    NetCtx *c = ctx;
+    return net_compute_grads(c->net, c->x, c->y, c->is_ce); // grads accumulated here are discarded
+}
+
+/* net_compute_grads (what train_step applies) vs finite differences of its loss.
+   Scaling per network.h: CE grads are d(loss); MSE grads are (out_dim / 2) d(loss);
+   act grads are batch sums, i.e. batch times those. */
+static void check_net_grads(void)
+{
+    struct
+    {
+        const char *name;
+        int conv, is_ce, flat, micro, sparse_x;
+    } cfg[] = {{"dense mse", 0, 0, 0, 0, 0},
+               {"dense ce flat", 0, 1, 1, 0, 0},
+               {"dense ce micro-batched", 0, 1, 1, 1, 0},
+               {"dense ce sparse input", 0, 1, 0, 0, 1},
+               {"conv ce flat micro", 1, 1, 1, 1, 0}};
+    int n_cfg = (int)(sizeof(cfg) / sizeof(cfg[0]));
+    double worst_all = 0.0;
+    int skipped = 0;
+    for (int ci = 0; ci < n_cfg; ++ci)
+    {
+        config_set_flat_storage(cfg[ci].flat);
+        Network net;
+        int in_dim, out_dim;
+        if (cfg[ci].conv)
+        {
+            Layer ls[2] = {init_conv_layer(1, 6, 6, 3, 3, 1, 2, SWISH, ACT_INIT_NOISY),
+                           init_layer(27, 4, POLY_CUBIC, ACT_INIT_IDENTITY)};
+            net = init_net_layers(36, ls, 2);
+        }
+        else
+        {
+            int arch[] = {9, 11, 5, 3};
+            ActType acts[] = {SWISH, PRELU, cfg[ci].is_ce ? POLY_CUBIC : FIXED_SIG};
+            ActInitStrategy strats[] = {ACT_INIT_NOISY, ACT_INIT_NOISY, ACT_INIT_IDENTITY};
+            net = init_net(9, arch, 4, acts, strats);
+        }
+        in_dim = net.input_dim;
+        out_dim = net.layers[net.n_layers - 1].out_dim;
+        int batch = 5;
+        Matrix x = alloc_matrix(batch, in_dim), y = alloc_matrix(batch, cfg[ci].is_ce ? 1 : out_dim);
+        mat_rand_uniform(x, -1.0, 1.0);
+        if (cfg[ci].sparse_x)
+            for (int i = 0; i < batch * in_dim; ++i)
+                if (rand() % 10)
+                    x.data[i] = 0.0;
+        for (int i = 0; i < y.rows * y.cols; ++i)
+            y.data[i] = cfg[ci].is_ce ? rand() % out_dim : rand_unif(0.0, 1.0);
+        if (cfg[ci].micro)
+            config_set_act_mem_budget(1); // one row per micro-batch
+
+        net_zero_grads(&net);
+        net_compute_grads(&net, x, y, cfg[ci].is_ce);
+        mat_t dscale = cfg[ci].is_ce ? 1.0 : 2.0 / out_dim;
+        /* Snapshot the analytic grads first: every probe accumulates more */
+        NetCtx c = {&net, x, y, cfg[ci].is_ce};
+        mat_t **g = malloc(net.n_layers * sizeof(mat_t *));
+        for (int i = 0; i < net.n_layers; ++i)
+        {
+            Layer *l = &net.layers[i];
+            int nw = l->W.rows * l->W.cols, nb = l->b.cols, na = l->act.n_params;
+            g[i] = malloc((nw + nb + na) * sizeof(mat_t));
+            memcpy(g[i], l->grad_W.data, nw * sizeof(mat_t));
+            memcpy(g[i] + nw, l->grad_b.data, nb * sizeof(mat_t));
+            if (na)
+                memcpy(g[i] + nw + nb, l->act.grad_act, na * sizeof(mat_t));
+        }
+        double worst = 0.0;
+        for (int i = 0; i < net.n_layers; ++i)
+        {
+            Layer *l = &net.layers[i];
+            int nw = l->W.rows * l->W.cols, nb = l->b.cols, na = l->act.n_params;
+            fd_tensor(net_data_loss, &c, l->W.data, g[i], nw, dscale, &worst, &skipped);
+            fd_tensor(net_data_loss, &c, l->b.data, g[i] + nw, nb, dscale, &worst, &skipped);
+            fd_tensor(net_data_loss, &c, l->act.params, g[i] + nw + nb, na, dscale / batch, &worst, &skipped);
+            free(g[i]);
+        }
+        free(g);
+        net_zero_grads(&net);
+        config_set_act_mem_budget(0);
+        config_set_flat_storage(0);
+        printf("        %-24s worst %.3e rel\n", cfg[ci].name, worst);
+        worst_all = worst > worst_all ? worst : worst_all;
+        free_net(&net);
+        free_matrix(x);
+        free_matrix(y);
+    }
+    report("train_step grads (fd)", n_cfg, worst_all, "rel", worst_all <= KC_FD_TOL);
+    if (skipped)
+        printf("        %d kink points skipped\n", skipped);
+}
+
+// bf16 round trip within half an ulp of an 8-bit mantissa, and net grads with
+// bf16 stashes (ACT_STASH_BF16) close to the full-precision ones
+static void check_bf16_stash(void)
+{
+    double worst = 0.0;
+    for (int i = 0; i < 4096; ++i)
+    {
+        mat_t v = rand_unif(-1.0, 1.0) * pow(2.0, rand() % 40 - 20), r;
+        uint16_t h;
+        bf16_pack(&v, &h, 1);
+        bf16_unpack(&h, &r, 1);
+        double e = fabs(r - v) / (fabs(v) * pow(2.0, -8));
+        worst = e > worst ? e : worst;
+    }
+    report("bf16 round trip", 4096, worst, "x bound", worst <= 1.0);
+
+    double worst_g = 0.0;
+    int sparse_cfg[] = {0, 1};
+    for (int ci = 0; ci < 2; ++ci)
+    {
+        int arch[] = {9, 11, 5, 3};
+        ActType acts[] = {SWISH, PIECEWISE, POLY_CUBIC};
+        ActInitStrategy strats[] = {ACT_INIT_NOISY, ACT_INIT_NOISY, ACT_INIT_IDENTITY};
+        Network net = init_net(9, arch, 4, acts, strats);
+        int batch = 7;
+        Matrix x = alloc_matrix(batch, 9), y = alloc_matrix(batch, 1);
+        mat_rand_uniform(x, -1.0, 1.0);
+        if (sparse_cfg[ci])
+            for (int i = 0; i < batch * 9; ++i)
+                if (rand() % 10)
+                    x.data[i] = 0.0;
+        for (int i = 0; i < batch; ++i)
+            y.data[i] = rand() % 3;
+        mat_t *full[3];
+        for (int pass = 0; pass < 2; ++pass)
+        {
+            config_set_act_stash_bf16(pass);
+            net_zero_grads(&net);
+            net_compute_grads(&net, x, y, 1);
+            for (int i = 0; i < net.n_layers; ++i)
+            {
+                Layer *l = &net.layers[i];
+                int nw = l->W.rows * l->W.cols, nb = l->b.cols, na = l->act.n_params;
+                if (pass == 0)
+                {
+                    full[i] = malloc((nw + nb + na) * sizeof(mat_t));
+                    memcpy(full[i], l->grad_W.data, nw * sizeof(mat_t));
+                    memcpy(full[i] + nw, l->grad_b.data, nb * sizeof(mat_t));
+                    memcpy(full[i] + nw + nb, l->act.grad_act, na * sizeof(mat_t));
+                    continue;
+                }
+                /* Relative L2 error of the layer's whole gradient (W, b, act
+                   params): bf16 keeps ~3 significant digits of x and z. A lone
+                   act-param grad sums many cancelling terms, so it is only
+                   bounded through the layer's update direction. */
+                double num = 0.0, den = 0.0;
+                const mat_t *got[3] = {l->grad_W.data, l->grad_b.data, l->act.grad_act};
+                int len[3] = {nw, nb, na};
+                for (int t = 0, off = 0; t < 3; off += len[t], ++t)
+                    for (int j = 0; j < len[t]; ++j)
+                    {
+                        double d = got[t][j] - full[i][off + j];
+                        num += d * d;
+                        den += full[i][off + j] * full[i][off + j];
+                    }
+                double e = sqrt(num) / (sqrt(den) + 1e-12);
+                worst_g = e > worst_g ? e : worst_g;
+                free(full[i]);
+            }
+        }
+        config_set_act_stash_bf16(0);
+        net_zero_grads(&net);
+        free_net(&net);
+        free_matrix(x);
+        free_matrix(y);
+    }
+    report("bf16 stash grads", 2, worst_g, "rel L2", worst_g <= KC_BF16_TOL);
+}
+
+// Bit-packed z codes (ACT_STASH_MASK): act_backward_mask vs act_backward_z on
+// the same z gives identical deltas and act grads within rounding of the z it
+// recovers from the output; a masked net gives the same W/b grads, no act.z
+// rand_act_params with alpha / slopes clear of ACT_MASK_MIN_SCALE (mask path taken)
+static void rand_mask_params(Activation *a)
+{
+    rand_act_params(a);
+    for (int p = a->type == PRELU ? 0 : 3; a->type != FIXED_RELU && p < a->n_params; ++p)
+        if (fabs(a->params[p]) < 0.05)
+            a->params[p] = 0.5;
+}
+
+static void check_act_mask(void)
+{
+    static const ActType types[] = {FIXED_RELU, PRELU, PIECEWISE};
+    double worst = 0.0;
+    int cases = 0, exact = 1;
+    for (int ti = 0; ti < 3; ++ti)
+        for (int t = 0; t < KC_SHAPES / 4; ++t, ++cases)
+        {
+            int rows = 1 + rand() % 5, cols = rand_dim(), n = rows * cols;
+            Activation a = init_act(types[ti], cols, ACT_INIT_DEFAULT);
+            rand_mask_params(&a);
+            Matrix z = alloc_matrix(rows, cols), out = alloc_matrix(rows, cols), delta = alloc_matrix(rows, cols);
+            Matrix dz_ref = alloc_matrix(rows, cols), dz = alloc_matrix(rows, cols);
+            mat_rand_uniform(z, -1.5 * ACT_Z_CLIP_B, 1.5 * ACT_Z_CLIP_B); // a third past the clip
+            mat_rand_uniform(delta, -1.0, 1.0);
+            act_eval(a.type, a.params, z.data, out.data, n);
+            int bits = act_mask_bits(&a);
+            exact &= bits == (types[ti] == PIECEWISE ? 2 : 1);
+            unsigned char *mask = malloc(act_mask_bytes(bits, (size_t)n));
+            act_pack_mask(&a, z.data, mask, n);
+            mat_t ref[7];
+            for (int p = 0; p < a.n_params; ++p)
+                a.grad_act[p] = 0.0;
+            act_backward_z(&a, z.data, delta, dz_ref);
+            for (int p = 0; p < a.n_params; ++p)
+            {
+                ref[p] = a.grad_act[p];
+                a.grad_act[p] = 0.0;
+            }
+            act_backward_mask(&a, mask, out.data, delta, dz);
+            for (int i = 0; i < n; ++i)
+                exact &= dz.data[i] == dz_ref.data[i];
+            double mag = 0.0; // bounds every |delta * (z or tau)| term of a grad
+            for (int i = 0; i < n; ++i)
+                mag += fabs(delta.data[i]) * (fabs(z.data[i]) + ACT_Z_CLIP_B);
+            for (int p = 0; p < a.n_params; ++p)
+            {
+                double e = fabs(a.grad_act[p] - ref[p]) / (mag + 1e-300);
+                worst = e > worst ? e : worst;
+            }
+            free(mask);
+            free_matrix(z);
+            free_matrix(out);
+            free_matrix(delta);
+            free_matrix(dz_ref);
+            free_matrix(dz);
+            free_act(&a);
+        }
+    // Dividing by a tiny alpha / slope would lose z: those fall back to the full z
+    Activation small_p = init_act(PRELU, 1, ACT_INIT_DEFAULT), small_pw = init_act(PIECEWISE, 1, ACT_INIT_DEFAULT);
+    small_p.params[0] = 0.5 * ACT_MASK_MIN_SCALE;
+    small_pw.params[5] = -0.5 * ACT_MASK_MIN_SCALE;
+    exact &= act_mask_bits(&small_p) == 0 && act_mask_bits(&small_pw) == 0;
+    free_act(&small_p);
+    free_act(&small_pw);
+    report("act mask backward", cases, worst, "rel", exact && worst <= KC_MASK_TOL);
+
+    int arch[] = {9, 11, 6, 3};
+    ActType acts[] = {PRELU, PIECEWISE, FIXED_RELU};
+    ActInitStrategy strats[] = {ACT_INIT_NOISY, ACT_INIT_NOISY, ACT_INIT_DEFAULT};
+    Network net = init_net(9, arch, 4, acts, strats);
+    for (int i = 0; i < 2; ++i) // NOISY leaves alpha / slopes near 0
+        rand_mask_params(&net.layers[i].act);
+    int batch = 7;
+    Matrix x = alloc_matrix(batch, 9), y = alloc_matrix(batch, 1);
+    mat_rand_uniform(x, -1.0, 1.0);
+    for (int i = 0; i < batch; ++i)
+        y.data[i] = rand() % 3;
+    mat_t *full[3];
+    double worst_a = 0.0;
+    exact = 1;
+    for (int pass = 0; pass < 2; ++pass)
+    {
+        config_set_act_stash_mask(pass);
+        net_zero_grads(&net);
+        net_compute_grads(&net, x, y, 1);
+        for (int i = 0; i < net.n_layers; ++i)
+        {
+            Layer *l = &net.layers[i];
+            int nw = l->W.rows * l->W.cols, nb = l->b.cols, na = l->act.n_params;
+            if (pass == 0)
+            {
+                full[i] = malloc((nw + nb + na) * sizeof(mat_t));
+                memcpy(full[i], l->grad_W.data, nw * sizeof(mat_t));
+                memcpy(full[i] + nw, l->grad_b.data, nb * sizeof(mat_t));
+                memcpy(full[i] + nw + nb, l->act.grad_act, na * sizeof(mat_t));
+                continue;
+            }
+            exact &= l->act.z.data == NULL && (l->stashed & LAYER_STASH_MASK);
+            for (int j = 0; j < nw + nb; ++j) // same delta_z and x: bit-identical
+                exact &= (j < nw ? l->grad_W.data[j] : l->grad_b.data[j - nw]) == full[i][j];
+            for (int p = 0; p < na; ++p)
+            {
+                double e = fabs(l->act.grad_act[p] - full[i][nw + nb + p]) / (fabs(full[i][nw + nb + p]) + 1e-12);
+                worst_a = e > worst_a ? e : worst_a;
+            }
+            free(full[i]);
+        }
+    }
+    config_set_act_stash_mask(0);
+    net_zero_grads(&net);
+    free_net(&net);
+    free_matrix(x);
+    free_matrix(y);
+    report("act mask net grads", 1, worst_a, "rel", exact && worst_a <= KC_MASK_TOL);
+}
+
+// Dense x CSR kernels vs matmul (same summation order: bit-exact), masked
+// training on the CSR path vs the dense path, and prune_shrink vs the masked net
+static void check_pruning(void)
+{
+    double worst = 0.0;
+    for (int t = 0; t < KC_SHAPES; ++t)
+    {
+        int m = rand_dim(), k = rand_dim(), n = rand_dim();
+        Matrix a = alloc_matrix(m, k), w = alloc_matrix(k, n), wt = alloc_matrix(n, k), d = alloc_matrix(m, n);
+        Matrix c0 = alloc_matrix(m, n), c = alloc_matrix(m, n), e0 = alloc_matrix(m, k), e = alloc_matrix(m, k);
+        mat_rand_uniform(a, -2.0, 2.0);
+        mat_rand_uniform(w, -2.0, 2.0);
+        mat_rand_uniform(d, -2.0, 2.0);
+        for (int i = 0; i < k * n; ++i)
+            if (rand() % 10 < 7)
+                w.data[i] = 0.0;
+        SparseMatrix ws = {0};
+        sparse_from_dense(&ws, w);
+        matmul(a, w, c0);
+        dense_spmm(a, ws, c);
+        mat_transpose(w, wt);
+        matmul(d, wt, e0);
+        dense_spmm_t(d, ws, e);
+        for (int i = 0; i < m * n; ++i)
+            worst = fmax(worst, ulp_diff(c.data[i], c0.data[i]));
+        for (int i = 0; i < m * k; ++i)
+            worst = fmax(worst, ulp_diff(e.data[i], e0.data[i]));
+        free_sparse(&ws);
+        free_matrix(a);
+        free_matrix(w);
+        free_matrix(wt);
+        free_matrix(d);
+        free_matrix(c0);
+        free_matrix(c);
+        free_matrix(e0);
+        free_matrix(e);
+    }
+    report("dense_spmm / _t", KC_SHAPES, worst, "ulp", worst == 0.0);
+
+    /* Same init and schedule, CSR path on (density 1) and off (0): identical
+       training; pruned weights must stay exactly zero */
+    int arch[] = {9, 12, 8, 3};
+    ActType acts[] = {SWISH, POLY_CUBIC, POLY_CUBIC};
+    ActInitStrategy strats[] = {ACT_INIT_NOISY, ACT_INIT_NOISY, ACT_INIT_IDENTITY};
+    mat_t target[] = {0.8, 0.5, 0.3};
+    SGD opt = {0.05, 0.9, 0.01, 0.9, 1.0};
+    Matrix x = alloc_matrix(11, 9), y = alloc_matrix(11, 1);
+    mat_rand_uniform(x, -1.0, 1.0);
+    for (int i = 0; i < 11; ++i)
+        y.data[i] = rand() % 3;
+    double train_ulp = 0.0, shrink_rel = 0.0;
+    int leaked = 0;
+    for (int mode = 0; mode < 2; ++mode)
+    {
+        PruneSchedule sched = {mode ? PRUNE_STRUCTURED : PRUNE_UNSTRUCTURED, target, 2, 8, 2};
+        Network nets[2];
+        for (int v = 0; v < 2; ++v)
+        {
+            config_set_flat_storage(mode); // structured run also covers the flat-slab update
+            config_set_prune_csr_density(v ? 1.0 : 0.0);
+            srand_seed(11);
+            nets[v] = init_net(9, arch, 4, acts, strats);
+            for (int step = 0; step < 12; ++step)
+            {
+                train_step(&nets[v], x, y, &opt, 1);
+                prune_step(&nets[v], &sched, step);
+            }
+        }
+        for (int i = 0; i < nets[0].n_layers; ++i)
+        {
+            Layer *a = &nets[0].layers[i], *b = &nets[1].layers[i];
+            for (int j = 0; j < a->W.rows * a->W.cols; ++j)
+            {
+                train_ulp = fmax(train_ulp, ulp_diff(a->W.data[j], b->W.data[j]));
+                leaked += !b->w_mask[j] && b->W.data[j] != 0.0;
+            }
+            for (int j = 0; b->b_mask && j < b->b.cols; ++j)
+                leaked += !b->b_mask[j] && b->b.data[j] != 0.0;
+        }
+        /* Structurally pruned net vs its shrunk rebuild (folded constants) */
+        if (mode == 1)
+        {
+            Network s = prune_shrink(&nets[1]);
+            InferCtx c0 = infer_ctx_init(&nets[1], x.rows), c1 = infer_ctx_init(&s, x.rows);
+            Matrix o0 = net_infer(&nets[1], &c0, x), o1 = net_infer(&s, &c1, x);
+            for (int i = 0; i < o0.rows * o0.cols; ++i)
+                shrink_rel = fmax(shrink_rel, fabs(o0.data[i] - o1.data[i]) / (fabs(o0.data[i]) + 1e-12));
+            if (s.layers[0].out_dim >= nets[1].layers[0].out_dim)
+                shrink_rel = INFINITY; // nothing was removed
+            infer_ctx_free(&c0);
+            infer_ctx_free(&c1);
+            free_net(&s);
+        }
+        free_net(&nets[0]);
+        free_net(&nets[1]);
+    }
+    config_set_flat_storage(0);
+    config_set_prune_csr_density(0.3);
+    free_matrix(x);
+    free_matrix(y);
+    report("pruned training csr", 2, train_ulp, "ulp", train_ulp == 0.0 && !leaked);
+    if (leaked)
+        printf("        %d pruned weights became non-zero\n", leaked);
+    report("prune_shrink", 1, shrink_rel, "rel", shrink_rel <= 1e-12);
+}
+
+// Counter-based RNG: any split of a fill into ranges (as threads would do it)
+// reproduces the sequential draws bit for bit; plus range, mean and shuffle sanity
+static void check_rng(void)
+{
+    enum { N = 100003 };
+    mat_t *seq = malloc(N * sizeof(mat_t)), *par = malloc(N * sizeof(mat_t));
+    Rng r = rng_stream_seed(42, 7);
+    r.ctr = 12345;
+    Rng one = r;
+    for (int i = 0; i < N; ++i)
+        seq[i] = -3.0 + rng_uniform(&one) * 5.0;
+    double worst = 0.0;
+    int splits[] = {1, 2, 3, 7, 64};
+    for (int t = 0; t < 5; ++t)
+    {
+        size_t chunk = (N + splits[t] - 1) / splits[t];
+        for (int w = splits[t] - 1; w >= 0; --w) // any order
+        {
+            size_t lo = (size_t)w * chunk, hi = lo + chunk < N ? lo + chunk : N;
+            rng_fill_uniform_at(&r, lo, par + lo, hi - lo, -3.0, 2.0);
+        }
+        for (int i = 0; i < N; ++i)
+            worst = fmax(worst, ulp_diff(par[i], seq[i]));
+    }
+    report("rng split fills", 5, worst, "ulp", worst == 0.0);
+
+    Rng u = rng_stream_seed(1, 0), v = rng_stream_seed(1, 1);
+    double mean = 0.0, m2 = 0.0;
+    int out_of_range = 0, same = 0;
+    for (int i = 0; i < N; ++i)
+    {
+        mat_t a = rng_uniform(&u);
+        out_of_range += a < 0.0 || a >= 1.0;
+        same += rng_u64(&v) == rng_u64_at(&u, i);
+        mean += a;
+        m2 += a * a;
+    }
+    mean /= N;
+    m2 = m2 / N - mean * mean;
+    double dev = fmax(fabs(mean - 0.5), fabs(m2 - 1.0 / 12.0));
+    report("rng uniform moments", 1, dev, "abs", dev < 5e-3 && !out_of_range && !same);
+
+    int idx[257], seen[257] = {0}, moved = 0;
+    for (int i = 0; i < 257; ++i)
+        idx[i] = i;
+    rng_shuffle(&u, idx, 257);
+    for (int i = 0; i < 257; ++i)
+    {
+        seen[idx[i]]++;
+        moved += idx[i] != i;
+    }
+    int perm = 1;
+    for (int i = 0; i < 257; ++i)
+        perm &= seen[i] == 1;
+    report("rng_shuffle", 1, 0.0, "", perm && moved > 200);
+
+    // The sweep's spirals validation set: same labels, reproducible, but its own noise
+    Matrix Xa, Ya, Xb, Yb, Xv, Yv;
+    gen_spirals(&Xa, &Ya, RNG_STREAM_DATA);
+    rng_uniform(&u); // drawing elsewhere must not move the data streams
+    gen_spirals(&Xb, &Yb, RNG_STREAM_DATA);
+    gen_spirals(&Xv, &Yv, RNG_STREAM_DATA_VAL);
+    int repro = 1, labels = 1, differ = 0;
+    for (int i = 0; i < Xa.rows * Xa.cols; ++i)
+    {
+        repro &= Xa.data[i] == Xb.data[i];
+        differ += Xa.data[i] != Xv.data[i];
+    }
+    for (int i = 0; i < Ya.rows; ++i)
+        labels &= Ya.data[i] == Yv.data[i];
+    report("gen_spirals streams", 2, 0.0, "", repro && labels && differ == Xa.rows * Xa.cols);
+    free_matrix(Xa);
+    free_matrix(Ya);
+    free_matrix(Xb);
+    free_matrix(Yb);
+    free_matrix(Xv);
+    free_matrix(Yv);
+    free(seq);
+    free(par);
+}
+
+// Synthetic rows do not depend on the thread count, and the streamed file
+// (chunked, X then Y) loads back as the in-memory dataset
+static void check_synth(void)
+{
+    int bad = 0, cases = 0;
+    for (int kind = SYNTH_SPIRALS; kind <= SYNTH_BLOBS; ++kind)
+    {
+        SynthSpec spec = {(SynthKind)kind, SYNTH_CHUNK_ROWS + 1001, 3 + kind % 2, kind == SYNTH_MOONS ? 2 : 7, 0.1, 9};
+        Matrix X1, Y1, X5, Y5, XF, YF;
+        synth_generate(&spec, &X1, &Y1, 1);
+        synth_generate(&spec, &X5, &Y5, 5);
+        const char *path = "kernel_check_synth.bin";
+        if (!synth_write(&spec, path, 3) || !load_data(path, &XF, &YF))
+        {
+            ++bad;
+            continue;
+        }
+        remove(path);
+        size_t nx = (size_t)X1.rows * X1.cols;
+        bad += XF.rows != X1.rows || XF.cols != X1.cols || YF.cols != 1;
+        if (!bad)
+        {
+            bad += memcmp(X1.data, X5.data, nx * sizeof(mat_t)) != 0 || memcmp(X1.data, XF.data, nx * sizeof(mat_t)) != 0;
+            for (int i = 0; i < Y1.rows; ++i)
+                bad += Y1.data[i] != i % spec.classes || Y5.data[i] != Y1.data[i] || YF.data[i] != Y1.data[i];
+            for (size_t i = 0; i < nx; ++i)
+                bad += !isfinite(X1.data[i]);
+        }
+        ++cases;
+        free_matrix(X1);
+        free_matrix(Y1);
+        free_matrix(X5);
+        free_matrix(Y5);
+        free_matrix(XF);
+        free_matrix(YF);
+    }
+    report("synth threads / file", cases, bad, "bad", bad == 0);
+}
+
+typedef struct
+{
+    int id;
+} MemWorker;
+
+static void *mem_worker(void *arg)
+{
+    MemWorker *w = arg;
+    void *held[8] = {0};
+    for (int i = 0; i < 20000; ++i)
+    {
+        int s = (i * 7 + w->id) % 8;
+        mem_free(held[s]);
+        held[s] = mem_alloc(16 + (size_t)((i * 13 + w->id) % 997), (MemTag)((i + w->id) % MEM_N_TAGS));
+    }
+    for (int s = 0; s < 8; ++s)
+        mem_free(held[s]);
+    return NULL;
+}
+
+// Allocation accounting: per-tag current/peak/count bookkeeping, and balance
+// after concurrent alloc/free from several threads (relaxed atomics)
+static void check_mem(void)
+{
+    MemStats t0 = mem_total(), c0 = mem_stats(MEM_CACHE), d0 = mem_stats(MEM_DATA);
+    mem_reset_peaks();
+    Matrix a = alloc_matrix_tag(100, 10, MEM_DATA);
+    void *b = mem_calloc(250, sizeof(int), MEM_CACHE);
+    MemStats d1 = mem_stats(MEM_DATA), c1 = mem_stats(MEM_CACHE);
+    int ok = d1.cur - d0.cur == 8000 && c1.cur - c0.cur == 1000 && d1.allocs == d0.allocs + 1;
+    free_matrix(a);
+    mem_free(b);
+    MemStats t1 = mem_total();
+    ok &= t1.cur == t0.cur && t1.peak >= t0.cur + 9000 && t1.frees >= t0.frees + 2;
+
+    pthread_t th[4];
+    MemWorker w[4];
+    for (int i = 0; i < 4; ++i)
+    {
+        w[i].id = i;
+        pthread_create(&th[i], NULL, mem_worker, &w[i]);
+    }
+    for (int i = 0; i < 4; ++i)
+        pthread_join(th[i], NULL);
+    MemStats t2 = mem_total();
+    ok &= t2.cur == t0.cur && t2.allocs - t1.allocs == t2.frees - t1.frees && t2.allocs - t1.allocs == 80000;
+    report("mem accounting", 2, (double)t2.cur - t0.cur, "bytes", ok);
+}
+
+// Folding exactly linear activations (PRELU alpha = 1, POLY_CUBIC a2 = a3 = 0)
+// preserves the network function; a curved SWISH layer stays
+static void check_fold(void)
+{
+    int arch[] = {9, 12, 8, 6, 3};
+    ActType acts[] = {PRELU, POLY_CUBIC, SWISH, POLY_CUBIC};
+    ActInitStrategy strats[] = {ACT_INIT_DEFAULT, ACT_INIT_NOISY, ACT_INIT_DEFAULT, ACT_INIT_NOISY};
+    Network net = init_net(9, arch, 5, acts, strats);
+    net.layers[0].act.params[0] = 1.0;
+    net.layers[1].act.params[1] = 1.0;
+    net.layers[1].act.params[2] = net.layers[1].act.params[3] = 0.0;
+    net.layers[2].act.params[0] = 1.0;
+    Matrix x = alloc_matrix(17, 9);
+    mat_rand_uniform(x, -2.0, 2.0);
+    Network f = fold_linear_acts(&net, x, FOLD_TOL);
+    InferCtx c0 = infer_ctx_init(&net, x.rows), c1 = infer_ctx_init(&f, x.rows);
+    Matrix o0 = net_infer(&net, &c0, x), o1 = net_infer(&f, &c1, x);
+    double worst = 0.0;
+    for (int i = 0; i < o0.rows * o0.cols; ++i)
+        worst = fmax(worst, fabs(o0.data[i] - o1.data[i]) / (fabs(o0.data[i]) + 1e-12));
+    int layers_ok = f.n_layers == 2 && f.layers[0].in_dim == 9 && f.layers[0].out_dim == 6;
+    report("fold_linear_acts", 1, worst, "rel", worst <= 1e-12 && layers_ok);
+    if (!layers_ok)
+        printf("        expected 9->6->3 after folding, got %d layers\n", f.n_layers);
+    infer_ctx_free(&c0);
+    infer_ctx_free(&c1);
+    free_net(&f);
+    free_net(&net);
+    free_matrix(x);
+}
+
+// Hogwild: one worker is exactly the train_step loop (same batch order, updates
+// through the shared-slab path); four racing workers still train
+static void check_hogwild(void)
+{
+    config_set_flat_storage(1);
+    int arch[] = {2, 16, 2};
+    ActType acts[] = {PRELU, POLY_CUBIC};
+    ActInitStrategy strats[] = {ACT_INIT_NOISY, ACT_INIT_IDENTITY};
+    SynthSpec spec = {SYNTH_MOONS, 600, 2, 2, 0.1, 5};
+    Matrix x, y;
+    synth_generate(&spec, &x, &y, 1);
+    SGD opt = {0.05, 0.9, 0.01, 0.9, 1.0};
+    int bs = 32;
+
+    srand_seed(7);
+    Network ref = init_net(2, arch, 3, acts, strats);
+    srand_seed(7);
+    Network net = init_net(2, arch, 3, acts, strats);
+    Hogwild h = hogwild_init(&net, 1);
+    h.shuffle = 0;
+    for (int e = 0; e < 2; ++e)
+    {
+        for (int start = 0; start < x.rows; start += bs)
+        {
+            int m = x.rows - start < bs ? x.rows - start : bs;
+            Matrix xb = {m, 2, x.data + (size_t)start * 2}, yb = {m, 1, y.data + start};
+            train_step(&ref, xb, yb, &opt, 1);
+        }
+        hogwild_epoch(&h, x, y, &opt, 1, bs);
+    }
+    size_t diff = 0;
+    for (size_t i = 0; i < ref.n_total; ++i)
+        diff += memcmp(&ref.params[i], &net.params[i], sizeof(mat_t)) != 0;
+    report("hogwild 1 thread == train_step", 1, (double)diff, "diffs", diff == 0);
+    hogwild_free(&h);
+    free_net(&net);
+
+    srand_seed(7);
+    net = init_net(2, arch, 3, acts, strats);
+    h = hogwild_init(&net, 4);
+    opt.momentum = opt.act_momentum = 0.0; // plain Hogwild SGD: stale per-worker momentum can spike the loss
+    mat_t first = hogwild_epoch(&h, x, y, &opt, 1, bs), last = first;
+    for (int e = 1; e < 10; ++e)
+        last = hogwild_epoch(&h, x, y, &opt, 1, bs);
+    long n = 0;
+    for (int t = 0; t < h.n_threads; ++t)
+        n += h.samples[t];
+    int ok = isfinite(last) && last < first && n == x.rows;
+    report("hogwild 4 threads trains", 1, last, "loss", ok);
+    if (!ok)
+        printf("        loss %.4f -> %.4f, %ld of %d rows in the last epoch\n", first, last, n, x.rows);
+    hogwild_free(&h);
+    free_net(&net);
+    free_net(&ref);
+    free_matrix(x);
+    free_matrix(y);
+    config_set_flat_storage(0);
+}
+
+// Act-only fine-tuning (cached layer-0 z, here file-backed) is train_step on the
+// frozen net bit for bit, and neither path moves W/b
+static void check_finetune(void)
+{
+    int arch[] = {6, 14, 10, 3};
+    ActType acts[] = {PIECEWISE, POLY_CUBIC, PRELU};
+    ActInitStrategy strats[] = {ACT_INIT_NOISY, ACT_INIT_NOISY, ACT_INIT_IDENTITY};
+    SynthSpec spec = {SYNTH_BLOBS, 150, 3, 6, 0.5, 9};
+    Matrix x, y;
+    synth_generate(&spec, &x, &y, 1);
+    SGD opt = {0.05, 0.9, 0.05, 0.9, 1.0};
+    int bs = 32;
+
+    srand_seed(11);
+    Network ref = init_net(6, arch, 4, acts, strats);
+    srand_seed(11);
+    Network net = init_net(6, arch, 4, acts, strats);
+    Network init = net_clone(&net);
+    for (int i = 0; i < ref.n_layers; ++i)
+        ref.layers[i].frozen = 1;
+    long saved = ACT_FT_MMAP_BYTES;
+    config_set_act_ft_mmap_bytes(1);
+    Finetune ft;
+    int inited = finetune_init(&ft, &net, x), ok = inited && ft.map != NULL;
+    for (int e = 0; ok && e < 3; ++e)
+        for (int start = 0; start < x.rows; start += bs)
+        {
+            int m = x.rows - start < bs ? x.rows - start : bs;
+            Matrix xb = {m, 6, x.data + (size_t)start * 6}, yb = {m, 1, y.data + start};
+            train_step(&ref, xb, yb, &opt, 1);
+            finetune_step(&ft, start, yb, &opt, 1);
+        }
+    config_set_act_ft_mmap_bytes(saved);
+    int diff = 0, moved = 0;
+    for (int i = 0; i < net.n_layers; ++i)
+    {
+        Layer *r = &ref.layers[i], *l = &net.layers[i], *l0 = &init.layers[i];
+        int nw = l->W.rows * l->W.cols;
+        for (int j = 0; j < nw; ++j) // == rather than bitwise: train_step turns the -0.0 biases into +0.0
+            moved += r->W.data[j] != l0->W.data[j] || l->W.data[j] != l0->W.data[j];
+        for (int j = 0; j < l->b.cols; ++j)
+            moved += r->b.data[j] != l0->b.data[j] || l->b.data[j] != l0->b.data[j];
+        moved += memcmp(l->act.params, l0->act.params, l->act.n_params * sizeof(mat_t)) == 0; // acts must learn
+        for (int j = 0; j < l->act.n_params; ++j)
+            diff += memcmp(&r->act.params[j], &l->act.params[j], sizeof(mat_t)) != 0;
+    }
+    report("finetune == frozen train_step", 1, (double)diff, "diffs", ok && diff == 0 && moved == 0);
+    if (!ok || moved)
+        printf("        init %s, %d W/b entries moved or act layers stuck\n",
+               ok ? "ok" : "failed", moved);
+    if (inited)
+        finetune_free(&ft);
+    free_net(&init);
+    free_net(&ref);
+    free_net(&net);
+    free_matrix(x);
+    free_matrix(y);
+}
+
+// Params and optimizer state of two nets of one shape that differ (== rather than
+// bitwise: train_step turns the -0.0 biases into +0.0)
+static int kc_net_diffs(Network *a, Network *b)
+{
+    int diff = 0;
+    for (int i = 0; i < a->n_layers; ++i)
+    {
+        Layer *la = &a->layers[i], *lb = &b->layers[i];
+        const Matrix *ta[4] = {&la->W, &la->b, &la->v_W, &la->v_b}, *tb[4] = {&lb->W, &lb->b, &lb->v_W, &lb->v_b};
+        for (int t = 0; t < 4; ++t)
+            for (int j = 0; j < ta[t]->rows * ta[t]->cols; ++j)
+                diff += ta[t]->data[j] != tb[t]->data[j];
+        for (int j = 0; j < la->act.n_params; ++j)
+            diff += la->act.params[j] != lb->act.params[j] || la->v_act.data[j] != lb->v_act.data[j];
+    }
+    return diff;
+}
+
+TINY_NET_DEFINE(kc_tiny_352, 3, 5, 2, PIECEWISE, SWISH)
+
+// Compile-time specialized tiny nets (tiny_net.h) vs train_step / eval_acc bit
+// for bit: every 2-4-1 instance of tiny.c on MSE, and a 3-5-2 softmax-CE
+// instance on alternating dense and CSR-path (mostly zero) batches
+static void check_tiny(void)
+{
+    SGD opt = {0.05, 0.9, 0.05, 0.9, 1.0};
+    int cases = 0, diff = 0, bound = 1;
+    for (int ai = 0; ai < KC_N_ACTS; ++ai, ++cases)
+    {
+        int arch[] = {2, 4, 1};
+        ActType acts[] = {kc_acts[ai], FIXED_SIG};
+        ActInitStrategy strats[] = {ACT_INIT_NOISY, ACT_INIT_IDENTITY};
+        Network ref = init_net(2, arch, 3, acts, strats), net = net_clone(&ref);
+        Matrix x = alloc_matrix(16, 2), y = alloc_matrix(16, 1);
+        mat_rand_uniform(x, -2.0, 2.0);
+        for (int i = 0; i < 16; ++i)
+            y.data[i] = rand() % 2;
+        TinyNet t;
+        int ok = tiny_bind(&t, &net);
+        bound &= ok;
+        for (int step = 0; ok && step < 6; ++step)
+            diff += train_step(&ref, x, y, &opt, 0) != tiny_train_step(&t, x, y, &opt, 0);
+        if (ok)
+        {
+            diff += eval_acc(&ref, x, y) != tiny_eval_acc(&t, x, y);
+            tiny_sync(&t, &net);
+            diff += kc_net_diffs(&ref, &net);
+            tiny_free(&t);
+        }
+        free_net(&ref);
+        free_net(&net);
+        free_matrix(x);
+        free_matrix(y);
+    }
+
+    int arch[] = {3, 5, 2};
+    ActType acts[] = {PIECEWISE, SWISH};
+    ActInitStrategy strats[] = {ACT_INIT_NOISY, ACT_INIT_NOISY};
+    Network ref = init_net(3, arch, 3, acts, strats), net = net_clone(&ref);
+    kc_tiny_352 t;
+    bound &= kc_tiny_352_load(&t, &net);
+    Matrix x = alloc_matrix(12, 3), y = alloc_matrix(12, 1);
+    for (int step = 0; step < 6; ++step, ++cases)
+    {
+        mat_rand_uniform(x, -6.0, 6.0); // past ACT_Z_CLIP_B too
+        if (step & 1)
+            for (int i = 1; i < 36; ++i) // one non-zero: layer 0 takes the CSR path
+                x.data[i] = 0.0;
+        for (int i = 0; i < 12; ++i)
+            y.data[i] = rand() % 2;
+        diff += train_step(&ref, x, y, &opt, 1) != kc_tiny_352_train_step(&t, x.data, y.data, 12, 1, &opt, 1);
+        diff += (int)(eval_acc(&ref, x, y) * 12 + 0.5) != kc_tiny_352_correct(&t, x.data, y.data, 12, 1);
+    }
+    kc_tiny_352_store(&t, &net);
+    diff += kc_net_diffs(&ref, &net);
+    free_net(&ref);
+    free_net(&net);
+    free_matrix(x);
+    free_matrix(y);
+    report("tiny nets == train_step", cases, (double)diff, "diffs", bound && diff == 0);
+}
+
+// Pipeline: one stage, one micro-batch is train_step bit for bit; 3 stages with
+// 4 uneven micro-batches (1F1B) match it up to summation order
+static void check_pipeline(void)
+{
+    int arch[] = {6, 20, 16, 12, 8, 3};
+    ActType acts[] = {PRELU, SWISH, POLY_CUBIC, PIECEWISE, PRELU};
+    ActInitStrategy strats[] = {ACT_INIT_NOISY, ACT_INIT_DEFAULT, ACT_INIT_NOISY, ACT_INIT_DEFAULT, ACT_INIT_IDENTITY};
+    SynthSpec spec = {SYNTH_BLOBS, 90, 3, 6, 0.5, 4};
+    Matrix x, y;
+    synth_generate(&spec, &x, &y, 1);
+    SGD opt = {0.05, 0.9, 0.01, 0.9, 1.0};
+    int cfg[2][2] = {{1, 1}, {3, 4}};
+    for (int ci = 0; ci < 2; ++ci)
+    {
+        srand_seed(21);
+        Network ref = init_net(6, arch, 6, acts, strats);
+        srand_seed(21);
+        Network net = init_net(6, arch, 6, acts, strats);
+        Pipeline p;
+        pipeline_init(&p, &net, cfg[ci][0], cfg[ci][1]);
+        double worst = 0.0;
+        for (int step = 0; step < 3; ++step)
+        {
+            Matrix xb = {30, 6, x.data + (size_t)step * 30 * 6}, yb = {30, 1, y.data + step * 30};
+            mat_t l_ref = train_step(&ref, xb, yb, &opt, 1);
+            mat_t l = pipeline_train_step(&p, xb, yb, &opt, 1);
+            worst = fmax(worst, fabs(l - l_ref) / fabs(l_ref));
+        }
+        for (int i = 0; i < ref.n_layers; ++i)
+        {
+            Layer *a = &ref.layers[i], *b = &net.layers[i];
+            for (int j = 0; j < a->W.rows * a->W.cols; ++j)
+                worst = fmax(worst, fabs(a->W.data[j] - b->W.data[j]) / (fabs(a->W.data[j]) + 1e-3));
+            for (int j = 0; j < a->b.cols; ++j)
+                worst = fmax(worst, fabs(a->b.data[j] - b->b.data[j]) / (fabs(a->b.data[j]) + 1e-3));
+            for (int j = 0; j < a->act.n_params; ++j)
+                worst = fmax(worst, fabs(a->act.params[j] - b->act.params[j]) / (fabs(a->act.params[j]) + 1e-3));
+        }
+        char name[48];
+        snprintf(name, sizeof(name), "pipeline %d stages x %d micro", p.n_stages, p.n_micro);
+        report(name, 3, worst, "rel", ci == 0 ? worst == 0.0 : worst <= 1e-10);
+        pipeline_free(&p);
+        free_net(&net);
+        free_net(&ref);
+    }
+    free_matrix(x);
+    free_matrix(y);
+}
+
+typedef struct
+{
+    Matrix x, y;
+    int steps, batch;
+} DistCheck;
+
+// One rank of check_dist: exact all-reduce on an uneven buffer, then dist
+// training against train_step on the whole batch, then replicas bit-identical
+// (each rank compares with its left neighbour's params)
+static int dist_check_rank(DistTransport *t, void *arg)
+{
+    DistCheck *c = arg;
+    int P = t->world, r = t->rank, bad = 0;
+    size_t n = 100003; // several pieces, chunks of unequal size
+    mat_t *buf = malloc(n * sizeof(mat_t)), *tmp = malloc(DIST_PIECE_BYTES);
+    for (size_t i = 0; i < n; ++i)
+        buf[i] = (r + 1) * 0.5 * (mat_t)i;
+    int ok = dist_allreduce_sum(t, buf, n, tmp);
+    for (size_t i = 0; ok && i < n; ++i)
+        bad += buf[i] != P * (P + 1) / 2 * 0.5 * (mat_t)i;
+
+    config_set_flat_storage(1);
+    int arch[] = {2, 12, 8, 2};
+    ActType acts[] = {PRELU, SWISH, POLY_CUBIC};
+    ActInitStrategy strats[] = {ACT_INIT_NOISY, ACT_INIT_DEFAULT, ACT_INIT_IDENTITY};
+    SGD opt = {0.05, 0.9, 0.01, 0.9, 1.0};
+    srand_seed(11);
+    Network ref = init_net(2, arch, 4, acts, strats);
+    srand_seed(11);
+    Network net = init_net(2, arch, 4, acts, strats);
+    DistTrainer d;
+    dist_trainer_init(&d, t, &net);
+    double worst = 0.0;
+    for (int k = 0; k < c->steps; ++k)
+    {
+        Matrix xb = {c->batch, 2, c->x.data + (size_t)k * c->batch * 2}, yb = {c->batch, 1, c->y.data + k * c->batch};
+        int s0, m;
+        dist_shard(c->batch, r, P, &s0, &m);
+        Matrix xs = {m, 2, xb.data + (size_t)s0 * 2}, ys = {m, 1, yb.data + s0};
+        mat_t l_ref = train_step(&ref, xb, yb, &opt, 1);
+        mat_t l = dist_train_step(&d, xs, ys, &opt, 1, c->batch);
+        worst = fmax(worst, fabs(l - l_ref) / fabs(l_ref));
+    }
+    for (size_t i = 0; i < ref.n_total; ++i)
+        worst = fmax(worst, fabs(net.params[i] - ref.params[i]) / (fabs(ref.params[i]) + 1e-3));
+    bad += worst > 1e-10;
+
+    size_t piece = DIST_PIECE_BYTES / sizeof(mat_t);
+    for (size_t off = 0; ok && off < net.n_total; off += piece)
+    {
+        size_t m = net.n_total - off < piece ? net.n_total - off : piece;
+        ok = t->send_next(t, net.params + off, m * sizeof(mat_t)) && t->recv_prev(t, tmp, m * sizeof(mat_t));
+        bad += ok && memcmp(tmp, net.params + off, m * sizeof(mat_t)) != 0;
+    }
+    if (!ok || bad)
+        printf("        rank %d/%d (%s): %d mismatches, worst rel %.3e vs train_step\n", r, P, t->name, bad, worst);
+    dist_trainer_free(&d);
+    free_net(&net);
+    free_net(&ref);
+    free(buf);
+    free(tmp);
+    return !ok || bad;
+}
+
+// Ring all-reduce and multi-process training on both transports, 3 ranks
+static void check_dist(void)
+{
+#ifndef _WIN32
+    SynthSpec spec = {SYNTH_SPIRALS, 250, 2, 2, 0.1, 9};
+    DistCheck c = {{0}, {0}, 5, 50};
+    synth_generate(&spec, &c.x, &c.y, 1);
+    for (int b = DIST_SHM; b <= DIST_SOCKET; ++b)
+    {
+        char name[48];
+        snprintf(name, sizeof(name), "dist 3 ranks (%s)", dist_backend_name((DistBackend)b));
+        int ok = dist_launch(3, (DistBackend)b, dist_check_rank, &c);
+        report(name, 3, ok ? 0.0 : 1.0, "failed", ok);
+    }
+    free_matrix(c.x);
+    free_matrix(c.y);
+#endif
+}
+
+int main()
+{
+    srand(1234);
+    check_matmul();
+    check_matmul_layouts();
+    check_spmm();
+    check_act_forward();
+    check_act_backward();
+    check_losses();
+    check_sgd();
+    check_conv();
+    check_layer_backward();
+    check_net_grads();
+    check_bf16_stash();
+    check_act_mask();
+    check_pruning();
+    check_fold();
+    check_rng();
+    check_synth();
+    check_mem();
+    check_hogwild();
+    check_finetune();
+    check_tiny();
+    check_pipeline();
+    check_dist();
+    if (fails)
+        printf("%d kernel check(s) FAILED\n", fails);
+    else
+        printf("All kernel checks passed\n");
+    return fails ? 1 : 0;
+}
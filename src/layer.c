@@ -1,24 +1,49 @@
 #include "layer.h"
+#include "conv.h"
+#include "config.h"
 #include <math.h> // fmax, etc.
+#include <string.h>
 
-Layer init_layer(int in, int out, ActType t, ActInitStrategy strat)
+/* Shared init: W is w_in x w_out (w_in = fan-in), the layer maps in -> out
+   and its activation works on act_dim values per sample. Dense layers have
+   w_in = in, w_out = act_dim = out. */
+static Layer init_layer_shaped(int w_in, int w_out, int in, int out, int act_dim,
+                               ActType t, ActInitStrategy strat)
 {
     Layer l;
-    l.W = alloc_matrix(in, out); // W: in x out
-    l.b = alloc_matrix(1, out);  // b: 1 x out
-    l.grad_W = alloc_matrix(in, out); // grad_W: in x out
-    l.grad_b = alloc_matrix(1, out);  // grad_b: 1 x out
-    l.v_W = alloc_matrix(in, out); // v_W: in x out
-    l.v_b = alloc_matrix(1, out);  // v_b: 1 x out
-    l.v_act = alloc_matrix(1, 1);      // v_act placeholder (will be resized below)
-    l.x_cache = alloc_matrix(1024, in);  // x_cache: max_batch x in (increased)
-    l.act = init_act(t, out, strat);
+    l.W = alloc_matrix_tag(w_in, w_out, MEM_WEIGHTS); // W: in x out
+    l.b = alloc_matrix_tag(1, w_out, MEM_WEIGHTS);    // b: 1 x out
+    l.grad_W = alloc_matrix_tag(w_in, w_out, MEM_GRADS); // grad_W: in x out
+    l.grad_b = alloc_matrix_tag(1, w_out, MEM_GRADS);    // grad_b: 1 x out
+    l.v_W = alloc_matrix_tag(w_in, w_out, MEM_OPTIM); // v_W: in x out
+    l.v_b = alloc_matrix_tag(1, w_out, MEM_OPTIM);    // v_b: 1 x out
+    l.v_act = alloc_matrix_tag(1, 1, MEM_OPTIM);      // v_act placeholder (will be resized below)
+    l.x_cache.rows = 0; l.x_cache.cols = in; l.x_cache.data = NULL; // set by forward
+    l.act = init_act(t, act_dim, strat);
     l.in_dim = in;
     l.out_dim = out;
+    l.sparse_input = 0;
+    l.x_is_sparse = 0;
+    memset(&l.x_sparse, 0, sizeof(l.x_sparse));
+    l.kind = LAYER_DENSE;
+    memset(&l.conv, 0, sizeof(l.conv));
+    l.pool_idx = NULL;
+    l.pool_cap = 0;
+    l.pool_out.rows = 0; l.pool_out.cols = out; l.pool_out.data = NULL;
+    l.stashed = 0;
+    l.x_stash = l.z_stash = NULL;
+    l.x_stash_cap = l.z_stash_cap = 0;
+    l.z_mask = NULL;
+    l.z_mask_cap = 0;
+    l.w_mask = l.b_mask = NULL;
+    l.w_density = 1.0;
+    memset(&l.w_csr, 0, sizeof(l.w_csr));
+    l.w_csr_stale = 1;
+    l.frozen = 0;
     /* initialize act_lr to empty (will be allocated if n_params > 0) */
     l.act_lr.rows = 0; l.act_lr.cols = 0; l.act_lr.data = NULL;
-    mat_rand_xavier(l.W, in);  // Fan-in for W
-    mat_rand_xavier(l.b, out); // Fan-out approx for b
+    mat_rand_xavier(l.W, w_in);  // Fan-in for W
+    mat_rand_xavier(l.b, w_out); // Fan-out approx for b
     mat_scale(l.b, 0.0);       // Bias zero-init
     mat_scale(l.grad_W, 0.0);  // Zero grads
     mat_scale(l.grad_b, 0.0);
@@ -28,16 +53,36 @@ Layer init_layer(int in, int out, ActType t, ActInitStrategy strat)
     if (l.act.n_params > 0)
     {
         free_matrix(l.v_act);
-        l.v_act = alloc_matrix(1, l.act.n_params);
+        l.v_act = alloc_matrix_tag(1, l.act.n_params, MEM_OPTIM);
         mat_scale(l.v_act, 0.0);
         /* Per-parameter learning rate multipliers: default to 1.0 (no scaling) */
-        l.act_lr = alloc_matrix(1, l.act.n_params);
+        l.act_lr = alloc_matrix_tag(1, l.act.n_params, MEM_OPTIM);
         for (int _i = 0; _i < l.act.n_params; ++_i)
             l.act_lr.data[_i] = 1.0;
     }
     return l;
 }
 
+Layer init_layer(int in, int out, ActType t, ActInitStrategy strat)
+{
+    return init_layer_shaped(in, out, in, out, out, t, strat);
+}
+
+Layer init_conv_layer(int in_c, int in_h, int in_w, int out_c, int k, int pad, int pool,
+                      ActType t, ActInitStrategy strat)
+{
+    ConvShape c = {in_c, in_h, in_w, out_c, k, pad, 0, 0, pool < 1 ? 1 : pool, 0, 0};
+    c.conv_h = in_h + 2 * pad - k + 1;
+    c.conv_w = in_w + 2 * pad - k + 1;
+    c.out_h = c.conv_h / c.pool;
+    c.out_w = c.conv_w / c.pool;
+    Layer l = init_layer_shaped(in_c * k * k, out_c, in_c * in_h * in_w, out_c * c.out_h * c.out_w,
+                                out_c * c.conv_h * c.conv_w, t, strat);
+    l.kind = LAYER_CONV;
+    l.conv = c;
+    return l;
+}
+
 void free_layer(Layer *l)
 {
     free_matrix(l->W);
@@ -48,60 +93,242 @@ void free_layer(Layer *l)
     free_matrix(l->v_b);
     free_matrix(l->v_act);
     free_matrix(l->act_lr);
-    free_matrix(l->x_cache);
+    free_sparse(&l->x_sparse);
+    mem_free(l->pool_idx);
+    free_matrix(l->pool_out);
+    mem_free(l->x_stash);
+    mem_free(l->z_stash);
+    mem_free(l->z_mask);
+    free(l->w_mask);
+    free(l->b_mask);
+    free_sparse(&l->w_csr);
     free_act(&l->act);
 }
 
-void layer_forward(Layer *l, Matrix x, Matrix out)
+int layer_w_csr(Layer *l)
 {
-    int batch = x.rows;
-    if (batch > l->x_cache.rows)
+    if (!l->w_mask || l->w_density > PRUNE_CSR_DENSITY)
+        return 0;
+    if (l->w_csr_stale)
+    {
+        sparse_from_dense(&l->w_csr, l->W); // masked weights are exact zeros
+        l->w_csr_stale = 0;
+    }
+    return 1;
+}
+
+// z = x @ W + b for a dense layer (CSR product for mostly-zero inputs or a pruned W)
+static void dense_forward(Layer *l, Matrix x, Matrix z)
+{
+    l->x_is_sparse = l->sparse_input && SPARSE_INPUT_DENSITY > 0 &&
+                     mat_count_nonzero(x) < SPARSE_INPUT_DENSITY * x.rows * x.cols;
+    if (l->x_is_sparse)
+    {
+        sparse_from_dense(&l->x_sparse, x);
+        spmm(l->x_sparse, l->W, z);
+    }
+    else if (layer_w_csr(l))
+    {
+        dense_spmm(x, l->w_csr, z); // only kept weights
+    }
+    else
     {
-        free_matrix(l->x_cache);
-        l->x_cache = alloc_matrix(batch, x.cols);
+        matmul(x, l->W, z); // x (batch x in) @ W (in x out) -> z (batch x out)
     }
-    copy_matrix(l->x_cache, x); // Store full batch x into cache
-    Matrix z = alloc_matrix(batch, l->out_dim);
-    matmul(x, l->W, z);    // x (batch x in) @ W (in x out) -> z (batch x out)
     mat_add_bias(z, l->b); // + b broadcast
-    // Resize act if needed: assume act.z/out alloc max, copy z to act.z (first batch rows)
-    // For simplicity, assume act_forward handles resize or max batch
-    act_forward(&l->act, z);
-    copy_matrix(out, l->act.out);
-    free_matrix(z);
+}
+
+Matrix layer_forward_view(Layer *l, Matrix x)
+{
+    if (l->kind == LAYER_CONV)
+        return conv_forward(l, x);
+    int batch = x.rows;
+    l->x_cache = x; // view: backward reads the caller's input directly
+    l->stashed = 0;
+    act_reserve(&l->act, batch, l->out_dim);
+    Matrix z = {batch, l->out_dim, l->act.z.data}; // pre-activation lives in act.z
+    dense_forward(l, x, z);
+    act_forward(&l->act, z); // in place: act.z -> act.out
+    Matrix out = {batch, l->out_dim, l->act.out.data};
+    return out;
+}
+
+static uint16_t *stash_reserve(uint16_t *p, size_t *cap, size_t n)
+{
+    if (n <= *cap)
+        return p;
+    mem_free(p);
+    p = mem_alloc(n * sizeof(uint16_t), MEM_CACHE);
+    *cap = n;
+    return p;
+}
+
+Matrix layer_forward_stash(Layer *l, Matrix x, mat_t *z_buf, mat_t *out_buf, int stash)
+{
+    int batch = x.rows;
+    size_t n = (size_t)batch * l->out_dim;
+    Matrix z = {batch, l->out_dim, z_buf};
+    l->x_cache = x;
+    dense_forward(l, x, z);
+    act_eval(l->act.type, l->act.params, z_buf, out_buf, (int)n);
+    /* Epilogue: compress what backward needs while z and x are still hot */
+    l->stashed = stash;
+    if (stash & LAYER_STASH_Z)
+    {
+        l->z_stash = stash_reserve(l->z_stash, &l->z_stash_cap, n);
+        bf16_pack(z_buf, l->z_stash, n);
+    }
+    if ((stash & LAYER_STASH_X) && !l->x_is_sparse) // the CSR copy already serves backward
+    {
+        size_t nx = (size_t)batch * l->in_dim;
+        l->x_stash = stash_reserve(l->x_stash, &l->x_stash_cap, nx);
+        bf16_pack(x.data, l->x_stash, nx);
+    }
+    Matrix out = {batch, l->out_dim, out_buf};
+    return out;
+}
+
+Matrix layer_forward_mask(Layer *l, Matrix x, mat_t *z_buf, int stash)
+{
+    int batch = x.rows;
+    size_t n = (size_t)batch * l->out_dim;
+    if (l->act.z.data) // no full-precision z from here on
+    {
+        free_matrix(l->act.z);
+        l->act.z.data = NULL;
+        l->act.z.rows = 0;
+    }
+    if (l->act.out.rows < batch || l->act.out.cols != l->out_dim)
+    {
+        free_matrix(l->act.out);
+        l->act.out = alloc_matrix_tag(batch, l->out_dim, MEM_CACHE);
+    }
+    Matrix z = {batch, l->out_dim, z_buf};
+    l->x_cache = x;
+    dense_forward(l, x, z);
+    l->stashed = 0;
+    if (stash)
+    {
+        size_t bytes = act_mask_bytes(act_mask_bits(&l->act), n);
+        if (bytes > l->z_mask_cap)
+        {
+            mem_free(l->z_mask);
+            l->z_mask = mem_alloc(bytes, MEM_CACHE);
+            l->z_mask_cap = bytes;
+        }
+        act_pack_mask(&l->act, z_buf, l->z_mask, (int)n);
+        l->stashed = LAYER_STASH_MASK;
+    }
+    act_eval(l->act.type, l->act.params, z_buf, l->act.out.data, (int)n);
+    Matrix out = {batch, l->out_dim, l->act.out.data};
+    return out;
+}
+
+void layer_forward(Layer *l, Matrix x, Matrix out)
+{
+    copy_matrix(out, layer_forward_view(l, x));
+}
+
+/* act_backward on the bf16 z stash, decompressed a few rows at a time into
+   an L1-sized tile so the full-precision z never exists as a whole */
+#define STASH_TILE 2048
+static void act_backward_stash(Layer *l, Matrix delta_out, Matrix delta_z)
+{
+    int cols = l->out_dim;
+    int rows_per = STASH_TILE / cols > 0 ? STASH_TILE / cols : 1;
+    mat_t *tile = mem_alloc((size_t)rows_per * cols * sizeof(mat_t), MEM_TEMP);
+    for (int r0 = 0; r0 < delta_out.rows; r0 += rows_per)
+    {
+        int r = delta_out.rows - r0 < rows_per ? delta_out.rows - r0 : rows_per;
+        size_t off = (size_t)r0 * cols;
+        bf16_unpack(l->z_stash + off, tile, (size_t)r * cols);
+        Matrix d_out = {r, cols, delta_out.data + off}, d_z = {r, cols, delta_z.data + off};
+        act_backward_z(&l->act, tile, d_out, d_z);
+    }
+    mem_free(tile);
+}
+
+// out (cols x rows) = transpose of the rows x cols bf16 matrix src
+static void bf16_unpack_transpose(const uint16_t *src, int rows, int cols, Matrix out)
+{
+    mat_t row[STASH_TILE];
+    for (int i = 0; i < rows; ++i)
+        for (int c0 = 0; c0 < cols; c0 += STASH_TILE)
+        {
+            int n = cols - c0 < STASH_TILE ? cols - c0 : STASH_TILE;
+            bf16_unpack(src + (size_t)i * cols + c0, row, (size_t)n);
+            for (int j = 0; j < n; ++j)
+                out.data[(size_t)(c0 + j) * rows + i] = row[j];
+        }
 }
 
 void layer_backward(Layer *l, Matrix delta_out, Matrix delta_in)
 {
+    layer_backward_scaled(l, delta_out, delta_in, 1.0);
+}
+
+void layer_backward_scaled(Layer *l, Matrix delta_out, Matrix delta_in, mat_t gscale)
+{
+    if (l->kind == LAYER_CONV)
+    {
+        conv_backward(l, delta_out, delta_in, gscale);
+        return;
+    }
     int batch = delta_out.rows;
     Matrix delta_z = alloc_matrix(batch, l->out_dim);
-    act_backward(&l->act, delta_out, delta_z);
+    if (l->stashed & LAYER_STASH_Z)
+        act_backward_stash(l, delta_out, delta_z);
+    else if (l->stashed & LAYER_STASH_MASK)
+        act_backward_mask(&l->act, l->z_mask, l->act.out.data, delta_out, delta_z);
+    else
+        act_backward(&l->act, delta_out, delta_z);
 
-    // grad_b = mean(delta_z, axis=0)
-    for (int j = 0; j < l->out_dim; ++j)
+    Matrix xt = {0, 0, NULL}, outer_temp = {0, 0, NULL}, wt = {0, 0, NULL};
+    if (!l->frozen) // frozen W/b (finetune.c): only act grads and delta_in
     {
-        mat_t sum = 0.0;
-        for (int bb = 0; bb < batch; ++bb)
+        // grad_b = mean(delta_z, axis=0)
+        for (int j = 0; j < l->out_dim; ++j)
         {
-            sum += delta_z.data[bb * l->out_dim + j];
+            mat_t sum = 0.0;
+            for (int bb = 0; bb < batch; ++bb)
+            {
+                sum += delta_z.data[bb * l->out_dim + j];
+            }
+            l->grad_b.data[j] += sum / batch * gscale;
         }
-        l->grad_b.data[j] += sum / batch;
-    }
 
-    // grad_W = (x^T @ delta_z) / batch
-    // Transpose only the active top 'batch' rows of x_cache
-    Matrix xcache_view = {batch, l->x_cache.cols, l->x_cache.data};
-    Matrix xt = alloc_matrix(l->in_dim, batch);
-    mat_transpose(xcache_view, xt); // x^T (in x batch)
-    Matrix outer_temp = alloc_matrix(l->in_dim, l->out_dim);
-    matmul(xt, delta_z, outer_temp); // (in x batch) @ (batch x out) -> in x out
-    mat_scale(outer_temp, 1.0 / batch);
-    add_matrix(l->grad_W, outer_temp); // Accum +=
+        // grad_W = (x^T @ delta_z) / batch
+        if (l->x_is_sparse && l->x_sparse.rows == batch)
+        {
+            spmm_tn_accum(l->x_sparse, delta_z, l->grad_W, gscale / batch); // only non-zero rows of grad_W
+        }
+        else
+        {
+            // Transpose only the active top 'batch' rows of x_cache
+            Matrix xcache_view = {batch, l->x_cache.cols, l->x_cache.data};
+            xt = alloc_matrix(l->in_dim, batch);
+            if (l->stashed & LAYER_STASH_X)
+                bf16_unpack_transpose(l->x_stash, batch, l->in_dim, xt); // x^T from the stash
+            else
+                mat_transpose(xcache_view, xt); // x^T (in x batch)
+            outer_temp = alloc_matrix(l->in_dim, l->out_dim);
+            matmul(xt, delta_z, outer_temp); // (in x batch) @ (batch x out) -> in x out
+            mat_scale(outer_temp, gscale / batch);
+            add_matrix(l->grad_W, outer_temp); // Accum +=
+        }
+    }
 
     // delta_in = delta_z @ W^T
-    Matrix wt = alloc_matrix(l->out_dim, l->in_dim);
-    mat_transpose(l->W, wt);       // W^T (out x in)
-    matmul(delta_z, wt, delta_in); // (batch x out) @ (out x in) -> batch x in
+    if (delta_in.data && layer_w_csr(l))
+    {
+        dense_spmm_t(delta_z, l->w_csr, delta_in); // pruned W: sparse dot per input
+    }
+    else if (delta_in.data)
+    {
+        wt = alloc_matrix(l->out_dim, l->in_dim);
+        mat_transpose(l->W, wt);       // W^T (out x in)
+        matmul(delta_z, wt, delta_in); // (batch x out) @ (out x in) -> batch x in
+    }
 
     // Cleanup (delta_z last)
     free_matrix(xt);
@@ -4,25 +4,100 @@
 #include "activations.h"
 #include "utils.h"
 
+typedef enum
+{
+    LAYER_DENSE,
+    LAYER_CONV
+} LayerKind;
+
+/* Geometry of a LAYER_CONV layer. Rows are NCHW samples (c*h*w values).
+   Stride-1 convolution with zero padding, learnable activation applied per
+   feature map element, then optional max-pooling (window = stride = pool). */
+typedef struct
+{
+    int in_c, in_h, in_w;
+    int out_c, k, pad;
+    int conv_h, conv_w; // before pooling (activation runs at this size)
+    int pool;           // 1 = no pooling
+    int out_h, out_w;   // after pooling
+} ConvShape;
+
 typedef struct
 {
-    Matrix W, b, grad_W, grad_b, v_W, v_b, x_cache;
+    Matrix W, b, grad_W, grad_b, v_W, v_b;
+    Matrix x_cache; // view of the last forward input (not owned; see layer_forward_view)
     Matrix v_act; // optimizer velocity for activation params (1 x n_params)
     Matrix act_lr; // per-activation-parameter learning rate multipliers (1 x n_params), default ones
     Activation act;
     int in_dim, out_dim;
+    int sparse_input;     // may use the CSR path for x (set on layer 0 by init_net)
+    int x_is_sparse;      // last forward batch went through x_sparse
+    SparseMatrix x_sparse; // CSR copy of the last forward batch
+    LayerKind kind;
+    ConvShape conv;       // LAYER_CONV only: W is (in_c*k*k) x out_c, b is 1 x out_c
+    int *pool_idx;        // LAYER_CONV with pool > 1: argmax of each pooled output
+    int pool_cap;
+    Matrix pool_out;      // LAYER_CONV with pool > 1: pooled output (batch x out_dim)
+    int stashed;          // LAYER_STASH_* bits of the last forward (0: full-precision caches)
+    uint16_t *x_stash, *z_stash; // bf16 copies of x / z for backward (layer_forward_stash)
+    size_t x_stash_cap, z_stash_cap;
+    unsigned char *z_mask; // act_pack_mask code of z (layer_forward_mask)
+    size_t z_mask_cap;
+    /* Magnitude pruning (prune.c); dense layers only */
+    unsigned char *w_mask; // 1 = kept weight; NULL = not pruned
+    unsigned char *b_mask; // structured pruning: 0 for removed neurons (NULL otherwise)
+    mat_t w_density;       // kept fraction of W under w_mask
+    SparseMatrix w_csr;    // CSR copy of W for PRUNE_CSR_DENSITY layers
+    int w_csr_stale;       // W changed since w_csr was built
+    int frozen;            // W/b fixed: backward skips grad_W/grad_b (finetune.c)
 } Layer;
 
+#define LAYER_STASH_X 1 // keep x as bf16 (else x must stay valid until backward)
+#define LAYER_STASH_Z 2 // keep z as bf16
+#define LAYER_STASH_MASK 4 // keep only z's 1/2-bit act code (act.out stays full precision)
+
 // Init layer: in_dim -> out_dim, act_type
 Layer init_layer(int in, int out, ActType t, ActInitStrategy strat);
 
+// Init conv layer (in_c x in_h x in_w -> out_c maps, k x k kernel, padding pad,
+// max-pool window pool); in_dim/out_dim are the flattened sizes
+Layer init_conv_layer(int in_c, int in_h, int in_w, int out_c, int k, int pad, int pool,
+                      ActType t, ActInitStrategy strat);
+
 // Free
 void free_layer(Layer *l);
 
-// Forward: x (batch x in) -> out (batch x out)
+// Forward without copies: x is kept as a view in x_cache, so it must stay valid
+// until layer_backward; z is computed straight into act.z. Returns a view of the
+// layer's own output buffer (act.out, or pool_out), valid until the next forward.
+Matrix layer_forward_view(Layer *l, Matrix x);
+
+// Dense layers only: forward with z written to z_buf and the output to out_buf
+// (caller scratch, batch x out_dim each, reusable once this returns). The bits
+// of stash choose what backward keeps as bf16; an unstashed x must stay valid
+// as with layer_forward_view. Returns a view of out_buf.
+Matrix layer_forward_stash(Layer *l, Matrix x, mat_t *z_buf, mat_t *out_buf, int stash);
+
+// Dense layers with act_mask_bits > 0 only: like layer_forward_view, but z is
+// written to z_buf (caller scratch, batch x out_dim) and never kept; with
+// stash set backward runs from the bit-packed code of z and act.out. The
+// layer's act.z is released, so it costs 1-2 bits per element instead of 64.
+Matrix layer_forward_mask(Layer *l, Matrix x, mat_t *z_buf, int stash);
+
+// 1 when a pruned layer is sparse enough (PRUNE_CSR_DENSITY) to multiply through
+// w_csr, which is (re)built here if W changed since
+int layer_w_csr(Layer *l);
+
+// Forward: x (batch x in) -> out (batch x out); layer_forward_view plus a copy into out
 void layer_forward(Layer *l, Matrix x, Matrix out);
 
-// Backward: delta_out (batch x out) -> delta_in (batch x in); update grads
+// Backward: delta_out (batch x out) -> delta_in (batch x in); update grads.
+// Pass delta_in with data == NULL to skip the input gradient (first layer).
 void layer_backward(Layer *l, Matrix delta_out, Matrix delta_in);
 
+// Same, but the grad_W/grad_b contributions (batch means) are weighted by gscale.
+// Micro-batching passes m / B so that accumulating B/m micro-batches of m rows
+// reproduces the 1 / B normalization of one logical batch of B rows.
+void layer_backward_scaled(Layer *l, Matrix delta_out, Matrix delta_in, mat_t gscale);
+
 #endif
\ No newline at end of file
@@ -0,0 +1,127 @@
+#define _POSIX_C_SOURCE 200809L
+#include "dist.h"
+#include "synth.h"
+#include "data.h"
+#include "config.h"
+#include <string.h>
+
+/* Data-parallel training across local processes (POSIX only).
+
+     dist.exe [--world N] [--backend shm|socket] [--epochs E] [--batch B] [--mnist]
+
+   Every rank builds the same network from seed 42 and the same dataset, then
+   trains on its dist_shard slice of each global batch of B rows; grads are
+   summed with the ring all-reduce. Rank 0 prints per-epoch loss and, at the
+   end, throughput, test accuracy and how much of the communication was hidden
+   behind backward. --world 1 is the single-process baseline.
+
+   Default data: 20000-row synth spirals, 2->64->64->2. --mnist uses
+   data/mnist_{train,test}.bin and 784->128->64->10. */
+
+typedef struct
+{
+    Matrix x, y, x_test, y_test;
+    int n_arch;
+    int arch[4];
+    int epochs, batch;
+} DistRun;
+
+static int train_rank(DistTransport *t, void *arg)
+{
+    DistRun *run = arg;
+    ActType acts[] = {PRELU, PRELU, PRELU};
+    ActInitStrategy strats[] = {ACT_INIT_DEFAULT, ACT_INIT_DEFAULT, ACT_INIT_IDENTITY};
+    SGD opt = {0.01, 0.9, 0.01, 0.9, 1.0};
+    srand_seed(42); // identical init on every rank
+    Network net = init_net(run->arch[0], run->arch, run->n_arch, acts, strats);
+    DistTrainer d;
+    dist_trainer_init(&d, t, &net);
+
+    int n = run->x.rows, B = run->batch;
+    double t0 = wall_seconds(), c0 = cpu_seconds();
+    for (int e = 0; e < run->epochs; ++e)
+    {
+        mat_t epoch_loss = 0.0;
+        for (int start = 0; start < n; start += B)
+        {
+            int rows = n - start < B ? n - start : B, s0, m;
+            dist_shard(rows, t->rank, t->world, &s0, &m);
+            Matrix xs = {m, run->x.cols, run->x.data + (size_t)(start + s0) * run->x.cols};
+            Matrix ys = {m, run->y.cols, run->y.data + (size_t)(start + s0) * run->y.cols};
+            epoch_loss += dist_train_step(&d, xs, ys, &opt, 1, rows) * rows;
+        }
+        if (t->rank == 0)
+            printf("[DIST] epoch %d: loss %.4f\n", e, epoch_loss / n);
+    }
+    double secs = wall_seconds() - t0, cpu = cpu_seconds() - c0;
+    if (t->rank == 0)
+    {
+        printf("[DIST] world %d (%s): %.2f s, %.0f samples/s, test acc %.4f\n", t->world, t->name, secs,
+               (double)run->epochs * n / secs, eval_acc(&net, run->x_test, run->y_test));
+        printf("[DIST] rank 0: cpu %.2f s, all-reduce %.3f s on the comm thread, %.3f s exposed after backward\n",
+               cpu, d.comm_seconds, d.wait_seconds);
+        fflush(stdout);
+    }
+    dist_trainer_free(&d);
+    free_net(&net);
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    int world = 2, mnist = 0;
+    DistBackend backend = DIST_SHM;
+    DistRun run = {{0}, {0}, {0}, {0}, 4, {2, 64, 64, 2}, 5, 64};
+    for (int i = 1; i < argc; ++i)
+    {
+        int has_val = i + 1 < argc;
+        if (strcmp(argv[i], "--world") == 0 && has_val)
+            world = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--backend") == 0 && has_val && dist_backend_from_name(argv[i + 1], &backend))
+            ++i;
+        else if (strcmp(argv[i], "--epochs") == 0 && has_val)
+            run.epochs = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--batch") == 0 && has_val)
+            run.batch = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--mnist") == 0)
+            mnist = 1;
+        else
+        {
+            fprintf(stderr, "Usage: %s [--world N] [--backend shm|socket] [--epochs E] [--batch B] [--mnist]\n",
+                    argv[0]);
+            return 1;
+        }
+    }
+    config_set_flat_storage(1); // the trainer reduces slab spans
+
+    if (mnist)
+    {
+        int arch[] = {784, 128, 64, 10};
+        memcpy(run.arch, arch, sizeof(arch));
+        if (!load_data("data/mnist_train.bin", &run.x, &run.y) ||
+            !load_data("data/mnist_test.bin", &run.x_test, &run.y_test))
+        {
+            fprintf(stderr, "Failed to load data/mnist_{train,test}.bin\n");
+            return 1;
+        }
+    }
+    else
+    {
+        SynthSpec train = {SYNTH_SPIRALS, 20000, 2, 2, 0.1, 42}, test = {SYNTH_SPIRALS, 4000, 2, 2, 0.1, 43};
+        synth_generate(&train, &run.x, &run.y, 1);
+        synth_generate(&test, &run.x_test, &run.y_test, 1);
+    }
+    printf("[DIST] %d ranks over %s, %d train rows, global batch %d, %d epochs\n", world,
+           dist_backend_name(backend), run.x.rows, run.batch, run.epochs);
+    int ok = dist_launch(world, backend, train_rank, &run);
+    free_matrix(run.x);
+    free_matrix(run.y);
+    free_matrix(run.x_test);
+    free_matrix(run.y_test);
+    if (!ok)
+    {
+        fprintf(stderr, "A rank failed\n");
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,121 @@
+#define _POSIX_C_SOURCE 200809L
+#include "synth.h"
+#include "data.h"
+#include "network.h"
+#include "optimizer.h"
+#include <string.h>
+#ifndef _WIN32
+#include <unistd.h>
+#endif
+
+/* Synthetic dataset generator: writes the load_data binary format in parallel
+   chunks, so sizes are bounded by disk rather than memory.
+
+     gen_data.exe <spirals|moons|xor|blobs> <n_rows> <out.bin> [--classes K]
+                  [--dim D] [--noise S] [--seed N] [--threads T] [--bench]
+
+   --bench then loads the file back (load_data throughput) and trains one epoch
+   of a D->64->K MLP on it (train_step throughput); it needs the data in RAM. */
+
+static void usage(const char *prog)
+{
+    fprintf(stderr,
+            "Usage: %s <spirals|moons|xor|blobs> <n_rows> <out.bin> [--classes K] [--dim D] [--noise S] "
+            "[--seed N] [--threads T] [--bench]\n",
+            prog);
+}
+
+static void bench(const char *path, const SynthSpec *spec)
+{
+    double t0 = wall_seconds();
+    Matrix X, Y;
+    if (!load_data(path, &X, &Y))
+    {
+        fprintf(stderr, "Failed to load %s\n", path);
+        return;
+    }
+    double t_load = wall_seconds() - t0;
+    printf("[GEN] load_data: %.2f s, %.0f rows/s, %.1f MB/s\n", t_load, X.rows / t_load,
+           ((double)X.rows * (X.cols + 1) * sizeof(mat_t)) / 1e6 / t_load);
+
+    int arch[] = {spec->dim, 64, spec->classes};
+    ActType acts[] = {POLY_CUBIC, POLY_CUBIC};
+    ActInitStrategy strats[] = {ACT_INIT_RANDOM_SMALL, ACT_INIT_IDENTITY};
+    Network net = init_net(spec->dim, arch, 3, acts, strats);
+    SGD opt = {0.01, 0.9, 0.01, 0.9, 1.0};
+    int bs = 128;
+    mat_t loss = 0.0;
+    t0 = wall_seconds();
+    for (int start = 0; start < X.rows; start += bs)
+    {
+        int m = X.rows - start < bs ? X.rows - start : bs;
+        Matrix xb = {m, X.cols, X.data + (size_t)start * X.cols};
+        Matrix yb = {m, 1, Y.data + start};
+        loss += train_step(&net, xb, yb, &opt, 1) * m;
+    }
+    double t_train = wall_seconds() - t0;
+    printf("[GEN] train_step (batch %d, %d->64->%d): %.2f s, %.0f samples/s, mean loss %.4f, acc %.4f\n", bs,
+           spec->dim, spec->classes, t_train, X.rows / t_train, loss / X.rows, eval_acc(&net, X, Y));
+    free_net(&net);
+    free_matrix(X);
+    free_matrix(Y);
+}
+
+int main(int argc, char **argv)
+{
+    if (argc < 4)
+    {
+        usage(argv[0]);
+        return 1;
+    }
+    SynthSpec spec = {SYNTH_SPIRALS, atol(argv[2]), 2, 2, 0.1, 42};
+    if (!synth_kind_from_name(argv[1], &spec.kind))
+    {
+        usage(argv[0]);
+        return 1;
+    }
+    const char *path = argv[3];
+#ifdef _WIN32
+    int threads = 1;
+#else
+    long cores = sysconf(_SC_NPROCESSORS_ONLN);
+    int threads = cores > 0 ? (int)cores : 1;
+#endif
+    int do_bench = 0;
+    for (int i = 4; i < argc; ++i)
+    {
+        int has_val = i + 1 < argc;
+        if (strcmp(argv[i], "--classes") == 0 && has_val)
+            spec.classes = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--dim") == 0 && has_val)
+            spec.dim = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--noise") == 0 && has_val)
+            spec.noise = atof(argv[++i]);
+        else if (strcmp(argv[i], "--seed") == 0 && has_val)
+            spec.seed = strtoull(argv[++i], NULL, 10);
+        else if (strcmp(argv[i], "--threads") == 0 && has_val)
+            threads = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--bench") == 0)
+            do_bench = 1;
+        else
+        {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+
+    double t0 = wall_seconds();
+    if (!synth_write(&spec, path, threads))
+    {
+        fprintf(stderr, "Failed to write %s\n", path);
+        return 1;
+    }
+    double secs = wall_seconds() - t0;
+    double mb = ((double)spec.n * (spec.dim + 1) * sizeof(mat_t) + 3 * sizeof(int)) / 1e6;
+    printf("[GEN] %s: %ld rows x %d features, %d classes, noise %.3f, seed %llu -> %s\n", synth_kind_name(spec.kind),
+           spec.n, spec.dim, spec.classes, spec.noise, (unsigned long long)spec.seed, path);
+    printf("[GEN] %d threads: %.2f s, %.0f rows/s, %.1f MB/s (%.1f MB)\n", threads, secs, spec.n / secs, mb / secs, mb);
+    if (do_bench)
+        bench(path, &spec);
+    return 0;
+}
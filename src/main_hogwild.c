@@ -0,0 +1,111 @@
+#define _POSIX_C_SOURCE 200809L
+#include "hogwild.h"
+#include "synth.h"
+#include "data.h"
+#include "config.h"
+#include <string.h>
+#ifndef _WIN32
+#include <unistd.h>
+#endif
+
+/* Hogwild scaling: trains the same model from the same init with 1, 2, 4, ...
+   worker threads (up to --threads, default the core count) and reports
+   throughput, speedup over one thread and the final accuracy.
+
+     hogwild.exe [--threads T] [--epochs E] [--spirals-only | --mnist-only]
+
+   spirals: 20000-row synth spirals, 2->64->64->2 POLY_CUBIC, batch 16.
+   mnist:   data/mnist_{train,test}.bin (skipped if missing), 784->128->64->10, batch 32. */
+
+typedef struct
+{
+    const char *name;
+    Matrix x, y, x_test, y_test;
+    int n_arch;
+    int arch[4];
+    int batch_size;
+} HogwildBench;
+
+static void run(HogwildBench *b, int max_threads, int epochs)
+{
+    SGD opt = {0.01, 0.9, 0.01, 0.9, 1.0};
+    ActType acts[] = {PRELU, PRELU, POLY_CUBIC};
+    ActInitStrategy strats[] = {ACT_INIT_DEFAULT, ACT_INIT_DEFAULT, ACT_INIT_IDENTITY};
+    double base = 0.0;
+    printf("[HOGWILD] %s: %d train rows, batch %d, %d epochs\n", b->name, b->x.rows, b->batch_size, epochs);
+    printf("[HOGWILD]   %7s %12s %8s %10s %10s\n", "threads", "samples/s", "speedup", "loss", "test acc");
+    for (int t = 1; t <= max_threads; t *= 2)
+    {
+        srand_seed(42); // same init and batch order for every thread count
+        Network net = init_net(b->arch[0], b->arch, b->n_arch, acts, strats);
+        Hogwild h = hogwild_init(&net, t);
+        mat_t loss = 0.0;
+        double t0 = wall_seconds();
+        for (int e = 0; e < epochs; ++e)
+            loss = hogwild_epoch(&h, b->x, b->y, &opt, 1, b->batch_size);
+        double secs = wall_seconds() - t0;
+        double rate = (double)epochs * b->x.rows / secs;
+        if (t == 1)
+            base = rate;
+        printf("[HOGWILD]   %7d %12.0f %7.2fx %10.4f %10.4f\n", t, rate, rate / base, loss,
+               eval_acc(&net, b->x_test, b->y_test));
+        hogwild_free(&h);
+        free_net(&net);
+    }
+}
+
+int main(int argc, char **argv)
+{
+#ifdef _WIN32
+    int max_threads = 1;
+#else
+    long cores = sysconf(_SC_NPROCESSORS_ONLN);
+    int max_threads = cores > 0 ? (int)cores : 1;
+#endif
+    int epochs = 5, do_spirals = 1, do_mnist = 1;
+    for (int i = 1; i < argc; ++i)
+    {
+        if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc)
+            max_threads = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--epochs") == 0 && i + 1 < argc)
+            epochs = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--spirals-only") == 0)
+            do_mnist = 0;
+        else if (strcmp(argv[i], "--mnist-only") == 0)
+            do_spirals = 0;
+        else
+        {
+            fprintf(stderr, "Usage: %s [--threads T] [--epochs E] [--spirals-only | --mnist-only]\n", argv[0]);
+            return 1;
+        }
+    }
+    config_set_flat_storage(1); // workers share the params slab
+
+    if (do_spirals)
+    {
+        HogwildBench b = {"spirals", {0}, {0}, {0}, {0}, 4, {2, 64, 64, 2}, 16};
+        SynthSpec train = {SYNTH_SPIRALS, 20000, 2, 2, 0.1, 42}, test = {SYNTH_SPIRALS, 4000, 2, 2, 0.1, 43};
+        synth_generate(&train, &b.x, &b.y, 1);
+        synth_generate(&test, &b.x_test, &b.y_test, 1);
+        run(&b, max_threads, epochs);
+        free_matrix(b.x);
+        free_matrix(b.y);
+        free_matrix(b.x_test);
+        free_matrix(b.y_test);
+    }
+    if (do_mnist)
+    {
+        HogwildBench b = {"mnist", {0}, {0}, {0}, {0}, 4, {784, 128, 64, 10}, 32};
+        if (!load_data("data/mnist_train.bin", &b.x, &b.y) || !load_data("data/mnist_test.bin", &b.x_test, &b.y_test))
+        {
+            printf("[HOGWILD] mnist: data/mnist_{train,test}.bin not found, skipped\n");
+            return 0;
+        }
+        run(&b, max_threads, epochs);
+        free_matrix(b.x);
+        free_matrix(b.y);
+        free_matrix(b.x_test);
+        free_matrix(b.y_test);
+    }
+    return 0;
+}
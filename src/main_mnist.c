@@ -2,10 +2,21 @@
 #include "data.h"
 #include "optimizer.h"
 #include "utils.h"
+#include "config.h"
+#include "quant.h"
+#include "async_eval.h"
+#include "tune.h"
+#include "prune.h"
+#include "fold.h"
+#include "finetune.h"
+#include "bench.h"
+#include <string.h>
 
-int main()
+int main(int argc, char **argv)
 {
     srand_seed(42);                             // Seed 0 (first of 5: 42-46)
+    config_set_flat_storage(1);                 // Params/grads/velocities in contiguous slabs
+    config_set_act_mem_budget(8L << 20);        // <= 8 MB of activations per step/eval chunk
     int arch[] = {784, 256, 128, 10};           // MNIST: 28x28=784 in, 10 classes out
      /* Provide one activation per dense layer (hidden1, hidden2, output).
          Previously only two were provided which caused the final layer's
@@ -35,6 +46,43 @@ int main()
         return 1;
     }
 
+    /* --autotune: pick batch size, matmul blocking and threads for this
+       machine (cached per CPU + arch in TUNE_CACHE_FILE) */
+    int batch_size = 32;
+    int use_autotune = 0, prune_mode = -1, finetune = 0;
+    ActType finetune_act = PIECEWISE;
+    for (int i = 1; i < argc; ++i)
+    {
+        if (strcmp(argv[i], "--autotune") == 0)
+            use_autotune = 1;
+        else if (strcmp(argv[i], "--prune") == 0)
+            prune_mode = PRUNE_UNSTRUCTURED;
+        else if (strcmp(argv[i], "--prune-structured") == 0)
+            prune_mode = PRUNE_STRUCTURED;
+        else if (strcmp(argv[i], "--mem") == 0)
+            config_set_mem_log(1); // [MEM] line per epoch and a table at the end
+        else if (strcmp(argv[i], "--bench") == 0)
+            config_set_bench_log(1); // timings per epoch in the results CSV, [BENCH] at the end
+        else if (strcmp(argv[i], "--act-finetune") == 0 && i + 1 < argc)
+        {
+            finetune = act_type_from_name(argv[++i], &finetune_act); // e.g. PIECEWISE, PRELU
+            if (!finetune)
+                fprintf(stderr, "Unknown activation %s for --act-finetune\n", argv[i]);
+        }
+    }
+    if (use_autotune)
+    {
+        int batch_cands[] = {16, 32, 64, 128};
+        batch_size = autotune(&net, X_train, Y_train, 1, batch_cands, 4, TUNE_CACHE_FILE).batch_size;
+    }
+    else
+    {
+        TuneConfig cur = tune_current(batch_size);
+        tune_print("defaults", &cur);
+    }
+
+    printf("Input density: %.3f (sparse first-layer path below %.2f)\n", data_density(X_train), SPARSE_INPUT_DENSITY);
+
     // Logging setup
     char logf[256];
     sprintf(logf, "experiments/results/mnist_poly_%d.csv", 42);
@@ -67,18 +115,34 @@ int main()
             }
         }
     }
-    log_csv_header(logf, total_params, names);
+    /* Test accuracy per epoch comes from a background evaluator working on
+       weight snapshots; it writes the results CSV (with a test_acc column) */
+    AsyncEval ev;
+    int async_ok = async_eval_start(&ev, &net, X_test, Y_test, logf, total_params, names);
+    if (!async_ok)
+        log_csv_header(logf, total_params, names);
     if (names) { for (int i = 0; i < total_params; ++i) free((void*)names[i]); free(names); }
 
     // Batch training
-    int batch_size = 32;
     int n_samples = X_train.rows;                              // 10k subset
     int n_batches = (n_samples + batch_size - 1) / batch_size; // Ceiling
     // Training epochs (increase for real runs)
-    for (int e = 0; e < 10; ++e)
+    int n_epochs = 10;
+    /* --prune / --prune-structured: ramp per-layer sparsity from epoch 1 to 7,
+       re-masking four times per epoch; the output layer stays lightly pruned */
+    const mat_t unstructured_target[] = {0.9, 0.9, 0.5};
+    const mat_t structured_target[] = {0.5, 0.5, 0.0};
+    PruneSchedule prune_sched = {(PruneMode)prune_mode,
+                                 prune_mode == PRUNE_STRUCTURED ? structured_target : unstructured_target,
+                                 1 * n_batches, 7 * n_batches, n_batches / 4};
+    int step = 0;
+    BenchClock clock;
+    bench_init(&clock);
+    for (int e = 0; e < n_epochs; ++e)
     {
         mat_t epoch_loss = 0.0;
         mat_t epoch_acc = 0.0;
+        bench_epoch_begin(&clock);
         for (int b = 0; b < n_batches; ++b)
         {
             // Extract batch
@@ -92,10 +156,16 @@ int main()
 
             // Train step (CE=1 for multi-class)
             mat_t loss = train_step(&net, X_batch, Y_batch, &opt, 1);
+            if (prune_mode >= 0)
+                prune_step(&net, &prune_sched, step);
+            ++step;
             epoch_loss += loss * curr_batch_size; // Weighted sum
+            bench_pause(&clock); // train accuracy is reporting, not training
             mat_t acc = eval_acc(&net, X_batch, Y_batch);
             epoch_acc += acc * curr_batch_size;
+            bench_resume(&clock);
         }
+        bench_epoch_end(&clock, n_samples);
         epoch_loss /= n_samples;
         epoch_acc /= n_samples;
 
@@ -116,18 +186,56 @@ int main()
                     params[idx++] = p[j];
             }
         }
-        log_csv(logf, e, epoch_loss, epoch_acc, tp, params);
+        if (async_ok)
+        {
+            async_eval_submit(&ev, &net, e); // snapshot; evaluation overlaps the next epoch
+            async_eval_log(&ev, e, epoch_loss, epoch_acc, tp, params);
+        }
+        else
+        {
+            log_csv(logf, e, epoch_loss, epoch_acc, tp, params);
+        }
         if (params) free(params);
         if (e % 10 == 0)
         {
             printf("Epoch %d: loss=%.4f train_acc=%.4f\n", e, epoch_loss, epoch_acc);
         }
+        mem_log_epoch(e);
         // Note: early stopping removed to allow full epoch runs for analysis
     }
 
-    // Evaluate on test set
-    mat_t test_acc = eval_acc(&net, X_test, Y_test);
+    // Evaluate on test set (the last snapshot is the final network)
+    mat_t test_acc = async_ok ? async_eval_wait(&ev, n_epochs - 1) : eval_acc(&net, X_test, Y_test);
     printf("Final test accuracy: %.4f\n", test_acc);
+    if (BENCH_LOG)
+        bench_report(&clock, "mnist");
+    if (MEM_LOG)
+        mem_report("after training and test evaluation");
+    if (async_ok)
+        async_eval_finish(&ev);
+
+    if (prune_mode >= 0)
+    {
+        prune_finalize(&net);
+        prune_report(&net);
+        if (prune_mode == PRUNE_STRUCTURED)
+        {
+            Network small = prune_shrink(&net);
+            printf("[PRUNE] shrunk network: test accuracy %.4f (%d->%d->%d->%d)\n", eval_acc(&small, X_test, Y_test),
+                   small.input_dim, small.layers[0].out_dim, small.layers[1].out_dim, small.layers[2].out_dim);
+            free_net(&small);
+        }
+    }
+
+    // Int8 serving path: calibrate on the first 1000 training rows
+    Matrix calib = {X_train.rows < 1000 ? X_train.rows : 1000, X_train.cols, X_train.data};
+    quant_report(&net, calib, X_test, Y_test);
+    // Merge layers whose learned activation is linear over the calibration z range
+    fold_report(&net, calib, X_test, Y_test, FOLD_TOL);
+    /* --act-finetune TYPE: freeze the trained W/b, swap the hidden acts to TYPE
+       and re-learn only the act params from a cached layer-0 z */
+    if (finetune)
+        finetune_report(&net, finetune_act, X_train, Y_train, X_test, Y_test, 5, batch_size, &opt);
 
     // Cleanup
     free_net(&net);
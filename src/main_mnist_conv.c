@@ -0,0 +1,93 @@
+#include "network.h"
+#include "data.h"
+#include "optimizer.h"
+#include "utils.h"
+#include "config.h"
+
+// Multiply-adds per sample x 2 (conv: every conv output element, dense: W)
+static long layer_flops(Layer *l)
+{
+    if (l->kind == LAYER_CONV)
+        return 2L * l->W.rows * l->W.cols * l->conv.conv_h * l->conv.conv_w;
+    return 2L * l->W.rows * l->W.cols;
+}
+
+static long net_flops(Network *net, long *params)
+{
+    long f = 0;
+    *params = 0;
+    for (int i = 0; i < net->n_layers; ++i)
+    {
+        Layer *l = &net->layers[i];
+        f += layer_flops(l);
+        *params += (long)l->W.rows * l->W.cols + l->b.cols + l->act.n_params;
+    }
+    return f;
+}
+
+int main()
+{
+    srand_seed(42);
+    config_set_flat_storage(1);
+    config_set_act_mem_budget(8L << 20);
+    /* 1x28x28 -> conv3x3(8)+pool2 -> 8x14x14 -> conv3x3(16)+pool2 -> 16x7x7 -> dense 10 */
+    Layer layers[3];
+    layers[0] = init_conv_layer(1, 28, 28, 8, 3, 1, 2, POLY_CUBIC, ACT_INIT_RANDOM_SMALL);
+    layers[1] = init_conv_layer(8, 14, 14, 16, 3, 1, 2, POLY_CUBIC, ACT_INIT_RANDOM_SMALL);
+    layers[2] = init_layer(16 * 7 * 7, 10, POLY_CUBIC, ACT_INIT_IDENTITY);
+    Network net = init_net_layers(784, layers, 3);
+    SGD opt = {0.01, 0.9, 0.01, 0.9, 1.0};
+
+    // Same-budget reference: the MLP of main_mnist.c (784->256->128->10)
+    long conv_params, mlp_params = 784L * 256 + 256 + 256L * 128 + 128 + 128L * 10 + 10;
+    long conv_flops = net_flops(&net, &conv_params);
+    long mlp_flops = 2L * (784L * 256 + 256L * 128 + 128L * 10);
+    printf("Conv net: %ld params, %ld FLOPs/sample | MLP: %ld params, %ld FLOPs/sample\n",
+           conv_params, conv_flops, mlp_params, mlp_flops);
+
+    Matrix X_train, Y_train;
+    if (!load_data("data/mnist_train.bin", &X_train, &Y_train))
+    {
+        fprintf(stderr, "Failed to load mnist_train.bin\n");
+        free_net(&net);
+        return 1;
+    }
+    Matrix X_test, Y_test;
+    if (!load_data("data/mnist_test.bin", &X_test, &Y_test))
+    {
+        fprintf(stderr, "Failed to load mnist_test.bin\n");
+        free_matrix(X_train);
+        free_matrix(Y_train);
+        free_net(&net);
+        return 1;
+    }
+
+    char logf[256];
+    sprintf(logf, "experiments/results/mnist_conv_poly_%d.csv", 42);
+    log_csv_header(logf, 0, NULL);
+
+    int batch_size = 32;
+    int n_samples = X_train.rows;
+    for (int e = 0; e < 10; ++e)
+    {
+        mat_t epoch_loss = 0.0;
+        for (int start = 0; start < n_samples; start += batch_size)
+        {
+            int m = start + batch_size < n_samples ? batch_size : n_samples - start;
+            Matrix X_batch = {m, X_train.cols, X_train.data + (size_t)start * X_train.cols};
+            Matrix Y_batch = {m, Y_train.cols, Y_train.data + (size_t)start * Y_train.cols};
+            epoch_loss += train_step(&net, X_batch, Y_batch, &opt, 1) * m;
+        }
+        epoch_loss /= n_samples;
+        mat_t acc = eval_acc(&net, X_test, Y_test);
+        log_csv(logf, e, epoch_loss, acc, 0, NULL);
+        printf("Epoch %d: loss=%.4f test_acc=%.4f\n", e, epoch_loss, acc);
+    }
+
+    free_net(&net);
+    free_matrix(X_train);
+    free_matrix(Y_train);
+    free_matrix(X_test);
+    free_matrix(Y_test);
+    return 0;
+}
@@ -0,0 +1,99 @@
+#include "pipeline.h"
+#include "synth.h"
+#include <string.h>
+
+/* Pipeline-parallel throughput: a deep MLP trained with train_step and then
+   with 1, 2, 4, ... stages (up to --stages) from the same init.
+
+     pipeline.exe [--stages S] [--micro M] [--depth D] [--width W] [--epochs E] [--batch B]
+
+   Data: 4096-row synth blobs, 64 features, 10 classes. */
+
+int main(int argc, char **argv)
+{
+    int max_stages = 4, n_micro = 8, depth = 6, width = 128, epochs = 2, bs = 128;
+    for (int i = 1; i < argc; ++i)
+    {
+        int has_val = i + 1 < argc;
+        if (strcmp(argv[i], "--stages") == 0 && has_val)
+            max_stages = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--micro") == 0 && has_val)
+            n_micro = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--depth") == 0 && has_val)
+            depth = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--width") == 0 && has_val)
+            width = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--epochs") == 0 && has_val)
+            epochs = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--batch") == 0 && has_val)
+            bs = atoi(argv[++i]);
+        else
+        {
+            fprintf(stderr, "Usage: %s [--stages S] [--micro M] [--depth D] [--width W] [--epochs E] [--batch B]\n",
+                    argv[0]);
+            return 1;
+        }
+    }
+    if (depth < 1 || depth > 62)
+    {
+        fprintf(stderr, "--depth must be in 1..62\n");
+        return 1;
+    }
+    SynthSpec spec = {SYNTH_BLOBS, 4096, 10, 64, 2.0, 42};
+    Matrix X, Y;
+    synth_generate(&spec, &X, &Y, 1);
+
+    /* 64 -> width x depth -> 10 */
+    int arch[64];
+    ActType acts[63];
+    ActInitStrategy strats[63];
+    arch[0] = spec.dim;
+    for (int i = 1; i <= depth; ++i)
+        arch[i] = width;
+    arch[depth + 1] = spec.classes;
+    for (int i = 0; i <= depth; ++i)
+    {
+        acts[i] = PRELU;
+        strats[i] = i < depth ? ACT_INIT_DEFAULT : ACT_INIT_IDENTITY;
+    }
+    SGD opt = {0.01, 0.9, 0.01, 0.9, 1.0};
+    printf("[PIPE] %d-%dx%d-%d MLP, %d rows, batch %d, %d micro-batches, %d epochs\n", spec.dim, width, depth,
+           spec.classes, X.rows, bs, n_micro, epochs);
+
+    double base = 0.0;
+    for (int stages = 0; stages <= max_stages; stages = stages ? stages * 2 : 1)
+    {
+        srand_seed(42);
+        Network net = init_net(spec.dim, arch, depth + 2, acts, strats);
+        Pipeline p;
+        if (stages)
+            pipeline_init(&p, &net, stages, n_micro);
+        mat_t loss = 0.0;
+        double t0 = wall_seconds();
+        for (int e = 0; e < epochs; ++e)
+        {
+            loss = 0.0;
+            for (int start = 0; start < X.rows; start += bs)
+            {
+                int m = X.rows - start < bs ? X.rows - start : bs;
+                Matrix xb = {m, X.cols, X.data + (size_t)start * X.cols}, yb = {m, 1, Y.data + start};
+                loss += (stages ? pipeline_train_step(&p, xb, yb, &opt, 1) : train_step(&net, xb, yb, &opt, 1)) * m;
+            }
+        }
+        double rate = (double)epochs * X.rows / (wall_seconds() - t0);
+        base = stages ? base : rate;
+        if (stages)
+            pipeline_report(&p);
+        char label[32] = "train_step";
+        if (stages)
+            snprintf(label, sizeof(label), "%d stages", p.n_stages);
+        printf("[PIPE] %-10s %10.0f samples/s %6.2fx  loss %.4f  acc %.4f\n", label, rate, rate / base,
+               loss / X.rows, eval_acc(&net, X, Y));
+        if (stages)
+            pipeline_free(&p);
+        free_net(&net);
+    }
+    free_matrix(X);
+    free_matrix(Y);
+    return 0;
+}
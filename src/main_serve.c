@@ -0,0 +1,349 @@
+#define _POSIX_C_SOURCE 200809L
+#include "infer.h"
+#include "prune.h"
+#include "utils.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <math.h>
+#include <poll.h>
+#include <signal.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <time.h>
+#include <unistd.h>
+
+/* Inference server: loads a checkpoint (save_net) and answers feature vectors
+   over a Unix domain socket, coalescing requests from all clients into
+   micro-batches of at most max_batch rows. A batch runs as soon as it is full
+   or its oldest request has waited budget_us.
+
+   Usage: serve.exe <checkpoint> <socket_path> [max_batch=64] [budget_us=1000]
+
+   Protocol (native byte order, one connection per client):
+     on accept   server -> client  int32 {input_dim, out_dim}
+     request     client -> server  input_dim doubles (may be pipelined)
+     response    server -> client  out_dim doubles, in request order
+   Client sockets are non-blocking: responses go to a per-client output buffer
+   that is flushed as the socket accepts them (POLLOUT), so a client that stops
+   reading only stalls itself. Past SERVE_MAX_BACKLOG unsent bytes the server
+   stops reading that client's requests until it catches up.
+   Latency (arrival -> response handed to the socket or queued) p50/p99 and
+   throughput are printed every SERVE_REPORT_S seconds of activity and on
+   SIGINT/SIGTERM. */
+
+#define SERVE_MAX_CLIENTS 256
+#define SERVE_REPORT_S 5.0
+#define SERVE_MAX_BACKLOG (1 << 20) // unsent response bytes per client
+
+typedef struct
+{
+    int fd; // -1: free slot
+    size_t fill;
+    unsigned char *buf; // one partially received request
+    unsigned char *out; // responses not yet accepted by the socket: out[off..len)
+    size_t off, len, cap;
+} Client;
+
+typedef struct
+{
+    int client; // slot, -1 once the client has gone away
+    double t_arrive;
+} Pending;
+
+typedef struct
+{
+    double *v;
+    int n, cap;
+} LatencyLog;
+
+static volatile sig_atomic_t stop_flag = 0;
+
+static void on_signal(int sig)
+{
+    (void)sig;
+    stop_flag = 1;
+}
+
+static double now_us(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+static void queue_out(Client *c, const void *p, size_t n)
+{
+    if (c->off > 0) // drop what has been sent
+    {
+        memmove(c->out, c->out + c->off, c->len - c->off);
+        c->len -= c->off;
+        c->off = 0;
+    }
+    if (c->len + n > c->cap)
+    {
+        size_t cap = c->cap ? c->cap : 4096;
+        while (cap < c->len + n)
+            cap *= 2;
+        unsigned char *q = realloc(c->out, cap);
+        if (!q)
+        {
+            fprintf(stderr, "Alloc fail\n");
+            exit(1);
+        }
+        c->out = q;
+        c->cap = cap;
+    }
+    memcpy(c->out + c->len, p, n);
+    c->len += n;
+}
+
+// Write queued output until the socket would block; 0 when the client is gone
+static int flush_out(Client *c)
+{
+    while (c->off < c->len)
+    {
+        ssize_t w = write(c->fd, c->out + c->off, c->len - c->off);
+        if (w < 0 && errno == EINTR)
+            continue;
+        if (w < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+            return 1; // rest goes out on POLLOUT
+        if (w <= 0)
+            return 0;
+        c->off += (size_t)w;
+    }
+    c->off = c->len = 0;
+    return 1;
+}
+
+static void log_latency(LatencyLog *l, double us)
+{
+    if (l->n == l->cap)
+    {
+        l->cap = l->cap ? 2 * l->cap : 4096;
+        l->v = realloc(l->v, l->cap * sizeof(double));
+    }
+    l->v[l->n++] = us;
+}
+
+static void report(const char *tag, LatencyLog *l, double seconds, long batches)
+{
+    if (l->n == 0)
+        return;
+    int n = l->n;
+    double p50 = percentile(l->v, n, 0.50), p99 = percentile(l->v, n, 0.99);
+    printf("[SERVE] %s: %d req in %.2fs (%.0f req/s), p50=%.1fus p99=%.1fus, mean batch %.1f\n",
+           tag, n, seconds, n / seconds, p50, p99, batches > 0 ? (double)n / batches : 0.0);
+    fflush(stdout);
+}
+
+static void close_client(Client *clients, int slot, Pending *pending, int n_pending)
+{
+    close(clients[slot].fd);
+    clients[slot].fd = -1;
+    clients[slot].fill = 0;
+    clients[slot].off = clients[slot].len = 0;
+    for (int i = 0; i < n_pending; ++i)
+        if (pending[i].client == slot)
+            pending[i].client = -1; // its responses are dropped
+}
+
+int main(int argc, char **argv)
+{
+    if (argc < 3)
+    {
+        fprintf(stderr, "Usage: %s <checkpoint> <socket_path> [max_batch] [budget_us]\n", argv[0]);
+        return 1;
+    }
+    int max_batch = argc > 3 ? atoi(argv[3]) : 64;
+    double budget_us = argc > 4 ? atof(argv[4]) : 1000.0;
+    if (max_batch < 1)
+        max_batch = 1;
+
+    Network net;
+    if (!load_net(argv[1], &net))
+        return 1;
+    prune_finalize(&net); // pruned checkpoints serve through the CSR kernels
+    int in_dim = net.input_dim, out_dim = net.layers[net.n_layers - 1].out_dim;
+    size_t req_bytes = (size_t)in_dim * sizeof(mat_t), resp_bytes = (size_t)out_dim * sizeof(mat_t);
+    InferCtx ctx = infer_ctx_init(&net, max_batch);
+
+    int lfd = socket(AF_UNIX, SOCK_STREAM, 0);
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strncpy(addr.sun_path, argv[2], sizeof(addr.sun_path) - 1);
+    unlink(argv[2]);
+    if (lfd < 0 || bind(lfd, (struct sockaddr *)&addr, sizeof(addr)) != 0 || listen(lfd, 64) != 0)
+    {
+        fprintf(stderr, "serve: cannot listen on %s: %s\n", argv[2], strerror(errno));
+        return 1;
+    }
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = on_signal;
+    sigaction(SIGINT, &sa, NULL);
+    sigaction(SIGTERM, &sa, NULL);
+    signal(SIGPIPE, SIG_IGN);
+    printf("[SERVE] %s on %s: %d -> %d, max_batch=%d budget=%.0fus\n", argv[1], argv[2], in_dim, out_dim,
+           max_batch, budget_us);
+    fflush(stdout);
+
+    Client clients[SERVE_MAX_CLIENTS];
+    for (int i = 0; i < SERVE_MAX_CLIENTS; ++i)
+    {
+        clients[i].fd = -1;
+        clients[i].fill = 0;
+        clients[i].buf = malloc(req_bytes);
+        clients[i].out = NULL;
+        clients[i].off = clients[i].len = clients[i].cap = 0;
+    }
+    struct pollfd pfd[SERVE_MAX_CLIENTS + 1];
+    int slot_of[SERVE_MAX_CLIENTS + 1];
+    Pending *pending = malloc(max_batch * sizeof(Pending));
+    Matrix xb = alloc_matrix(max_batch, in_dim);
+    int n_pending = 0;
+    LatencyLog window = {NULL, 0, 0}, total = {NULL, 0, 0};
+    long win_batches = 0, tot_batches = 0;
+    double t_start = now_us(), t_window = t_start;
+
+    while (!stop_flag)
+    {
+        /* Run the batch when it is full or its oldest request is out of budget */
+        double t = now_us();
+        if (n_pending > 0 && (n_pending == max_batch || t - pending[0].t_arrive >= budget_us))
+        {
+            Matrix x = {n_pending, in_dim, xb.data};
+            Matrix out = net_infer(&net, &ctx, x);
+            for (int i = 0; i < n_pending; ++i)
+                if (pending[i].client >= 0)
+                    queue_out(&clients[pending[i].client], out.data + (size_t)i * out_dim, resp_bytes);
+            for (int i = 0; i < n_pending; ++i)
+            {
+                int s = pending[i].client;
+                if (s >= 0 && clients[s].len > clients[s].off && !flush_out(&clients[s]))
+                    close_client(clients, s, pending, n_pending);
+            }
+            double t_done = now_us();
+            for (int i = 0; i < n_pending; ++i)
+            {
+                log_latency(&window, t_done - pending[i].t_arrive);
+                log_latency(&total, t_done - pending[i].t_arrive);
+            }
+            n_pending = 0;
+            ++win_batches;
+            ++tot_batches;
+            if ((t_done - t_window) / 1e6 >= SERVE_REPORT_S && window.n > 0)
+            {
+                report("window", &window, (t_done - t_window) / 1e6, win_batches);
+                window.n = 0;
+                win_batches = 0;
+                t_window = t_done;
+            }
+            continue;
+        }
+
+        int nfds = 0;
+        pfd[nfds].fd = lfd;
+        pfd[nfds].events = POLLIN;
+        slot_of[nfds++] = -1;
+        for (int i = 0; i < SERVE_MAX_CLIENTS; ++i)
+            if (clients[i].fd >= 0)
+            {
+                size_t unsent = clients[i].len - clients[i].off;
+                pfd[nfds].fd = clients[i].fd;
+                pfd[nfds].events = (unsent < SERVE_MAX_BACKLOG ? POLLIN : 0) | (unsent > 0 ? POLLOUT : 0);
+                slot_of[nfds++] = i;
+            }
+        /* poll has ms resolution: round the batch deadline up (a truncated
+           timeout of 0 would spin for the whole sub-ms window) */
+        int timeout = -1;
+        if (n_pending > 0)
+            timeout = (int)fmax(0.0, ceil((pending[0].t_arrive + budget_us - t) / 1000.0));
+        else if (window.n > 0)
+            timeout = (int)(SERVE_REPORT_S * 1000);
+        if (poll(pfd, nfds, timeout) < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            perror("poll");
+            break;
+        }
+        if (n_pending == 0 && window.n > 0 && (now_us() - t_window) / 1e6 >= SERVE_REPORT_S)
+        {
+            report("window", &window, (now_us() - t_window) / 1e6, win_batches);
+            window.n = 0;
+            win_batches = 0;
+            t_window = now_us();
+        }
+        if (pfd[0].revents & POLLIN)
+        {
+            int cfd = accept(lfd, NULL, NULL);
+            int s = 0;
+            while (s < SERVE_MAX_CLIENTS && clients[s].fd >= 0)
+                ++s;
+            if (cfd >= 0 && (s == SERVE_MAX_CLIENTS || fcntl(cfd, F_SETFL, fcntl(cfd, F_GETFL) | O_NONBLOCK) != 0))
+            {
+                close(cfd);
+                cfd = -1;
+            }
+            if (cfd >= 0)
+            {
+                int hello[2] = {in_dim, out_dim};
+                clients[s].fd = cfd;
+                clients[s].fill = 0;
+                queue_out(&clients[s], hello, sizeof(hello));
+                if (!flush_out(&clients[s]))
+                    close_client(clients, s, pending, n_pending);
+            }
+        }
+        for (int k = 1; k < nfds; ++k)
+            if ((pfd[k].revents & POLLOUT) && clients[slot_of[k]].fd >= 0 && !flush_out(&clients[slot_of[k]]))
+                close_client(clients, slot_of[k], pending, n_pending);
+        for (int k = 1; k < nfds && n_pending < max_batch; ++k)
+        {
+            if (!(pfd[k].revents & (POLLIN | POLLHUP | POLLERR)))
+                continue;
+            int s = slot_of[k];
+            Client *c = &clients[s];
+            if (c->fd < 0 || !(pfd[k].events & POLLIN)) // closed above, or over its backlog
+                continue;
+            ssize_t r = read(c->fd, c->buf + c->fill, req_bytes - c->fill);
+            if (r <= 0)
+            {
+                if (r < 0 && (errno == EINTR || errno == EAGAIN || errno == EWOULDBLOCK))
+                    continue;
+                close_client(clients, s, pending, n_pending);
+                continue;
+            }
+            c->fill += (size_t)r;
+            if (c->fill == req_bytes)
+            {
+                memcpy(xb.data + (size_t)n_pending * in_dim, c->buf, req_bytes);
+                pending[n_pending].client = s;
+                pending[n_pending].t_arrive = now_us();
+                ++n_pending;
+                c->fill = 0;
+            }
+        }
+    }
+
+    double secs = (now_us() - t_start) / 1e6;
+    report("total", &total, secs, tot_batches);
+    for (int i = 0; i < SERVE_MAX_CLIENTS; ++i)
+    {
+        if (clients[i].fd >= 0)
+            close(clients[i].fd);
+        free(clients[i].buf);
+        free(clients[i].out);
+    }
+    close(lfd);
+    unlink(argv[2]);
+    free(window.v);
+    free(total.v);
+    free(pending);
+    free_matrix(xb);
+    infer_ctx_free(&ctx);
+    free_net(&net);
+    return 0;
+}
@@ -0,0 +1,127 @@
+#define _POSIX_C_SOURCE 200809L
+#include "utils.h"
+#include "rng.h"
+#include <errno.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <time.h>
+#include <unistd.h>
+
+/* Load generator for serve.exe: n_clients threads, each on its own connection,
+   send random feature vectors in a closed loop (next request after the
+   previous response) and time every round trip.
+
+   Usage: serve_client.exe <socket_path> [n_clients=8] [requests_per_client=10000] */
+
+typedef struct
+{
+    const char *path;
+    int n_req, id;
+    double *lat; // n_req round-trip times in us
+    int done;
+} ClientArgs;
+
+static double now_us(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+static int io_all(int fd, void *p, size_t n, int is_write)
+{
+    unsigned char *c = p;
+    while (n > 0)
+    {
+        ssize_t r = is_write ? write(fd, c, n) : read(fd, c, n);
+        if (r < 0 && errno == EINTR)
+            continue;
+        if (r <= 0)
+            return 0;
+        c += r;
+        n -= (size_t)r;
+    }
+    return 1;
+}
+
+static void *client_main(void *arg)
+{
+    ClientArgs *a = arg;
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strncpy(addr.sun_path, a->path, sizeof(addr.sun_path) - 1);
+    int dims[2];
+    if (fd < 0 || connect(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0 || !io_all(fd, dims, sizeof(dims), 0))
+    {
+        fprintf(stderr, "client %d: cannot connect to %s\n", a->id, a->path);
+        if (fd >= 0)
+            close(fd);
+        return NULL;
+    }
+    mat_t *x = malloc(dims[0] * sizeof(mat_t)), *y = malloc(dims[1] * sizeof(mat_t));
+    Rng rng = rng_stream_seed(0, RNG_STREAM_WORKER + a->id);
+    for (int r = 0; r < a->n_req; ++r)
+    {
+        rng_fill_uniform(&rng, x, dims[0], -1.0, 1.0);
+        double t0 = now_us();
+        if (!io_all(fd, x, dims[0] * sizeof(mat_t), 1) || !io_all(fd, y, dims[1] * sizeof(mat_t), 0))
+        {
+            fprintf(stderr, "client %d: connection lost after %d requests\n", a->id, r);
+            break;
+        }
+        a->lat[a->done++] = now_us() - t0;
+    }
+    close(fd);
+    free(x);
+    free(y);
+    return NULL;
+}
+
+int main(int argc, char **argv)
+{
+    if (argc < 2)
+    {
+        fprintf(stderr, "Usage: %s <socket_path> [n_clients] [requests_per_client]\n", argv[0]);
+        return 1;
+    }
+    int n_clients = argc > 2 ? atoi(argv[2]) : 8;
+    int n_req = argc > 3 ? atoi(argv[3]) : 10000;
+    if (n_clients < 1 || n_req < 1)
+        return 1;
+
+    ClientArgs *args = malloc(n_clients * sizeof(ClientArgs));
+    pthread_t *th = malloc(n_clients * sizeof(pthread_t));
+    double t0 = now_us();
+    for (int i = 0; i < n_clients; ++i)
+    {
+        args[i] = (ClientArgs){argv[1], n_req, i, malloc(n_req * sizeof(double)), 0};
+        pthread_create(&th[i], NULL, client_main, &args[i]);
+    }
+    for (int i = 0; i < n_clients; ++i)
+        pthread_join(th[i], NULL);
+    double secs = (now_us() - t0) / 1e6;
+
+    int total = 0;
+    for (int i = 0; i < n_clients; ++i)
+        total += args[i].done;
+    double *all = malloc((total > 0 ? total : 1) * sizeof(double));
+    int k = 0;
+    for (int i = 0; i < n_clients; ++i)
+    {
+        memcpy(all + k, args[i].lat, args[i].done * sizeof(double));
+        k += args[i].done;
+        free(args[i].lat);
+    }
+    if (total > 0)
+        printf("[CLIENT] %d clients, %d req in %.2fs (%.0f req/s), round trip p50=%.1fus p99=%.1fus\n",
+               n_clients, total, secs, total / secs, percentile(all, total, 0.50), percentile(all, total, 0.99));
+    free(all);
+    free(args);
+    free(th);
+    return total == n_clients * n_req ? 0 : 1;
+}
@@ -2,9 +2,23 @@
 #include "data.h"
 #include "optimizer.h"
 #include "utils.h"
+#include "config.h"
+#include "bench.h"
+#include "tiny.h"
+#include <string.h>
 
-int main() {
+int main(int argc, char **argv) {
     srand_seed(42);  // Seed 0
+    /* --bench: per-epoch timings in the results CSV and a [BENCH] summary;
+       --generic: train through train_step even though tiny.c has this net */
+    int generic = 0;
+    for (int i = 1; i < argc; ++i)
+    {
+        if (strcmp(argv[i], "--bench") == 0)
+            config_set_bench_log(1);
+        else if (strcmp(argv[i], "--generic") == 0)
+            generic = 1;
+    }
     int arch[] = {2, 4, 1};
     /* Use POLY_CUBIC for hidden layer and SIG for output */
     ActType acts[] = {POLY_CUBIC, FIXED_SIG};
@@ -16,7 +30,7 @@ int main() {
     Matrix X, Y;
 
     /* Generate spiral dataset and prepare results CSV */
-    gen_spirals(&X, &Y);
+    gen_spirals(&X, &Y, RNG_STREAM_DATA);
 
     char logf[256];
     sprintf(logf, "experiments/results/spirals_poly_%d.csv", 42);
@@ -43,9 +57,17 @@ int main() {
     log_csv_header(logf, total_params, names);
     if (names) { for (int i = 0; i < total_params; ++i) free((void*)names[i]); free(names); }
 
+    /* Compile-time specialized 2-4-1 step (tiny.c), bit-identical to train_step */
+    TinyNet tiny;
+    int fast = !generic && tiny_bind(&tiny, &net);
+    BenchClock clock;
+    bench_init(&clock);
     for (int e = 0; e < 100; ++e) {
-        mat_t loss = train_step(&net, X, Y, &opt, 0);  // MSE
-        mat_t acc = eval_acc(&net, X, Y);
+        bench_epoch_begin(&clock);
+        mat_t loss = fast ? tiny_train_step(&tiny, X, Y, &opt, 0) : train_step(&net, X, Y, &opt, 0);  // MSE
+        bench_epoch_end(&clock, X.rows);
+        mat_t acc = fast ? tiny_eval_acc(&tiny, X, Y) : eval_acc(&net, X, Y);
+        if (fast) tiny_sync(&tiny, &net);  // act params for the log
         int tp = 0;
         for (int i = 0; i < net.n_layers; ++i) tp += act_get_nparams(&net.layers[i].act);
         mat_t *params = NULL;
@@ -65,6 +87,9 @@ int main() {
         if (acc > 0.95) break;
     }
 
+    if (BENCH_LOG)
+        bench_report(&clock, fast ? "spirals (tiny)" : "spirals");
+    if (fast) tiny_free(&tiny);
     free_net(&net);
     free_matrix(X); free_matrix(Y);
     return 0;
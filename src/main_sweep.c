@@ -0,0 +1,105 @@
+#include "network.h"
+#include "data.h"
+#include "sweep.h"
+#include "utils.h"
+#include "config.h"
+#include <string.h>
+
+#define MNIST_VAL_FRAC 6 // 10000 of the 60000 training rows held out for ranking
+
+/* Successive-halving activation x init sweep for one dataset.
+   Usage: sweep.exe <xor|spirals|mnist> [min_epochs] [eta] [--bench]
+   Rows are appended to experiments/ablations.csv (plus an 'epochs' column).
+   --bench adds the per-epoch timing columns to every run's results CSV. */
+int main(int argc, char **argv)
+{
+    if (argc > 1 && strcmp(argv[argc - 1], "--bench") == 0)
+    {
+        config_set_bench_log(1);
+        --argc;
+    }
+    const char *ds = argc > 1 ? argv[1] : "spirals";
+    ActType acts[] = {POLY_CUBIC, PRELU, SWISH, PIECEWISE, FIXED_RELU};
+    ActInitStrategy strats[] = {ACT_INIT_DEFAULT, ACT_INIT_RANDOM_SMALL, ACT_INIT_NOISY};
+    int arch_small[] = {2, 4, 1};
+    int arch_mnist[] = {784, 256, 128, 10};
+
+    SweepSpec spec;
+    memset(&spec, 0, sizeof(spec));
+    spec.dataset = ds;
+    spec.seed = 42;
+    spec.eta = 3;
+    spec.group_by_init = 1;
+    srand_seed(spec.seed);
+    int val_owned = 0; // X_val/Y_val allocated separately (not a view of train)
+    if (strcmp(ds, "xor") == 0)
+    {
+        spec.arch = arch_small;
+        spec.n_arch = 3;
+        spec.max_epochs = 100;
+        gen_xor(&spec.X_train, &spec.Y_train);
+        spec.X_val = spec.X_train; // only 4 points: held-out == train
+        spec.Y_val = spec.Y_train;
+        spec.rank_by_loss = 1;     // 25% accuracy steps cannot rank early rungs
+    }
+    else if (strcmp(ds, "spirals") == 0)
+    {
+        spec.arch = arch_small;
+        spec.n_arch = 3;
+        spec.max_epochs = 100;
+        gen_spirals(&spec.X_train, &spec.Y_train, RNG_STREAM_DATA);
+        gen_spirals(&spec.X_val, &spec.Y_val, RNG_STREAM_DATA_VAL); // same spirals, fresh noise
+        val_owned = 1;
+    }
+    else if (strcmp(ds, "mnist") == 0)
+    {
+        spec.arch = arch_mnist;
+        spec.n_arch = 4;
+        spec.is_ce = 1;
+        spec.batch_size = 32;
+        spec.max_epochs = 10;
+        if (!load_data("data/mnist_train.bin", &spec.X_train, &spec.Y_train) ||
+            !load_data("data/mnist_test.bin", &spec.X_test, &spec.Y_test))
+        {
+            fprintf(stderr, "Failed to load MNIST bins\n");
+            return 1;
+        }
+        /* Rungs rank on the last 1/MNIST_VAL_FRAC of the training rows; the
+           test set only scores the final rows */
+        int n_val = spec.X_train.rows / MNIST_VAL_FRAC, n_fit = spec.X_train.rows - n_val;
+        spec.X_val = (Matrix){n_val, spec.X_train.cols, spec.X_train.data + (size_t)n_fit * spec.X_train.cols};
+        spec.Y_val = (Matrix){n_val, spec.Y_train.cols, spec.Y_train.data + (size_t)n_fit * spec.Y_train.cols};
+        spec.X_train.rows = spec.Y_train.rows = n_fit;
+    }
+    else
+    {
+        fprintf(stderr, "Unknown dataset %s (xor|spirals|mnist)\n", ds);
+        return 1;
+    }
+    /* Default first rung: max / eta^2 epochs (3 rungs up to the full budget) */
+    spec.min_epochs = spec.max_epochs / (spec.eta * spec.eta);
+    if (argc > 2)
+        spec.min_epochs = atoi(argv[2]);
+    if (argc > 3)
+        spec.eta = atoi(argv[3]);
+    if (spec.min_epochs < 1)
+        spec.min_epochs = 1;
+    if (spec.eta < 2)
+        spec.eta = 2;
+
+    sweep_successive_halving(&spec, acts, 5, strats, 3, "experiments/ablations.csv");
+
+    if (val_owned)
+    {
+        free_matrix(spec.X_val);
+        free_matrix(spec.Y_val);
+    }
+    if (spec.X_test.data)
+    {
+        free_matrix(spec.X_test);
+        free_matrix(spec.Y_test);
+    }
+    free_matrix(spec.X_train);
+    free_matrix(spec.Y_train);
+    return 0;
+}
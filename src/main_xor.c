@@ -2,11 +2,24 @@
 #include "data.h"
 #include "optimizer.h"
 #include "utils.h"
+#include "config.h"
+#include "bench.h"
+#include "tiny.h"
 #include <string.h>
 
-int main()
+int main(int argc, char **argv)
 {
     srand_seed(42); // Seed 0
+    /* --bench: per-epoch timings in the results CSV and a [BENCH] summary;
+       --generic: train through train_step even though tiny.c has this net */
+    int generic = 0;
+    for (int i = 1; i < argc; ++i)
+    {
+        if (strcmp(argv[i], "--bench") == 0)
+            config_set_bench_log(1);
+        else if (strcmp(argv[i], "--generic") == 0)
+            generic = 1;
+    }
     printf("Starting main\n");
      int arch[] = {2, 4, 1};
      /* Provide one activation per dense layer: hidden and output.
@@ -63,10 +76,19 @@ int main()
         free(names);
     }
 
+    /* Compile-time specialized 2-4-1 step (tiny.c), bit-identical to train_step */
+    TinyNet tiny;
+    int fast = !generic && tiny_bind(&tiny, &net);
+    BenchClock clock;
+    bench_init(&clock);
     for (int e = 0; e < 100; ++e)
     {
-        mat_t loss = train_step(&net, X, Y, &opt, 0); // MSE
-        mat_t acc = eval_acc(&net, X, Y);
+        bench_epoch_begin(&clock);
+        mat_t loss = fast ? tiny_train_step(&tiny, X, Y, &opt, 0) : train_step(&net, X, Y, &opt, 0); // MSE
+        bench_epoch_end(&clock, X.rows);
+        mat_t acc = fast ? tiny_eval_acc(&tiny, X, Y) : eval_acc(&net, X, Y);
+        if (fast)
+            tiny_sync(&tiny, &net); // act params for the log
         // Gather activation params
         int tp = 0;
         for (int i = 0; i < net.n_layers; ++i) tp += act_get_nparams(&net.layers[i].act);
@@ -89,6 +111,10 @@ int main()
         //     break;
     }
     printf("Training complete\n");
+    if (BENCH_LOG)
+        bench_report(&clock, fast ? "xor (tiny)" : "xor");
+    if (fast)
+        tiny_free(&tiny);
     free_net(&net);
     free_matrix(X);
     free_matrix(Y);
@@ -0,0 +1,126 @@
+#include "mem.h"
+#include "config.h"
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MEM_MAGIC 0x4D454D31u // "MEM1"; cleared on free to catch double frees
+
+/* 16 bytes, so payloads keep malloc's alignment */
+typedef struct
+{
+    size_t bytes;
+    uint32_t tag;
+    uint32_t magic;
+} MemHeader;
+
+static size_t mem_cur[MEM_N_TAGS], mem_peak[MEM_N_TAGS], mem_cur_all, mem_peak_all;
+static long mem_allocs[MEM_N_TAGS], mem_frees[MEM_N_TAGS];
+
+static const char *mem_names[MEM_N_TAGS] = {"weights", "grads", "optim", "cache", "temp", "data"};
+
+static void peak_max(size_t *peak, size_t v)
+{
+    size_t p = __atomic_load_n(peak, __ATOMIC_RELAXED);
+    while (v > p && !__atomic_compare_exchange_n(peak, &p, v, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+        ;
+}
+
+static void *mem_track(MemHeader *h, size_t bytes, MemTag tag)
+{
+    if (!h)
+    {
+        fprintf(stderr, "Alloc fail\n");
+        exit(1);
+    }
+    h->bytes = bytes;
+    h->tag = (uint32_t)tag;
+    h->magic = MEM_MAGIC;
+    peak_max(&mem_peak[tag], __atomic_add_fetch(&mem_cur[tag], bytes, __ATOMIC_RELAXED));
+    peak_max(&mem_peak_all, __atomic_add_fetch(&mem_cur_all, bytes, __ATOMIC_RELAXED));
+    __atomic_add_fetch(&mem_allocs[tag], 1, __ATOMIC_RELAXED);
+    return h + 1;
+}
+
+void *mem_alloc(size_t bytes, MemTag tag)
+{
+    return mem_track(malloc(sizeof(MemHeader) + bytes), bytes, tag);
+}
+
+void *mem_calloc(size_t n, size_t size, MemTag tag)
+{
+    return mem_track(calloc(1, sizeof(MemHeader) + n * size), n * size, tag);
+}
+
+void mem_free(void *p)
+{
+    if (!p)
+        return;
+    MemHeader *h = (MemHeader *)p - 1;
+    if (h->magic != MEM_MAGIC || h->tag >= MEM_N_TAGS)
+    {
+        fprintf(stderr, "mem_free: %p was not allocated by mem_alloc (or freed twice)\n", p);
+        abort();
+    }
+    h->magic = 0;
+    __atomic_sub_fetch(&mem_cur[h->tag], h->bytes, __ATOMIC_RELAXED);
+    __atomic_sub_fetch(&mem_cur_all, h->bytes, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&mem_frees[h->tag], 1, __ATOMIC_RELAXED);
+    free(h);
+}
+
+const char *mem_tag_name(MemTag tag)
+{
+    return tag >= 0 && tag < MEM_N_TAGS ? mem_names[tag] : "unknown";
+}
+
+MemStats mem_stats(MemTag tag)
+{
+    MemStats s = {__atomic_load_n(&mem_cur[tag], __ATOMIC_RELAXED), __atomic_load_n(&mem_peak[tag], __ATOMIC_RELAXED),
+                  __atomic_load_n(&mem_allocs[tag], __ATOMIC_RELAXED), __atomic_load_n(&mem_frees[tag], __ATOMIC_RELAXED)};
+    return s;
+}
+
+MemStats mem_total(void)
+{
+    MemStats s = {__atomic_load_n(&mem_cur_all, __ATOMIC_RELAXED), __atomic_load_n(&mem_peak_all, __ATOMIC_RELAXED),
+                  0, 0};
+    for (int t = 0; t < MEM_N_TAGS; ++t)
+    {
+        s.allocs += __atomic_load_n(&mem_allocs[t], __ATOMIC_RELAXED);
+        s.frees += __atomic_load_n(&mem_frees[t], __ATOMIC_RELAXED);
+    }
+    return s;
+}
+
+void mem_reset_peaks(void)
+{
+    for (int t = 0; t < MEM_N_TAGS; ++t)
+        __atomic_store_n(&mem_peak[t], __atomic_load_n(&mem_cur[t], __ATOMIC_RELAXED), __ATOMIC_RELAXED);
+    __atomic_store_n(&mem_peak_all, __atomic_load_n(&mem_cur_all, __ATOMIC_RELAXED), __ATOMIC_RELAXED);
+}
+
+void mem_report(const char *label)
+{
+    printf("[MEM] %s\n", label);
+    printf("[MEM]   %-8s %12s %12s %10s %10s\n", "tag", "current MB", "peak MB", "allocs", "frees");
+    for (int t = 0; t < MEM_N_TAGS; ++t)
+    {
+        MemStats s = mem_stats((MemTag)t);
+        printf("[MEM]   %-8s %12.3f %12.3f %10ld %10ld\n", mem_names[t], s.cur / 1e6, s.peak / 1e6, s.allocs, s.frees);
+    }
+    MemStats s = mem_total();
+    printf("[MEM]   %-8s %12.3f %12.3f %10ld %10ld\n", "total", s.cur / 1e6, s.peak / 1e6, s.allocs, s.frees);
+}
+
+void mem_log_epoch(int epoch)
+{
+    if (!MEM_LOG)
+        return;
+    MemStats s = mem_total();
+    printf("[MEM] epoch %d: %.2f MB (peak %.2f MB, %ld allocs) |", epoch, s.cur / 1e6, s.peak / 1e6, s.allocs);
+    for (int t = 0; t < MEM_N_TAGS; ++t)
+        printf(" %s %.2f", mem_names[t], mem_stats((MemTag)t).cur / 1e6);
+    printf("\n");
+}
@@ -0,0 +1,45 @@
+#ifndef MEM_H
+#define MEM_H
+
+#include <stddef.h>
+
+/* Allocation accounting. Every block from mem_alloc carries a small header
+   (size + subsystem tag), so mem_free can credit the right counters; current
+   bytes, peak bytes and alloc/free counts are kept per tag and in total with
+   relaxed atomics (the async evaluator allocates from its own thread).
+   alloc_matrix, alloc_aligned, activation params and the layer/network caches
+   go through here; pair mem_alloc with mem_free, never with free. */
+typedef enum
+{
+    MEM_WEIGHTS, // W, b, activation params (or their slab)
+    MEM_GRADS,   // grad_W, grad_b, activation param grads
+    MEM_OPTIM,   // momentum buffers, per-param lr multipliers
+    MEM_CACHE,   // forward caches kept for backward / reuse (act z/out, stashes, CSR, scratch)
+    MEM_TEMP,    // per-call temporaries (alloc_matrix default)
+    MEM_DATA,    // datasets
+    MEM_N_TAGS
+} MemTag;
+
+typedef struct
+{
+    size_t cur, peak; // bytes (payload, headers excluded)
+    long allocs, frees;
+} MemStats;
+
+void *mem_alloc(size_t bytes, MemTag tag); // exits on failure, like alloc_matrix
+void *mem_calloc(size_t n, size_t size, MemTag tag);
+void mem_free(void *p);                    // NULL is ignored
+
+const char *mem_tag_name(MemTag tag);
+MemStats mem_stats(MemTag tag);
+MemStats mem_total(void);
+// Peaks restart from the current usage (e.g. to measure one epoch)
+void mem_reset_peaks(void);
+
+// Table of current / peak / counts per tag
+void mem_report(const char *label);
+// One [MEM] line (current and peak total, current per tag); printed only when
+// MEM_LOG is set (config_set_mem_log)
+void mem_log_epoch(int epoch);
+
+#endif
@@ -1,8 +1,104 @@
 #include "network.h"
-#include <math.h> // INFINITY, log, exp, fmax
+#include <math.h> // log, exp
+#include <string.h>
 #include "optimizer.h"
 #include "config.h"
 
+#define NET_CKPT_MAGIC 0x434E414C /* "LANC" */
+#define NET_CKPT_VERSION 2 /* v2: per-layer kind and conv geometry; v1 (dense only) still loads */
+#define NET_CKPT_REC_V1 3
+#define NET_CKPT_REC 11
+
+/* Element offsets of one layer's tensors inside the flat slabs */
+typedef struct
+{
+    size_t W, b, act;
+} SlabSlot;
+
+static size_t slab_round(size_t n)
+{
+    size_t a = NET_SLAB_ALIGN / sizeof(mat_t);
+    return (n + a - 1) / a * a;
+}
+
+// Fill slots (one per layer); returns total slab elements, *n_dense = size of the W/b region
+static size_t net_layout(Network *net, SlabSlot *slots, size_t *n_dense)
+{
+    size_t off = 0;
+    for (int i = 0; i < net->n_layers; ++i)
+    {
+        Layer *l = &net->layers[i];
+        slots[i].W = off;
+        off += slab_round((size_t)l->W.rows * l->W.cols);
+        slots[i].b = off;
+        off += slab_round((size_t)l->b.rows * l->b.cols);
+    }
+    *n_dense = off;
+    for (int i = 0; i < net->n_layers; ++i)
+    {
+        slots[i].act = off;
+        off += net->layers[i].act.n_params;
+    }
+    return slab_round(off);
+}
+
+// Move a separately allocated tensor into the slab at dst and turn it into a view
+static void slab_move(Matrix *m, mat_t *dst)
+{
+    memcpy(dst, m->data, (size_t)m->rows * m->cols * sizeof(mat_t));
+    free_matrix(*m);
+    m->data = dst;
+}
+
+static void slab_move_raw(mat_t **p, mat_t *dst, int n)
+{
+    memcpy(dst, *p, n * sizeof(mat_t));
+    mem_free(*p);
+    *p = dst;
+}
+
+static void net_flatten(Network *net)
+{
+    SlabSlot *slots = malloc(net->n_layers * sizeof(SlabSlot));
+    net->n_total = net_layout(net, slots, &net->n_dense);
+    size_t bytes = net->n_total * sizeof(mat_t);
+    net->params = alloc_aligned(bytes, NET_SLAB_ALIGN, MEM_WEIGHTS);
+    net->grads = alloc_aligned(bytes, NET_SLAB_ALIGN, MEM_GRADS);
+    net->vels = alloc_aligned(bytes, NET_SLAB_ALIGN, MEM_OPTIM);
+    net->act_lrs = alloc_aligned((net->n_total - net->n_dense) * sizeof(mat_t), NET_SLAB_ALIGN, MEM_OPTIM);
+    for (int i = 0; i < net->n_layers; ++i)
+    {
+        Layer *l = &net->layers[i];
+        slab_move(&l->W, net->params + slots[i].W);
+        slab_move(&l->b, net->params + slots[i].b);
+        slab_move(&l->grad_W, net->grads + slots[i].W);
+        slab_move(&l->grad_b, net->grads + slots[i].b);
+        slab_move(&l->v_W, net->vels + slots[i].W);
+        slab_move(&l->v_b, net->vels + slots[i].b);
+        int np = l->act.n_params;
+        if (np > 0)
+        {
+            size_t a = slots[i].act;
+            slab_move_raw(&l->act.params, net->params + a, np);
+            slab_move_raw(&l->act.grad_act, net->grads + a, np);
+            slab_move(&l->v_act, net->vels + a);
+            slab_move(&l->act_lr, net->act_lrs + (a - net->n_dense));
+        }
+    }
+    net->flat = 1;
+    free(slots);
+}
+
+// Shared tail of init_net / init_net_layers
+static void net_finalize(Network *net)
+{
+    if (net->layers[0].kind == LAYER_DENSE)
+        net->layers[0].sparse_input = 1; // raw inputs (e.g. MNIST pixels) may be sparse
+    /* Layers are initialized as usual (same RNG order), then moved into slabs */
+    if (NET_FLAT_STORAGE)
+        net_flatten(net);
+}
+
 Network init_net(int input_dim, int *arch, int n_arch, ActType *acts, ActInitStrategy *act_strats)
 {
     Network net = {n_arch - 1, malloc((n_arch - 1) * sizeof(Layer)), input_dim};
@@ -11,130 +107,351 @@ Network init_net(int input_dim, int *arch, int n_arch, ActType *acts, ActInitStr
         /* act_strats must be provided by the caller (no fallback) */
         net.layers[i] = init_layer(arch[i], arch[i + 1], acts[i], act_strats[i]);
     }
+    net_finalize(&net);
+    return net;
+}
+
+Network init_net_layers(int input_dim, Layer *layers, int n_layers)
+{
+    Network net = {n_layers, malloc(n_layers * sizeof(Layer)), input_dim};
+    memcpy(net.layers, layers, n_layers * sizeof(Layer));
+    net_finalize(&net);
     return net;
 }
 
 void free_net(Network *net)
 {
     for (int i = 0; i < net->n_layers; ++i)
-        free_layer(&net->layers[i]);
+    {
+        Layer *l = &net->layers[i];
+        if (net->flat)
+        {
+            /* Views into the slabs: detach so free_layer skips them */
+            l->W.data = l->b.data = NULL;
+            l->grad_W.data = l->grad_b.data = NULL;
+            l->v_W.data = l->v_b.data = NULL;
+            if (l->act.n_params > 0)
+            {
+                l->v_act.data = l->act_lr.data = NULL;
+                l->act.params = l->act.grad_act = NULL;
+            }
+        }
+        free_layer(l);
+    }
     free(net->layers);
+    if (net->flat)
+    {
+        free_aligned(net->params);
+        free_aligned(net->grads);
+        free_aligned(net->vels);
+        free_aligned(net->act_lrs);
+    }
+    mem_free(net->scratch);
 }
 
-// Forward full net (outs optional array of Matrix*)
-static void net_forward(Network *net, Matrix x, Matrix *outs)
+void net_zero_grads(Network *net)
 {
-    int batch = x.rows;
-    Matrix curr = alloc_matrix(batch, net->input_dim);
-    copy_matrix(curr, x);
+    if (net->flat)
+    {
+        memset(net->grads, 0, net->n_total * sizeof(mat_t));
+        return;
+    }
+    for (int i = 0; i < net->n_layers; ++i)
+    {
+        Layer *l = &net->layers[i];
+        mat_scale(l->grad_W, 0.0);
+        mat_scale(l->grad_b, 0.0);
+        for (int j = 0; j < l->act.n_params; ++j)
+            l->act.grad_act[j] = 0.0;
+    }
+}
+
+// Per-tensor W/b clipping; with flat storage this walks the grad slab front to back
+void net_clip_grads(Network *net)
+{
+    for (int i = 0; i < net->n_layers; ++i)
+    {
+        mat_clip_grad(net->layers[i].grad_W, GRAD_CLIP_NORM);
+        mat_clip_grad(net->layers[i].grad_b, GRAD_CLIP_NORM);
+    }
+}
+
+void net_apply_update(Network *net, SGD *opt)
+{
+    if (net->flat)
+    {
+        /* Whole W/b region in one pass; act params keep their own rules */
+        sgd_update_dense(net->params, net->vels, net->grads, net->n_dense, opt);
+        for (int i = 0; i < net->n_layers; ++i)
+        {
+            sgd_apply_mask(&net->layers[i]);
+            sgd_update_act(&net->layers[i], opt);
+        }
+        return;
+    }
+    for (int i = 0; i < net->n_layers; ++i)
+        sgd_update(&net->layers[i], opt);
+}
+
+/* Memory plan for one step. Every intermediate tensor exists once:
+     input x          - caller's batch, viewed by layers[0].x_cache
+     layer i z        - layers[i].act.z (matmul / conv write it in place)
+     layer i output   - layers[i].act.out (or pool_out), viewed by layers[i+1].x_cache
+     deltas           - two ping-pong buffers sized for the widest layer input
+   so a forward does no copies and the loss reads the last output in place.
+   With ACT_STASH_BF16 (dense nets) z and the outputs instead live in net->scratch
+   (one z buffer + two ping-pong outputs, all layers), and each layer keeps bf16
+   copies of its z and (past layer 0) its input for backward. With ACT_STASH_MASK
+   the z of FIXED_RELU / PRELU / PIECEWISE dense layers goes to that one z
+   buffer instead of act.z, and backward keeps a 1- or 2-bit code per element. */
+
+static int net_uses_stash(Network *net)
+{
+    if (!ACT_STASH_BF16)
+        return 0;
+    for (int i = 0; i < net->n_layers; ++i)
+        if (net->layers[i].kind != LAYER_DENSE)
+            return 0;
+    return 1;
+}
+
+// Layer runs layer_forward_mask under ACT_STASH_MASK (bf16 stashes take precedence)
+static int layer_uses_mask(Layer *l)
+{
+    return ACT_STASH_MASK && l->kind == LAYER_DENSE && act_mask_bits(&l->act) > 0;
+}
+
+static mat_t *net_reserve_scratch(Network *net, size_t n)
+{
+    if (n > net->scratch_cap)
+    {
+        mem_free(net->scratch);
+        net->scratch = mem_alloc(n * sizeof(mat_t), MEM_CACHE);
+        net->scratch_cap = n;
+    }
+    return net->scratch;
+}
+
+static int net_widest_out(Network *net)
+{
+    int w = 0;
+    for (int i = 0; i < net->n_layers; ++i)
+        w = net->layers[i].out_dim > w ? net->layers[i].out_dim : w;
+    return w;
+}
+
+// Forward full net; returns a view of the last layer's output. train = 0
+// (evaluation) skips the backward stashes.
+static Matrix net_forward(Network *net, Matrix x, int train)
+{
+    Matrix curr = x;
+    size_t slot = (size_t)x.rows * net_widest_out(net);
+    if (!net_uses_stash(net))
+    {
+        mat_t *z_buf = ACT_STASH_MASK ? net_reserve_scratch(net, slot) : NULL;
+        for (int i = 0; i < net->n_layers; ++i)
+        {
+            Layer *l = &net->layers[i];
+            curr = layer_uses_mask(l) ? layer_forward_mask(l, curr, z_buf, train) : layer_forward_view(l, curr);
+        }
+        return curr;
+    }
+    mat_t *z_buf = net_reserve_scratch(net, 3 * slot), *out_buf[2] = {z_buf + slot, z_buf + 2 * slot};
     for (int i = 0; i < net->n_layers; ++i)
     {
-        Matrix next = alloc_matrix(batch, net->layers[i].out_dim);
-        layer_forward(&net->layers[i], curr, next);
-        if (outs)
-            copy_matrix(outs[i], next); // Copy if needed
-        free_matrix(curr);
-        curr = next;
+        /* Layer 0's input is the caller's batch, which outlives backward */
+        int stash = train ? LAYER_STASH_Z | (i > 0 ? LAYER_STASH_X : 0) : 0;
+        curr = layer_forward_stash(&net->layers[i], curr, z_buf, out_buf[i & 1], stash);
     }
-    free_matrix(curr);
+    return curr;
 }
 
-// Back full
-static void net_backward(Network *net, Matrix delta_out, Matrix y, int is_ce)
+// Back full; delta_out is read in place. last: this is the step's final
+// (micro-)batch, so grads are complete once a layer is done (grad_ready)
+static void net_backward(Network *net, Matrix delta_out, mat_t gscale, int last)
 {
     int batch = delta_out.rows;
-    Matrix curr_delta = alloc_matrix(batch, net->layers[net->n_layers - 1].out_dim);
-    copy_matrix(curr_delta, delta_out);
+    int widest = 0;
+    for (int i = 1; i < net->n_layers; ++i)
+        widest = net->layers[i].in_dim > widest ? net->layers[i].in_dim : widest;
+    mat_t *buf[2] = {NULL, NULL};
+    if (net->n_layers > 1)
+    {
+        buf[0] = mem_alloc((size_t)batch * widest * sizeof(mat_t), MEM_TEMP);
+        buf[1] = mem_alloc((size_t)batch * widest * sizeof(mat_t), MEM_TEMP);
+    }
+    Matrix curr_delta = delta_out;
     for (int i = net->n_layers - 1; i >= 0; --i)
     {
-        Matrix prev_delta = alloc_matrix(batch, net->layers[i].in_dim);
-        layer_backward(&net->layers[i], curr_delta, prev_delta);
-        free_matrix(curr_delta);
+        /* The input gradient of the first layer is never used: skip it */
+        Matrix prev_delta = {batch, net->layers[i].in_dim, i > 0 ? buf[i & 1] : NULL};
+        layer_backward_scaled(&net->layers[i], curr_delta, prev_delta, gscale);
+        if (last && net->grad_ready)
+            net->grad_ready(net->grad_ready_ctx, i);
         curr_delta = prev_delta;
     }
-    free_matrix(curr_delta);
+    mem_free(buf[0]);
+    mem_free(buf[1]);
 }
 
-mat_t train_step(Network *net, Matrix x, Matrix y, SGD *opt, int is_ce)
+mat_t loss_softmax_ce(Matrix logits, Matrix y, Matrix delta)
 {
-    int batch = x.rows;
-    int out_dim = net->layers[net->n_layers - 1].out_dim;
-    // Forward
-    Matrix out = alloc_matrix(batch, out_dim);
-    net_forward(net, x, NULL);
-    copy_matrix(out, net->layers[net->n_layers - 1].act.out);
-    // Loss + delta_out
+    int batch = logits.rows, C = logits.cols;
+    mat_t loss = 0.0;
+    for (int b = 0; b < batch; ++b)
+    {
+        int label = (int)y.data[(size_t)b * y.cols]; // class idx, y.cols = 1
+        const mat_t *restrict z = logits.data + (size_t)b * C;
+        mat_t *restrict d = delta.data + (size_t)b * C;
+        /* Branch-free passes over the row: max, exp written straight into delta,
+           normalize. They stay scalar at -O2 (libm exp, and the sums keep their
+           left-to-right order so train_step and tiny.c agree bit for bit); the
+           gain is one read of the logits and no temporaries */
+        mat_t m = z[0];
+        for (int j = 1; j < C; ++j)
+            m = z[j] > m ? z[j] : m;
+        mat_t sum_exp = 0.0;
+        for (int j = 0; j < C; ++j)
+        {
+            d[j] = exp(z[j] - m);
+            sum_exp += d[j];
+        }
+        mat_t inv = 1.0 / sum_exp;
+        for (int j = 0; j < C; ++j)
+            d[j] *= inv;
+        // Delta = softmax - one_hot(y); NLL from the log-sum-exp (no log of a rounded prob)
+        d[label] -= 1.0;
+        loss += log(sum_exp) + m - z[label];
+    }
+    return loss / batch;
+}
+
+mat_t loss_mse(Matrix out, Matrix y, Matrix delta)
+{
+    int batch = out.rows, C = out.cols;
     mat_t loss = 0.0;
-    Matrix delta_out = alloc_matrix(batch, out_dim);
-    
-    if (is_ce)
-    {
-        // Softmax + CE; assume y.cols=1, y.data[b] = class idx (0 to out_dim-1)
-        for (int b = 0; b < batch; ++b)
-        {
-            
-            int y_idx = (int)y.data[b];
-            // Softmax (stable)
-            mat_t maxo = -INFINITY;
-            for (int j = 0; j < out_dim; ++j)
-                maxo = fmax(maxo, out.data[b * out_dim + j]);
-            mat_t sum_exp = 0.0;
-            for (int j = 0; j < out_dim; ++j)
+    for (int b = 0; b < batch; ++b)
+    {
+        const mat_t *restrict o = out.data + (size_t)b * C;
+        mat_t *restrict d = delta.data + (size_t)b * C;
+        if (y.cols == 1)
+        {
+            mat_t target = y.data[b]; // one target broadcast across outputs
+            for (int j = 0; j < C; ++j)
+            {
+                d[j] = o[j] - target;
+                loss += d[j] * d[j];
+            }
+        }
+        else
+        {
+            const mat_t *t = y.data + (size_t)b * y.cols;
+            for (int j = 0; j < C; ++j)
             {
-                mat_t exp_val = exp(out.data[b * out_dim + j] - maxo);
-                sum_exp += exp_val;
-                out.data[b * out_dim + j] = exp_val; // Temp
+                d[j] = o[j] - t[j];
+                loss += d[j] * d[j];
             }
-            for (int j = 0; j < out_dim; ++j)
-                out.data[b * out_dim + j] /= sum_exp;
-            loss -= log(out.data[b * out_dim + y_idx] + 1e-8);
-            // Delta = softmax - one_hot(y)
-            for (int j = 0; j < out_dim; ++j)
-                delta_out.data[b * out_dim + j] = out.data[b * out_dim + j] - (j == y_idx ? 1.0 : 0.0);
         }
-        loss /= batch;
+    }
+    return loss / (batch * C);
+}
+
+// Rows per micro-batch under ACT_MEM_BUDGET (0 = no limit). Per row a step keeps
+// act.z and act.out for every layer (plus pool_out for pooled conv layers), the
+// backward delta_z and the delta buffers; inputs are views, not copies. With
+// bf16 stashes a layer keeps 2-byte x and z, plus the shared scratch; a masked
+// layer keeps its z code (rounded up to a byte per row) instead of act.z.
+static int net_micro_batch_rows(Network *net)
+{
+    if (ACT_MEM_BUDGET <= 0)
+        return 0;
+    long row_bytes = 0;
+    if (net_uses_stash(net))
+    {
+        int widest_in = 0;
+        for (int i = 0; i < net->n_layers; ++i)
+        {
+            Layer *l = &net->layers[i];
+            row_bytes += (long)((i > 0 ? l->in_dim : 0) + l->out_dim) * (long)sizeof(uint16_t);
+            widest_in = l->in_dim > widest_in ? l->in_dim : widest_in;
+        }
+        row_bytes += (4L * net_widest_out(net) + 2L * widest_in) * (long)sizeof(mat_t);
     }
     else
-    { // MSE
-        for (int b = 0; b < batch; ++b)
+    {
+        int masked = 0;
+        for (int i = 0; i < net->n_layers; ++i)
         {
-            for (int j = 0; j < out_dim; ++j)
+            Layer *l = &net->layers[i];
+            if (layer_uses_mask(l))
             {
-                mat_t target = (y.cols == 1) ? y.data[b] : y.data[b * y.cols + j];
-                
-                mat_t d = out.data[b * out_dim + j] - target;
-                loss += d * d;
-                delta_out.data[b * out_dim + j] = d;
+                row_bytes += (l->in_dim + 2L * l->out_dim) * (long)sizeof(mat_t) +
+                             (long)act_mask_bytes(act_mask_bits(&l->act), (size_t)l->out_dim);
+                masked = 1;
+                continue;
             }
+            long pooled = l->act.z.cols != l->out_dim ? l->out_dim : 0;
+            row_bytes += (l->in_dim + 3L * l->act.z.cols + pooled) * (long)sizeof(mat_t);
         }
-        loss /= (batch * out_dim);
+        row_bytes += masked ? net_widest_out(net) * (long)sizeof(mat_t) : 0; // shared z buffer
+    }
+    long rows = ACT_MEM_BUDGET / row_bytes;
+    return rows > 0 ? (int)rows : 1;
+}
+
+// Forward, loss and backward for one (micro-)batch; returns the data loss.
+// Grads accumulate (weighted by gscale) and are left for the caller to apply.
+static mat_t net_forward_backward(Network *net, Matrix x, Matrix y, int is_ce, mat_t gscale, int last)
+{
+    // Forward; the loss kernels read the logits straight from the last output view
+    Matrix logits = net_forward(net, x, 1);
+    // Loss + delta_out
+    Matrix delta_out = alloc_matrix(logits.rows, logits.cols);
+    mat_t loss = is_ce ? loss_softmax_ce(logits, y, delta_out) : loss_mse(logits, y, delta_out);
+
+    // Backprop
+    net_backward(net, delta_out, gscale, last);
+
+    free_matrix(delta_out);
+    return loss;
+}
+
+mat_t net_compute_grads(Network *net, Matrix x, Matrix y, int is_ce)
+{
+    int batch = x.rows;
+    int micro = net_micro_batch_rows(net);
+    if (micro <= 0 || batch <= micro)
+        return net_forward_backward(net, x, y, is_ce, 1.0, 1);
+    /* Gradient accumulation: each micro-batch of m rows contributes its
+       batch-mean grads and loss with weight m / batch. */
+    mat_t loss = 0.0;
+    for (int start = 0; start < batch; start += micro)
+    {
+        int m = start + micro < batch ? micro : batch - start;
+        Matrix xm = {m, x.cols, x.data + (size_t)start * x.cols};
+        Matrix ym = {m, y.cols, y.data + (size_t)start * y.cols};
+        mat_t w = (mat_t)m / batch;
+        loss += w * net_forward_backward(net, xm, ym, is_ce, w, start + m >= batch);
     }
+    return loss;
+}
+
+mat_t train_step(Network *net, Matrix x, Matrix y, SGD *opt, int is_ce)
+{
+    mat_t loss = net_compute_grads(net, x, y, is_ce);
 
     // Reg (on acts only)
     mat_t reg = 0.0;
     for (int i = 0; i < net->n_layers; ++i)
         reg += act_reg(&net->layers[i].act, 1e-4);
     loss += reg;
-    
 
-    // Backprop
-    net_backward(net, delta_out, y, is_ce);
-
-    // Clip grads (per layer W/b; acts bounded separately)
-    for (int i = 0; i < net->n_layers; ++i)
-    {
-        mat_clip_grad(net->layers[i].grad_W, GRAD_CLIP_NORM);
-        mat_clip_grad(net->layers[i].grad_b, GRAD_CLIP_NORM);
-    }
-    
+    // Clip grads (per layer W/b; acts bounded separately), once per logical batch
+    net_clip_grads(net);
 
     // Update all layers
-    for (int i = 0; i < net->n_layers; ++i)
-        sgd_update(&net->layers[i], opt);
-    
+    net_apply_update(net, opt);
 
-    free_matrix(out);
-    free_matrix(delta_out);
     if (isnan(loss) || isinf(loss))
     {
         fprintf(stderr, "Invalid loss in train_step: %f\n", loss);
@@ -143,13 +460,17 @@ mat_t train_step(Network *net, Matrix x, Matrix y, SGD *opt, int is_ce)
     return loss;
 }
 
-mat_t eval_acc(Network *net, Matrix x, Matrix y)
+// Number of correct predictions in one forward pass over x
+static int eval_correct(Network *net, Matrix x, Matrix y)
 {
-    int batch = x.rows;
-    int out_dim = net->layers[net->n_layers - 1].out_dim;
-    Matrix out = alloc_matrix(batch, out_dim);
-    net_forward(net, x, NULL);
-    copy_matrix(out, net->layers[net->n_layers - 1].act.out);
+    Matrix out = net_forward(net, x, 0);
+    return count_correct(out, y, net->layers[net->n_layers - 1].act.type);
+}
+
+int count_correct(Matrix out, Matrix y, ActType last_act)
+{
+    int batch = out.rows;
+    int out_dim = out.cols;
     int correct = 0;
     for (int b = 0; b < batch; ++b)
     {
@@ -160,7 +481,6 @@ mat_t eval_acc(Network *net, Matrix x, Matrix y)
                If the layer activation is already a sigmoid-like output (FIXED_SIG or SWISH),
                treat it as a probability; otherwise apply sigmoid to convert logits to prob.
                Then threshold at 0.5. */
-            ActType last_act = net->layers[net->n_layers - 1].act.type;
             mat_t score = out.data[b * out_dim + 0];
             if (last_act != FIXED_SIG && last_act != SWISH)
                 score = sigmoid(score);
@@ -185,6 +505,236 @@ mat_t eval_acc(Network *net, Matrix x, Matrix y)
                 ++correct;
         }
     }
-    free_matrix(out);
-    return (mat_t)correct / batch;
-}
\ No newline at end of file
+    return correct;
+}
+
+mat_t eval_acc(Network *net, Matrix x, Matrix y)
+{
+    /* Under a memory budget evaluate in micro-batches so the layer caches
+       are not regrown to the full evaluation set. */
+    int micro = net_micro_batch_rows(net);
+    if (micro <= 0 || x.rows <= micro)
+        return (mat_t)eval_correct(net, x, y) / x.rows;
+    int correct = 0;
+    for (int start = 0; start < x.rows; start += micro)
+    {
+        int m = start + micro < x.rows ? micro : x.rows - start;
+        Matrix xm = {m, x.cols, x.data + (size_t)start * x.cols};
+        Matrix ym = {m, y.cols, y.data + (size_t)start * y.cols};
+        correct += eval_correct(net, xm, ym);
+    }
+    return (mat_t)correct / x.rows;
+}
+
+// Copy params between the network tensors and a buffer in slab layout (dir 0: gather, 1: scatter)
+static void net_copy_slab(Network *net, mat_t *buf, SlabSlot *slots, int scatter)
+{
+    for (int i = 0; i < net->n_layers; ++i)
+    {
+        Layer *l = &net->layers[i];
+        struct
+        {
+            mat_t *p;
+            size_t off, n;
+        } t[3] = {{l->W.data, slots[i].W, (size_t)l->W.rows * l->W.cols},
+                  {l->b.data, slots[i].b, (size_t)l->b.rows * l->b.cols},
+                  {l->act.params, slots[i].act, (size_t)l->act.n_params}};
+        for (int k = 0; k < 3; ++k)
+        {
+            if (!t[k].n)
+                continue;
+            if (scatter)
+                memcpy(t[k].p, buf + t[k].off, t[k].n * sizeof(mat_t));
+            else
+                memcpy(buf + t[k].off, t[k].p, t[k].n * sizeof(mat_t));
+        }
+    }
+}
+
+size_t net_param_count(Network *net)
+{
+    if (net->flat)
+        return net->n_total;
+    SlabSlot *slots = malloc(net->n_layers * sizeof(SlabSlot));
+    size_t n_dense, n_total = net_layout(net, slots, &n_dense);
+    free(slots);
+    return n_total;
+}
+
+// Gather (scatter = 0) or scatter the params through a slab-layout buffer
+static void net_params_io(Network *net, mat_t *buf, int scatter)
+{
+    if (net->flat)
+    {
+        if (scatter)
+            memcpy(net->params, buf, net->n_total * sizeof(mat_t));
+        else
+            memcpy(buf, net->params, net->n_total * sizeof(mat_t));
+        return;
+    }
+    SlabSlot *slots = malloc(net->n_layers * sizeof(SlabSlot));
+    size_t n_dense;
+    net_layout(net, slots, &n_dense);
+    net_copy_slab(net, buf, slots, scatter);
+    free(slots);
+}
+
+void net_get_params(Network *net, mat_t *buf)
+{
+    net_params_io(net, buf, 0);
+}
+
+void net_set_params(Network *net, const mat_t *buf)
+{
+    net_params_io(net, (mat_t *)buf, 1);
+}
+
+// Fresh layer with the geometry of l and activation type t
+static Layer layer_like(const Layer *l, ActType t, ActInitStrategy strat)
+{
+    if (l->kind == LAYER_CONV)
+    {
+        const ConvShape *c = &l->conv;
+        return init_conv_layer(c->in_c, c->in_h, c->in_w, c->out_c, c->k, c->pad, c->pool, t, strat);
+    }
+    return init_layer(l->in_dim, l->out_dim, t, strat);
+}
+
+Network net_clone(Network *net)
+{
+    Layer *layers = malloc(net->n_layers * sizeof(Layer));
+    for (int i = 0; i < net->n_layers; ++i)
+        layers[i] = layer_like(&net->layers[i], net->layers[i].act.type, ACT_INIT_DEFAULT);
+    Network c = init_net_layers(net->input_dim, layers, net->n_layers);
+    free(layers);
+    mat_t *buf = malloc(net_param_count(net) * sizeof(mat_t));
+    net_get_params(net, buf);
+    net_set_params(&c, buf);
+    free(buf);
+    return c;
+}
+
+Network net_swap_acts(Network *net, const ActType *acts, const ActInitStrategy *strats)
+{
+    Layer *layers = malloc(net->n_layers * sizeof(Layer));
+    for (int i = 0; i < net->n_layers; ++i)
+        layers[i] = layer_like(&net->layers[i], acts[i], strats[i]);
+    Network c = init_net_layers(net->input_dim, layers, net->n_layers);
+    free(layers);
+    for (int i = 0; i < net->n_layers; ++i)
+    {
+        Layer *src = &net->layers[i], *dst = &c.layers[i];
+        copy_matrix(dst->W, src->W);
+        copy_matrix(dst->b, src->b);
+        if (dst->act.type == src->act.type && dst->act.n_params > 0)
+            memcpy(dst->act.params, src->act.params, dst->act.n_params * sizeof(mat_t)); // keep trained params
+    }
+    return c;
+}
+
+int save_net(const char *fname, Network *net)
+{
+    FILE *f = fopen(fname, "wb");
+    if (!f)
+        return 0;
+    int hdr[4] = {NET_CKPT_MAGIC, NET_CKPT_VERSION, net->n_layers, net->input_dim};
+    int ok = fwrite(hdr, sizeof(int), 4, f) == 4;
+    for (int i = 0; i < net->n_layers; ++i)
+    {
+        Layer *l = &net->layers[i];
+        ConvShape *c = &l->conv;
+        int rec[NET_CKPT_REC] = {l->in_dim, l->out_dim, (int)l->act.type, (int)l->kind,
+                                 c->in_c, c->in_h, c->in_w, c->out_c, c->k, c->pad, c->pool};
+        ok &= fwrite(rec, sizeof(int), NET_CKPT_REC, f) == NET_CKPT_REC;
+    }
+    if (net->flat)
+    {
+        ok &= fwrite(net->params, sizeof(mat_t), net->n_total, f) == net->n_total; // one streaming write
+    }
+    else
+    {
+        SlabSlot *slots = malloc(net->n_layers * sizeof(SlabSlot));
+        if (!slots)
+        {
+            fprintf(stderr, "Alloc fail\n");
+            exit(1);
+        }
+        size_t n_dense, n_total = net_layout(net, slots, &n_dense);
+        mat_t *buf = calloc(n_total, sizeof(mat_t));
+        if (!buf)
+        {
+            fprintf(stderr, "Alloc fail\n");
+            exit(1);
+        }
+        net_copy_slab(net, buf, slots, 0);
+        ok &= fwrite(buf, sizeof(mat_t), n_total, f) == n_total;
+        free(buf);
+        free(slots);
+    }
+    ok &= fclose(f) == 0; // buffered data is flushed (and can fail) here
+    return ok;
+}
+
+int load_net(const char *fname, Network *net)
+{
+    FILE *f = fopen(fname, "rb");
+    if (!f)
+        return 0;
+    int hdr[4];
+    if (fread(hdr, sizeof(int), 4, f) != 4 || hdr[0] != NET_CKPT_MAGIC || hdr[1] < 1 ||
+        hdr[1] > NET_CKPT_VERSION || hdr[2] < 1)
+    {
+        fprintf(stderr, "load_net: %s is not a LAN-C checkpoint\n", fname);
+        fclose(f);
+        return 0;
+    }
+    int n_layers = hdr[2];
+    int rec_len = hdr[1] == 1 ? NET_CKPT_REC_V1 : NET_CKPT_REC;
+    Layer *layers = malloc(n_layers * sizeof(Layer));
+    int ok = 1, built = 0;
+    for (int i = 0; i < n_layers && ok; ++i)
+    {
+        int rec[NET_CKPT_REC] = {0};
+        ok = fread(rec, sizeof(int), rec_len, f) == (size_t)rec_len;
+        if (!ok)
+            break;
+        if (rec[3] == LAYER_CONV)
+            layers[i] = init_conv_layer(rec[4], rec[5], rec[6], rec[7], rec[8], rec[9], rec[10],
+                                        (ActType)rec[2], ACT_INIT_DEFAULT);
+        else
+            layers[i] = init_layer(rec[0], rec[1], (ActType)rec[2], ACT_INIT_DEFAULT);
+        ++built;
+    }
+    if (ok)
+    {
+        *net = init_net_layers(hdr[3], layers, n_layers);
+        SlabSlot *slots = malloc(n_layers * sizeof(SlabSlot));
+        size_t n_dense, n_total = net_layout(net, slots, &n_dense);
+        if (net->flat)
+        {
+            ok = fread(net->params, sizeof(mat_t), n_total, f) == n_total;
+        }
+        else
+        {
+            mat_t *buf = malloc(n_total * sizeof(mat_t));
+            ok = fread(buf, sizeof(mat_t), n_total, f) == n_total;
+            if (ok)
+                net_copy_slab(net, buf, slots, 1);
+            free(buf);
+        }
+        free(slots);
+        if (!ok)
+        {
+            fprintf(stderr, "load_net: %s is truncated\n", fname);
+            free_net(net);
+        }
+    }
+    else
+    {
+        for (int i = 0; i < built; ++i)
+            free_layer(&layers[i]);
+    }
+    free(layers);
+    fclose(f);
+    return ok;
+}
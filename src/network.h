@@ -9,14 +9,76 @@ typedef struct
     int n_layers;
     Layer *layers;
     int input_dim;
+    /* Flat storage (NET_FLAT_STORAGE): every layer's W, b and act params,
+       their grads, velocities and act_lr are views into these slabs.
+       Slab layout: [W0 b0 W1 b1 ... | act0 act1 ...], each tensor aligned
+       to NET_SLAB_ALIGN bytes; act_lrs only covers the act region. */
+    int flat;
+    size_t n_dense, n_total; // elements in the W/b region / whole slab
+    mat_t *params, *grads, *vels, *act_lrs;
+    /* ACT_STASH_BF16: forward z / ping-pong outputs shared by all layers */
+    mat_t *scratch;
+    size_t scratch_cap;
+    /* Optional: called during backward as soon as layer i's grad_W / grad_b
+       are final for the step (after the last micro-batch), layers in order
+       n_layers-1 .. 0; dist.c starts reducing them while earlier layers run */
+    void (*grad_ready)(void *ctx, int layer);
+    void *grad_ready_ctx;
 } Network;
 
+#define NET_SLAB_ALIGN 64
+
 Network init_net(int input_dim, int *arch, int n_arch, ActType *acts, ActInitStrategy *act_strats); // arch[0]=input, arch[1]=hid1, ... acts and strategies for each post-dense
 
+// Takes ownership of prebuilt layers (e.g. from init_conv_layer); layers[] itself is copied
+Network init_net_layers(int input_dim, Layer *layers, int n_layers);
+
 void free_net(Network *net);
 
 mat_t train_step(Network *net, Matrix x, Matrix y, SGD *opt, int is_ce); // Forward, loss, back, update; return loss
 
+// The forward/backward part of train_step (micro-batched under ACT_MEM_BUDGET):
+// accumulates grads without zeroing, clipping or updating; returns the data loss.
+// grad_W/grad_b are d(loss)/d(param) for CE and (out_dim / 2) * d(loss)/d(param)
+// for MSE; act grads are batch sums, i.e. batch times those values.
+mat_t net_compute_grads(Network *net, Matrix x, Matrix y, int is_ce);
+
+// Per-tensor GRAD_CLIP_NORM clipping of grad_W / grad_b (train_step's clip step)
+void net_clip_grads(Network *net);
+
+// train_step's update: momentum SGD over W/b (one slab pass with flat storage),
+// pruning masks, then the activation-param rules; zeroes the grads
+void net_apply_update(Network *net, SGD *opt);
+
 mat_t eval_acc(Network *net, Matrix x, Matrix y); // Argmax out vs y
 
+// Correct predictions in out (batch x out_dim) vs labels y; last_act picks the binary rule
+int count_correct(Matrix out, Matrix y, ActType last_act);
+
+// Fused loss kernels: read outputs in place and write dL/dout into delta in the
+// same pass. CE: softmax + NLL over logits with y.data[b] = class idx. Return mean loss.
+mat_t loss_softmax_ce(Matrix logits, Matrix y, Matrix delta);
+mat_t loss_mse(Matrix out, Matrix y, Matrix delta);
+
+void net_zero_grads(Network *net);
+
+// Params (W, b, act params) in slab layout: count, gather and scatter. With flat
+// storage these are single memcpys of net->params.
+size_t net_param_count(Network *net);
+void net_get_params(Network *net, mat_t *buf);
+void net_set_params(Network *net, const mat_t *buf);
+
+// Same architecture and params with fresh buffers/caches (optimizer state not
+// copied). Layers are built with init_layer, so this draws from the default RNG stream.
+Network net_clone(Network *net);
+
+// Same architecture and W/b with layer i's activation replaced by acts[i]
+// (initialized with strats[i]); layers whose type is unchanged keep their act params.
+Network net_swap_acts(Network *net, const ActType *acts, const ActInitStrategy *strats);
+
+// Checkpoint I/O: header (arch + act types) followed by the params in slab
+// layout. load_net builds a fresh network; returns 0 on failure.
+int save_net(const char *fname, Network *net);
+int load_net(const char *fname, Network *net);
+
 #endif
\ No newline at end of file
@@ -2,25 +2,65 @@
 #include "layer.h"
 #include "config.h"
 
-void sgd_update(Layer *l, SGD *opt)
+void sgd_update_dense(mat_t *param, mat_t *vel, mat_t *grad, size_t n, SGD *opt)
 {
     mat_t lr = opt->lr;
     mat_t mom = opt->momentum;
-
-    // Update W with momentum
-    for (int i = 0; i < l->W.rows * l->W.cols; ++i)
+    for (size_t i = 0; i < n; ++i)
     {
-        l->v_W.data[i] = mom * l->v_W.data[i] - lr * l->grad_W.data[i];
-        l->W.data[i] += l->v_W.data[i];
-        l->grad_W.data[i] = 0.0; // Reset grad
+        vel[i] = mom * vel[i] - lr * grad[i];
+        param[i] += vel[i];
+        grad[i] = 0.0; // Reset grad
     }
-    // Update b
-    for (int i = 0; i < l->b.rows * l->b.cols; ++i)
+}
+
+/* Hogwild: other threads update param concurrently. Each element is read and
+   written with relaxed atomics (aligned 8-byte, so never torn); an update that
+   lands between our load and store is overwritten, which is the lost-update
+   race Hogwild accepts for sparse-enough gradients. */
+void sgd_update_dense_shared(mat_t *param, mat_t *vel, mat_t *grad, size_t n, SGD *opt)
+{
+    mat_t lr = opt->lr;
+    mat_t mom = opt->momentum;
+    for (size_t i = 0; i < n; ++i)
     {
-        l->v_b.data[i] = mom * l->v_b.data[i] - lr * l->grad_b.data[i];
-        l->b.data[i] += l->v_b.data[i];
-        l->grad_b.data[i] = 0.0;
+        mat_t p;
+        __atomic_load(&param[i], &p, __ATOMIC_RELAXED);
+        vel[i] = mom * vel[i] - lr * grad[i];
+        p += vel[i];
+        __atomic_store(&param[i], &p, __ATOMIC_RELAXED);
+        grad[i] = 0.0;
     }
+}
+
+void sgd_apply_mask(Layer *l)
+{
+    if (!l->w_mask)
+        return;
+    size_t n = (size_t)l->W.rows * l->W.cols;
+    for (size_t i = 0; i < n; ++i)
+        if (!l->w_mask[i])
+            l->W.data[i] = l->v_W.data[i] = 0.0;
+    if (l->b_mask)
+        for (int j = 0; j < l->b.cols; ++j)
+            if (!l->b_mask[j])
+                l->b.data[j] = l->v_b.data[j] = 0.0;
+    l->w_csr_stale = 1;
+}
+
+void sgd_update(Layer *l, SGD *opt)
+{
+    // Update W and b with momentum
+    sgd_update_dense(l->W.data, l->v_W.data, l->grad_W.data, (size_t)l->W.rows * l->W.cols, opt);
+    sgd_update_dense(l->b.data, l->v_b.data, l->grad_b.data, (size_t)l->b.rows * l->b.cols, opt);
+    sgd_apply_mask(l); // pruned weights stay zero
+    sgd_update_act(l, opt);
+}
+
+static void act_update(Layer *l, SGD *opt, int shared)
+{
+    mat_t lr = opt->lr;
+    mat_t mom = opt->momentum;
     // Update act params (simple SGD, no mom)
     /* Momentum update for activation params (use v_act buffer). */
     if (l->act.n_params > 0)
@@ -29,7 +69,7 @@ void sgd_update(Layer *l, SGD *opt)
         if (l->v_act.rows * l->v_act.cols < l->act.n_params)
         {
             free_matrix(l->v_act);
-            l->v_act = alloc_matrix(1, l->act.n_params);
+            l->v_act = alloc_matrix_tag(1, l->act.n_params, MEM_OPTIM);
             mat_scale(l->v_act, 0.0);
             fprintf(stderr, "[DEBUG] Allocated v_act (size=%d) for layer (in=%d out=%d)\n", l->act.n_params, l->in_dim, l->out_dim);
         }
@@ -58,12 +98,31 @@ void sgd_update(Layer *l, SGD *opt)
             mat_t effective_lr = act_lr * lr_mult;
             /* momentum update for activation params */
             l->v_act.data[i] = act_mom * l->v_act.data[i] - effective_lr * g;
-            l->act.params[i] += l->v_act.data[i];
+            mat_t p;
+            if (shared)
+                __atomic_load(&l->act.params[i], &p, __ATOMIC_RELAXED);
+            else
+                p = l->act.params[i];
+            p += l->v_act.data[i];
             l->act.grad_act[i] = 0.0; // reset
             /* Bound activation params using global config */
-            l->act.params[i] = fmin(ACT_PARAM_MAX, fmax(ACT_PARAM_MIN, l->act.params[i]));
+            p = fmin(ACT_PARAM_MAX, fmax(ACT_PARAM_MIN, p));
+            if (shared)
+                __atomic_store(&l->act.params[i], &p, __ATOMIC_RELAXED);
+            else
+                l->act.params[i] = p;
         }
 
         /* With exponent-cumulative parameterization for PIECEWISE taus, explicit ordering enforcement is unnecessary. */
     }
-}
\ No newline at end of file
+}
+
+void sgd_update_act(Layer *l, SGD *opt)
+{
+    act_update(l, opt, 0);
+}
+
+void sgd_update_act_shared(Layer *l, SGD *opt)
+{
+    act_update(l, opt, 1);
+}
@@ -15,4 +15,19 @@ typedef struct
 
 void sgd_update(Layer *l, SGD *opt); // v = mom * v - lr * grad; param += v
 
+// Momentum update over n contiguous elements (zeroes grad); used for W/b and flat slabs
+void sgd_update_dense(mat_t *param, mat_t *vel, mat_t *grad, size_t n, SGD *opt);
+
+// Same update with param read/written by relaxed atomics, for params other threads
+// update concurrently (Hogwild, hogwild.c); vel and grad stay thread-private
+void sgd_update_dense_shared(mat_t *param, mat_t *vel, mat_t *grad, size_t n, SGD *opt);
+
+// Re-zero pruned weights (and their velocities) after an update; no-op without a mask
+void sgd_apply_mask(Layer *l);
+
+// Activation-param part of sgd_update (clip, per-param lr, bounds)
+void sgd_update_act(Layer *l, SGD *opt);
+// sgd_update_act on shared act params (relaxed atomic load/store, as above)
+void sgd_update_act_shared(Layer *l, SGD *opt);
+
 #endif
\ No newline at end of file
@@ -0,0 +1,374 @@
+#include "pipeline.h"
+#include "config.h"
+#include <string.h>
+
+// Multiply-adds per input row (the stage balancing weight)
+static double layer_cost(const Layer *l)
+{
+    double c = (double)l->W.rows * l->W.cols;
+    if (l->kind == LAYER_CONV)
+        c *= (double)l->conv.conv_h * l->conv.conv_w;
+    return c;
+}
+
+// Copy of l sharing params, grads and optimizer state, with empty forward caches
+static Layer make_shell(const Layer *l)
+{
+    Layer s = *l;
+    s.act.z = s.act.out = (Matrix){0, 0, NULL};
+    s.x_cache = (Matrix){0, 0, NULL};
+    memset(&s.x_sparse, 0, sizeof(s.x_sparse));
+    s.x_is_sparse = 0;
+    s.pool_idx = NULL;
+    s.pool_cap = 0;
+    s.pool_out = (Matrix){0, 0, NULL};
+    s.stashed = 0;
+    s.x_stash = s.z_stash = NULL;
+    s.x_stash_cap = s.z_stash_cap = 0;
+    s.z_mask = NULL;
+    s.z_mask_cap = 0;
+    memset(&s.w_csr, 0, sizeof(s.w_csr));
+    s.w_csr_stale = 1;
+    return s;
+}
+
+static void free_shell(Layer *s)
+{
+    free_matrix(s->act.z);
+    free_matrix(s->act.out);
+    free_sparse(&s->x_sparse);
+    mem_free(s->pool_idx);
+    free_matrix(s->pool_out);
+    mem_free(s->x_stash);
+    mem_free(s->z_stash);
+    mem_free(s->z_mask);
+    free_sparse(&s->w_csr);
+}
+
+/* ---- one stage's step ---- */
+
+static void wait_for(Pipeline *p, int *counter, int k)
+{
+    pthread_mutex_lock(&p->mu);
+    while (*counter <= k)
+        pthread_cond_wait(&p->cv, &p->mu);
+    pthread_mutex_unlock(&p->mu);
+}
+
+static void bump(Pipeline *p, int *counter)
+{
+    pthread_mutex_lock(&p->mu);
+    ++*counter;
+    pthread_cond_broadcast(&p->cv);
+    pthread_mutex_unlock(&p->mu);
+}
+
+static int micro_rows(Pipeline *p, int k)
+{
+    int start = k * p->micro_rows;
+    return p->batch - start < p->micro_rows ? p->batch - start : p->micro_rows;
+}
+
+static void stage_forward(Pipeline *p, int s, int k)
+{
+    PipelineStage *st = &p->stages[s];
+    int m = micro_rows(p, k);
+    Matrix x;
+    if (s == 0)
+        x = (Matrix){m, p->x.cols, p->x.data + (size_t)k * p->micro_rows * p->x.cols};
+    else
+    {
+        wait_for(p, &p->stages[s - 1].fwd_done, k);
+        x = p->stages[s - 1].out[k]; // view into the previous stage's slot
+    }
+    Layer *shells = st->shells + (size_t)(k % st->n_slots) * (st->last - st->first);
+    for (int i = 0; i < st->last - st->first; ++i)
+        x = layer_forward_view(&shells[i], x);
+    st->out[k] = x;
+    bump(p, &st->fwd_done);
+}
+
+static void stage_backward(Pipeline *p, int s, int k)
+{
+    PipelineStage *st = &p->stages[s];
+    int m = micro_rows(p, k);
+    mat_t w = (mat_t)m / p->batch;
+    Matrix delta;
+    if (s == p->n_stages - 1)
+    {
+        Matrix ym = {m, p->y.cols, p->y.data + (size_t)k * p->micro_rows * p->y.cols};
+        delta = (Matrix){m, st->out[k].cols, st->loss_delta.data};
+        mat_t l = p->is_ce ? loss_softmax_ce(st->out[k], ym, delta) : loss_mse(st->out[k], ym, delta);
+        st->loss += w * l;
+    }
+    else
+    {
+        wait_for(p, &p->stages[s + 1].bwd_done, k);
+        delta = p->stages[s + 1].delta[k];
+        delta.rows = m;
+    }
+    int n = st->last - st->first;
+    Layer *shells = st->shells + (size_t)(k % st->n_slots) * n;
+    /* Inside the stage: ping-pong through two temporaries; the stage input
+       gradient goes to delta[k] for the previous stage (none for layer 0) */
+    Matrix tmp[2] = {{0, 0, NULL}, {0, 0, NULL}};
+    for (int i = n - 1; i >= 0; --i)
+    {
+        Layer *l = &shells[i];
+        Matrix din = {m, l->in_dim, NULL};
+        if (i > 0)
+        {
+            tmp[i & 1] = alloc_matrix(m, l->in_dim);
+            din.data = tmp[i & 1].data;
+        }
+        else if (s > 0)
+            din.data = st->delta[k].data;
+        layer_backward_scaled(l, delta, din, w);
+        if (i < n - 1)
+            free_matrix(tmp[(i + 1) & 1]); // delta came from it
+        delta = din;
+    }
+    bump(p, &st->bwd_done);
+}
+
+// Clip and update this stage's layers (the masters; shells share the storage)
+static void stage_update(Pipeline *p, int s)
+{
+    PipelineStage *st = &p->stages[s];
+    for (int i = st->first; i < st->last; ++i)
+    {
+        Layer *l = &p->net->layers[i];
+        mat_clip_grad(l->grad_W, GRAD_CLIP_NORM);
+        mat_clip_grad(l->grad_b, GRAD_CLIP_NORM);
+        sgd_update(l, p->opt);
+    }
+    for (int j = 0; j < st->n_slots * (st->last - st->first); ++j)
+        st->shells[j].w_csr_stale = 1; // W moved: pruned CSR copies are rebuilt
+}
+
+// 1F1B: warm-up forwards, then one forward + one backward, then the last backwards
+static void stage_run(Pipeline *p, int s)
+{
+    int warm = p->n_stages - s - 1 < p->n_mb ? p->n_stages - s - 1 : p->n_mb;
+    for (int k = 0; k < warm; ++k)
+        stage_forward(p, s, k);
+    for (int j = 0; j < p->n_mb; ++j)
+    {
+        if (warm + j < p->n_mb)
+            stage_forward(p, s, warm + j);
+        stage_backward(p, s, j);
+    }
+    stage_update(p, s);
+}
+
+typedef struct
+{
+    Pipeline *p;
+    int s;
+} StageArg;
+
+static void *stage_worker(void *arg)
+{
+    StageArg *a = arg;
+    Pipeline *p = a->p;
+    int s = a->s, seen = 0;
+    free(a);
+    for (;;)
+    {
+        pthread_mutex_lock(&p->mu);
+        while (p->gen == seen && !p->stop)
+            pthread_cond_wait(&p->cv, &p->mu);
+        if (p->stop)
+        {
+            pthread_mutex_unlock(&p->mu);
+            break;
+        }
+        seen = p->gen;
+        pthread_mutex_unlock(&p->mu);
+
+        stage_run(p, s);
+
+        bump(p, &p->done);
+    }
+    return NULL;
+}
+
+/* ---- setup ---- */
+
+void pipeline_init(Pipeline *p, Network *net, int n_stages, int n_micro)
+{
+    memset(p, 0, sizeof(*p));
+    p->net = net;
+    p->n_stages = n_stages < 1 ? 1 : n_stages > net->n_layers ? net->n_layers : n_stages;
+    p->n_micro = n_micro < 1 ? 1 : n_micro;
+    p->stages = calloc(p->n_stages, sizeof(PipelineStage));
+    if (!p->stages)
+    {
+        fprintf(stderr, "Alloc fail\n");
+        exit(1);
+    }
+    pthread_mutex_init(&p->mu, NULL);
+    pthread_cond_init(&p->cv, NULL);
+
+    /* Cut where the running cost is closest to s / S of the total, keeping at
+       least one layer per stage */
+    double total = 0.0, cum = 0.0;
+    for (int i = 0; i < net->n_layers; ++i)
+        total += layer_cost(&net->layers[i]);
+    int first = 0;
+    for (int s = 0; s < p->n_stages; ++s)
+    {
+        int last = net->n_layers - (p->n_stages - s - 1);
+        if (s < p->n_stages - 1)
+        {
+            double target = total * (s + 1) / p->n_stages;
+            int cut = first + 1;
+            double c = cum + layer_cost(&net->layers[first]);
+            while (cut < last && fabs(c + layer_cost(&net->layers[cut]) - target) < fabs(c - target))
+                c += layer_cost(&net->layers[cut++]);
+            last = cut;
+            cum = c;
+        }
+        PipelineStage *st = &p->stages[s];
+        st->first = first;
+        st->last = last;
+        st->n_slots = p->n_stages - s < p->n_micro ? p->n_stages - s : p->n_micro;
+        int n = last - first;
+        st->shells = malloc((size_t)st->n_slots * n * sizeof(Layer));
+        st->out = calloc(p->n_micro, sizeof(Matrix));
+        st->delta = calloc(p->n_micro, sizeof(Matrix));
+        if (!st->shells || !st->out || !st->delta)
+        {
+            fprintf(stderr, "Alloc fail\n");
+            exit(1);
+        }
+        for (int j = 0; j < st->n_slots; ++j)
+            for (int i = 0; i < n; ++i)
+                st->shells[j * n + i] = make_shell(&net->layers[first + i]);
+        first = last;
+    }
+    for (int s = 1; s < p->n_stages; ++s)
+    {
+        StageArg *a = malloc(sizeof(StageArg));
+        if (!a)
+        {
+            fprintf(stderr, "Alloc fail\n");
+            exit(1);
+        }
+        *a = (StageArg){p, s};
+        p->stages[s].started = pthread_create(&p->stages[s].thread, NULL, stage_worker, a) == 0;
+        if (!p->stages[s].started)
+        {
+            fprintf(stderr, "pipeline: failed to start stage %d\n", s);
+            exit(1);
+        }
+    }
+}
+
+void pipeline_free(Pipeline *p)
+{
+    pthread_mutex_lock(&p->mu);
+    p->stop = 1;
+    pthread_cond_broadcast(&p->cv);
+    pthread_mutex_unlock(&p->mu);
+    for (int s = 0; s < p->n_stages; ++s)
+    {
+        PipelineStage *st = &p->stages[s];
+        if (st->started)
+            pthread_join(st->thread, NULL);
+        for (int j = 0; j < st->n_slots * (st->last - st->first); ++j)
+            free_shell(&st->shells[j]);
+        for (int k = 0; k < p->n_micro; ++k)
+            free_matrix(st->delta[k]);
+        free_matrix(st->loss_delta);
+        free(st->shells);
+        free(st->out);
+        free(st->delta);
+    }
+    free(p->stages);
+    p->stages = NULL;
+    pthread_mutex_destroy(&p->mu);
+    pthread_cond_destroy(&p->cv);
+}
+
+// Size the inter-stage gradient buffers for rows-per-micro-batch
+static void reserve_deltas(Pipeline *p, int rows)
+{
+    if (rows <= p->rows_cap)
+        return;
+    for (int s = 0; s < p->n_stages; ++s)
+    {
+        PipelineStage *st = &p->stages[s];
+        for (int k = 0; s > 0 && k < p->n_micro; ++k)
+        {
+            free_matrix(st->delta[k]);
+            st->delta[k] = alloc_matrix_tag(rows, p->net->layers[st->first].in_dim, MEM_CACHE);
+        }
+        if (s == p->n_stages - 1)
+        {
+            free_matrix(st->loss_delta);
+            st->loss_delta = alloc_matrix_tag(rows, p->net->layers[st->last - 1].out_dim, MEM_CACHE);
+        }
+    }
+    p->rows_cap = rows;
+}
+
+mat_t pipeline_train_step(Pipeline *p, Matrix x, Matrix y, SGD *opt, int is_ce)
+{
+    Network *net = p->net;
+    // Reg (on acts only) before any stage updates its params, as in train_step
+    mat_t reg = 0.0;
+    for (int i = 0; i < net->n_layers; ++i)
+        reg += act_reg(&net->layers[i].act, 1e-4);
+
+    p->x = x;
+    p->y = y;
+    p->opt = opt;
+    p->is_ce = is_ce;
+    p->batch = x.rows;
+    p->micro_rows = (x.rows + p->n_micro - 1) / p->n_micro;
+    p->n_mb = (x.rows + p->micro_rows - 1) / p->micro_rows;
+    reserve_deltas(p, p->micro_rows);
+    for (int s = 0; s < p->n_stages; ++s)
+    {
+        p->stages[s].fwd_done = p->stages[s].bwd_done = 0;
+        p->stages[s].loss = 0.0;
+    }
+
+    pthread_mutex_lock(&p->mu);
+    p->done = 0;
+    p->gen++;
+    pthread_cond_broadcast(&p->cv);
+    pthread_mutex_unlock(&p->mu);
+
+    stage_run(p, 0);
+
+    pthread_mutex_lock(&p->mu);
+    while (p->done < p->n_stages - 1)
+        pthread_cond_wait(&p->cv, &p->mu);
+    pthread_mutex_unlock(&p->mu);
+
+    mat_t loss = p->stages[p->n_stages - 1].loss + reg;
+    if (isnan(loss) || isinf(loss))
+    {
+        fprintf(stderr, "Invalid loss in pipeline_train_step: %f\n", loss);
+        exit(1);
+    }
+    return loss;
+}
+
+void pipeline_report(Pipeline *p)
+{
+    double total = 0.0;
+    for (int i = 0; i < p->net->n_layers; ++i)
+        total += layer_cost(&p->net->layers[i]);
+    for (int s = 0; s < p->n_stages; ++s)
+    {
+        PipelineStage *st = &p->stages[s];
+        double c = 0.0;
+        for (int i = st->first; i < st->last; ++i)
+            c += layer_cost(&p->net->layers[i]);
+        printf("[PIPE] stage %d: layers %d-%d, %.1f%% of MACs, %d in-flight micro-batches\n", s, st->first,
+               st->last - 1, 100.0 * c / total, st->n_slots);
+    }
+}
@@ -0,0 +1,63 @@
+#ifndef PIPELINE_H
+#define PIPELINE_H
+
+#include "network.h"
+#include <pthread.h>
+
+/* Pipeline-parallel training: contiguous ranges of net->layers run on their
+   own threads (stages), so each stage's weights stay in its core's cache and
+   no weights are duplicated. A mini-batch is split into micro-batches that
+   flow through the stages in a 1F1B schedule: stage s runs S - s - 1 warm-up
+   forwards, then alternates one forward and one backward, then drains its
+   backwards. A stage therefore holds at most S - s micro-batches of
+   activations. Each in-flight slot has its own layer "shells" (copies of the
+   Layer structs that share W, b, their grads and the act params, but own the
+   forward caches). Grads accumulate per stage with weight rows / batch, as in
+   net_compute_grads; once a stage has run every backward it clips and applies
+   sgd_update to its own layers, while later stages may still be finishing.
+
+   Forward passes use full-precision caches (ACT_STASH_BF16 and ACT_MEM_BUDGET
+   do not apply; the micro-batch count bounds activation memory instead). */
+
+typedef struct
+{
+    int first, last;   // layers [first, last)
+    int n_slots;       // in-flight micro-batches (min(n_micro, S - s))
+    Layer *shells;     // n_slots x (last - first)
+    Matrix *out;       // per micro-batch: view of this stage's output
+    Matrix *delta;     // per micro-batch: dL/d(stage input), written by backward (s > 0)
+    Matrix loss_delta; // last stage: dL/d(output) of the current micro-batch
+    int fwd_done, bwd_done; // micro-batches finished this step (in order)
+    mat_t loss;        // last stage: weighted data loss of the step
+    pthread_t thread;
+    int started;
+} PipelineStage;
+
+typedef struct
+{
+    Network *net;
+    int n_stages, n_micro;
+    PipelineStage *stages;
+    /* Current step (read-only while stages run) */
+    Matrix x, y;
+    SGD *opt;
+    int is_ce, batch, micro_rows, n_mb;
+    int rows_cap; // micro_rows the delta buffers were sized for
+    int gen, done, stop;
+    pthread_mutex_t mu;
+    pthread_cond_t cv;
+} Pipeline;
+
+// Split net into n_stages contiguous stages balanced by multiply-adds per row
+// (n_stages is capped at n_layers) and start the stage threads; n_micro
+// micro-batches per step. Stage 0 runs on the caller's thread.
+void pipeline_init(Pipeline *p, Network *net, int n_stages, int n_micro);
+void pipeline_free(Pipeline *p);
+
+// train_step through the pipeline; returns data loss + act reg like train_step
+mat_t pipeline_train_step(Pipeline *p, Matrix x, Matrix y, SGD *opt, int is_ce);
+
+// One [PIPE] line per stage: layer range and share of the multiply-adds
+void pipeline_report(Pipeline *p);
+
+#endif
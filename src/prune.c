@@ -0,0 +1,258 @@
+#include "prune.h"
+#include "config.h"
+#include <string.h>
+
+typedef struct
+{
+    mat_t mag;
+    int idx;
+} MagIdx;
+
+static int cmp_mag(const void *a, const void *b)
+{
+    const MagIdx *x = a, *y = b;
+    if (x->mag != y->mag)
+        return x->mag < y->mag ? -1 : 1;
+    return x->idx - y->idx; // deterministic among ties (e.g. already-pruned zeros)
+}
+
+// Indices 0..n-1 ordered by ascending score
+static MagIdx *sort_scores(const mat_t *score, int n)
+{
+    MagIdx *m = malloc((size_t)n * sizeof(MagIdx));
+    if (!m)
+    {
+        fprintf(stderr, "Alloc fail\n");
+        exit(1);
+    }
+    for (int i = 0; i < n; ++i)
+    {
+        m[i].mag = score[i];
+        m[i].idx = i;
+    }
+    qsort(m, (size_t)n, sizeof(MagIdx), cmp_mag);
+    return m;
+}
+
+mat_t prune_sparsity_at(const PruneSchedule *s, mat_t target, int step)
+{
+    if (step >= s->end_step)
+        return target;
+    if (step <= s->start_step)
+        return 0.0;
+    mat_t t = (mat_t)(step - s->start_step) / (s->end_step - s->start_step);
+    return target * (1.0 - (1.0 - t) * (1.0 - t) * (1.0 - t));
+}
+
+void prune_layer(Layer *l, PruneMode mode, mat_t sparsity, int is_last)
+{
+    if (l->kind != LAYER_DENSE || (sparsity <= 0.0 && !l->w_mask))
+        return;
+    int in = l->W.rows, out = l->W.cols, n = in * out;
+    if (!l->w_mask)
+        l->w_mask = malloc((size_t)n);
+    if (!l->w_mask)
+    {
+        fprintf(stderr, "Alloc fail\n");
+        exit(1);
+    }
+    memset(l->w_mask, 1, (size_t)n);
+    if (mode == PRUNE_STRUCTURED && !is_last)
+    {
+        /* Neuron j scores by the L2 norm of its W column and bias */
+        mat_t *score = calloc((size_t)out, sizeof(mat_t));
+        for (int i = 0; i < in; ++i)
+            for (int j = 0; j < out; ++j)
+                score[j] += l->W.data[(size_t)i * out + j] * l->W.data[(size_t)i * out + j];
+        for (int j = 0; j < out; ++j)
+            score[j] += l->b.data[j] * l->b.data[j];
+        MagIdx *order = sort_scores(score, out);
+        int k = (int)(sparsity * out + 0.5);
+        if (!l->b_mask)
+            l->b_mask = malloc((size_t)out);
+        memset(l->b_mask, 1, (size_t)out);
+        for (int p = 0; p < k; ++p)
+        {
+            int j = order[p].idx;
+            l->b_mask[j] = 0;
+            for (int i = 0; i < in; ++i)
+                l->w_mask[(size_t)i * out + j] = 0;
+        }
+        free(order);
+        free(score);
+    }
+    else
+    {
+        mat_t *score = malloc((size_t)n * sizeof(mat_t));
+        for (int i = 0; i < n; ++i)
+            score[i] = fabs(l->W.data[i]);
+        MagIdx *order = sort_scores(score, n);
+        int k = (int)(sparsity * n + 0.5);
+        for (int p = 0; p < k; ++p)
+            l->w_mask[order[p].idx] = 0;
+        free(order);
+        free(score);
+    }
+    int kept = 0;
+    for (int i = 0; i < n; ++i)
+        kept += l->w_mask[i];
+    l->w_density = (mat_t)kept / n;
+    sgd_apply_mask(l); // zero the pruned weights and their momentum now
+}
+
+int prune_step(Network *net, const PruneSchedule *s, int step)
+{
+    if (step < s->start_step || step > s->end_step)
+        return 0;
+    int every = s->every > 0 ? s->every : 1;
+    if ((step - s->start_step) % every != 0 && step != s->end_step)
+        return 0;
+    for (int i = 0; i < net->n_layers; ++i)
+        if (s->target[i] > 0.0)
+            prune_layer(&net->layers[i], s->mode, prune_sparsity_at(s, s->target[i], step),
+                        i == net->n_layers - 1);
+    return 1;
+}
+
+void prune_finalize(Network *net)
+{
+    for (int li = 0; li < net->n_layers; ++li)
+    {
+        Layer *l = &net->layers[li];
+        if (l->kind != LAYER_DENSE)
+            continue;
+        int in = l->W.rows, out = l->W.cols, n = in * out;
+        int zeros = n - mat_count_nonzero(l->W);
+        if (zeros == 0 && !l->w_mask)
+            continue;
+        if (!l->w_mask)
+            l->w_mask = malloc((size_t)n);
+        for (int i = 0; i < n; ++i)
+            l->w_mask[i] = l->W.data[i] != 0.0;
+        l->w_density = (mat_t)(n - zeros) / n;
+        /* Neurons with an all-zero column and bias count as structurally removed */
+        int dead = 0;
+        for (int j = 0; j < out && li < net->n_layers - 1; ++j)
+        {
+            int alive = l->b.data[j] != 0.0;
+            for (int i = 0; i < in && !alive; ++i)
+                alive = l->W.data[(size_t)i * out + j] != 0.0;
+            if (!alive)
+            {
+                if (!l->b_mask)
+                {
+                    l->b_mask = malloc((size_t)out);
+                    memset(l->b_mask, 1, (size_t)out);
+                }
+                l->b_mask[j] = 0;
+                ++dead;
+            }
+        }
+        if (!dead)
+        {
+            free(l->b_mask);
+            l->b_mask = NULL;
+        }
+        l->w_csr_stale = 1;
+        layer_w_csr(l); // builds the CSR copy when sparse enough
+    }
+}
+
+Network prune_shrink(Network *net)
+{
+    for (int i = 0; i < net->n_layers; ++i)
+        if (net->layers[i].kind != LAYER_DENSE)
+        {
+            fprintf(stderr, "prune_shrink: conv layers are not shrunk\n");
+            return net_clone(net);
+        }
+    int n_layers = net->n_layers;
+    Layer *ls = malloc(n_layers * sizeof(Layer));
+    /* Kept inputs of the current layer (indices into its original inputs) and
+       the constant each removed input carries: act(0) of the previous layer */
+    int n_in = net->input_dim;
+    int *in_idx = malloc(n_in * sizeof(int));
+    for (int r = 0; r < n_in; ++r)
+        in_idx[r] = r;
+    unsigned char *in_alive = NULL;
+    mat_t in_const = 0.0;
+    for (int li = 0; li < n_layers; ++li)
+    {
+        Layer *l = &net->layers[li];
+        int out = l->out_dim, last = li == n_layers - 1;
+        int *out_idx = malloc(out * sizeof(int));
+        int n_out = 0;
+        for (int j = 0; j < out; ++j)
+            if (last || !l->b_mask || l->b_mask[j])
+                out_idx[n_out++] = j;
+
+        Layer nl = init_layer(n_in, n_out, l->act.type, ACT_INIT_DEFAULT);
+        for (int p = 0; p < l->act.n_params; ++p)
+        {
+            nl.act.params[p] = l->act.params[p];
+            nl.act_lr.data[p] = l->act_lr.data[p];
+        }
+        for (int r = 0; r < n_in; ++r)
+            for (int c = 0; c < n_out; ++c)
+                nl.W.data[(size_t)r * n_out + c] = l->W.data[(size_t)in_idx[r] * out + out_idx[c]];
+        for (int c = 0; c < n_out; ++c)
+        {
+            mat_t b = l->b.data[out_idx[c]];
+            for (int r = 0; in_alive && r < l->in_dim; ++r)
+                if (!in_alive[r])
+                    b += in_const * l->W.data[(size_t)r * out + out_idx[c]];
+            nl.b.data[c] = b;
+        }
+        ls[li] = nl;
+
+        /* This layer's removed neurons become the next layer's constant inputs */
+        free(in_alive);
+        in_alive = NULL;
+        if (l->b_mask && !last)
+        {
+            in_alive = malloc(out);
+            memcpy(in_alive, l->b_mask, out);
+            mat_t zero = 0.0;
+            act_eval(l->act.type, l->act.params, &zero, &in_const, 1);
+        }
+        free(in_idx);
+        in_idx = out_idx;
+        n_in = n_out;
+    }
+    free(in_idx);
+    free(in_alive);
+    Network s = init_net_layers(net->input_dim, ls, n_layers);
+    free(ls);
+    prune_finalize(&s); // unstructured zeros stay pruned
+    return s;
+}
+
+void prune_report(Network *net)
+{
+    long kept_all = 0, total_all = 0;
+    double flops_dense = 0.0, flops_eff = 0.0, mem_dense = 0.0, mem_eff = 0.0;
+    for (int i = 0; i < net->n_layers; ++i)
+    {
+        Layer *l = &net->layers[i];
+        long n = (long)l->W.rows * l->W.cols, kept = mat_count_nonzero(l->W);
+        int alive = l->out_dim;
+        if (l->b_mask)
+            for (int j = 0; j < l->out_dim; ++j)
+                alive -= !l->b_mask[j];
+        /* MACs per sample: conv weights are applied once per output position */
+        double uses = l->kind == LAYER_CONV ? (double)l->conv.conv_h * l->conv.conv_w : 1.0;
+        int csr = l->kind == LAYER_DENSE && layer_w_csr(l);
+        kept_all += kept;
+        total_all += n;
+        flops_dense += 2.0 * n * uses;
+        flops_eff += 2.0 * (csr ? kept : n) * uses;
+        mem_dense += n * sizeof(mat_t);
+        mem_eff += csr ? kept * (sizeof(mat_t) + sizeof(int)) + (l->W.rows + 1.0) * sizeof(int)
+                       : n * sizeof(mat_t);
+        printf("[PRUNE] layer %d %d->%d: %.1f%% pruned (%ld/%ld kept), %d/%d neurons%s\n", i, l->in_dim,
+               l->out_dim, 100.0 * (n - kept) / n, kept, n, alive, l->out_dim, csr ? ", CSR" : "");
+    }
+    printf("[PRUNE] total: %.1f%% pruned; FLOPs/sample %.0f -> %.0f (%.1f%%); weights %.2f MB -> %.2f MB\n",
+           100.0 * (total_all - kept_all) / total_all, flops_dense, flops_eff, 100.0 * flops_eff / flops_dense,
+           mem_dense / 1e6, mem_eff / 1e6);
+}
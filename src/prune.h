@@ -0,0 +1,53 @@
+#ifndef PRUNE_H
+#define PRUNE_H
+
+#include "network.h"
+
+/* Magnitude pruning during training (dense layers). A mask per layer marks the
+   kept weights; sgd_update re-zeros the rest after every step, so pruned
+   weights stay exactly zero. Layers at or below PRUNE_CSR_DENSITY then run
+   their products on a CSR copy of W.
+
+   Unstructured: the smallest |W| entries of a layer go.
+   Structured:   whole output neurons go (smallest L2 norm of the W column plus
+                 bias). A removed neuron outputs the constant act(0), which
+                 prune_shrink folds into the next layer's bias, so the network
+                 can be rebuilt with narrower layers. The last layer keeps
+                 its outputs (the classes) and is pruned unstructured. */
+typedef enum
+{
+    PRUNE_UNSTRUCTURED,
+    PRUNE_STRUCTURED
+} PruneMode;
+
+/* Gradual schedule: the sparsity of layer i ramps from 0 to target[i] between
+   start_step and end_step as s = target * (1 - (1 - t)^3), t in [0, 1], and
+   masks are recomputed every `every` steps on that ramp (and at end_step). */
+typedef struct
+{
+    PruneMode mode;
+    const mat_t *target; // final sparsity per layer (n_layers entries, 0 = dense)
+    int start_step, end_step, every;
+} PruneSchedule;
+
+// Scheduled sparsity for a layer with final sparsity target at train step step
+mat_t prune_sparsity_at(const PruneSchedule *s, mat_t target, int step);
+
+// Mask the smallest weights (or neurons) of l so that a fraction sparsity is pruned
+void prune_layer(Layer *l, PruneMode mode, mat_t sparsity, int is_last);
+
+// Call once per train_step with the step index; returns 1 if masks were updated
+int prune_step(Network *net, const PruneSchedule *s, int step);
+
+// Masks from the zero weights of net (e.g. after load_net) and CSR copies for
+// the inference path (net_infer); call after training or loading
+void prune_finalize(Network *net);
+
+// New dense network without the structurally removed neurons (same function up
+// to rounding); unstructured zeros are kept and re-masked. Conv nets: a clone.
+Network prune_shrink(Network *net);
+
+// Per-layer sparsity, kept neurons, FLOPs and weight memory (dense vs CSR)
+void prune_report(Network *net);
+
+#endif
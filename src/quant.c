@@ -0,0 +1,197 @@
+#include "quant.h"
+#include "config.h"
+#include <math.h>
+#include <string.h>
+
+static int8_t q8(float v)
+{
+    float r = roundf(v);
+    if (r > 127.0f)
+        r = 127.0f;
+    if (r < -127.0f)
+        r = -127.0f;
+    return (int8_t)r;
+}
+
+// Symmetric int8 scale for values in [-amax, amax]
+static float scale_for(mat_t amax)
+{
+    return amax > 0 ? (float)(amax / 127.0) : 1.0f;
+}
+
+static mat_t abs_max(const mat_t *v, size_t n)
+{
+    mat_t m = 0.0;
+    for (size_t i = 0; i < n; ++i)
+        m = fmax(m, fabs(v[i]));
+    return m;
+}
+
+/* Float forward over the calibration rows recording, per layer, the largest
+   |input|, |z| and |act(z)|. Uses act_eval so the layer caches are untouched. */
+static void calibrate(Network *net, Matrix calib, mat_t *in_max, mat_t *z_max, mat_t *out_max)
+{
+    Matrix x = calib;
+    in_max[0] = abs_max(calib.data, (size_t)calib.rows * calib.cols);
+    for (int i = 0; i < net->n_layers; ++i)
+    {
+        Layer *l = &net->layers[i];
+        size_t n = (size_t)calib.rows * l->out_dim;
+        Matrix z = alloc_matrix(calib.rows, l->out_dim);
+        Matrix out = alloc_matrix(calib.rows, l->out_dim);
+        matmul(x, l->W, z);
+        mat_add_bias(z, l->b);
+        act_eval(l->act.type, l->act.params, z.data, out.data, (int)n);
+        z_max[i] = abs_max(z.data, n);
+        if (l->act.type == PIECEWISE)
+            z_max[i] = fmin(z_max[i], ACT_Z_CLIP_B); // forward clips z anyway
+        out_max[i] = abs_max(out.data, n);
+        in_max[i + 1] = out_max[i];
+        if (i > 0)
+            free_matrix(x);
+        free_matrix(z);
+        x = out;
+    }
+    free_matrix(x);
+}
+
+QNet quantize_net(Network *net, Matrix calib)
+{
+    QNet q = {net->n_layers, net->input_dim, malloc(net->n_layers * sizeof(QLayer))};
+    mat_t *in_max = malloc((net->n_layers + 1) * sizeof(mat_t));
+    mat_t *z_max = malloc(net->n_layers * sizeof(mat_t));
+    mat_t *out_max = malloc(net->n_layers * sizeof(mat_t));
+    calibrate(net, calib, in_max, z_max, out_max);
+    for (int i = 0; i < net->n_layers; ++i)
+    {
+        Layer *l = &net->layers[i];
+        QLayer *ql = &q.layers[i];
+        int in = l->in_dim, out = l->out_dim;
+        ql->in_dim = in;
+        ql->out_dim = out;
+        ql->act_type = l->act.type;
+        ql->in_scale = scale_for(in_max[i]);
+        ql->z_scale = scale_for(z_max[i]);
+        ql->out_scale = scale_for(out_max[i]);
+        ql->W = malloc((size_t)in * out);
+        ql->rq_mult = malloc(out * sizeof(float));
+        ql->rq_bias = malloc(out * sizeof(float));
+        for (int j = 0; j < out; ++j)
+        {
+            /* Per-output-channel weight scale */
+            mat_t wmax = 0.0;
+            for (int k = 0; k < in; ++k)
+                wmax = fmax(wmax, fabs(l->W.data[k * out + j]));
+            float ws = scale_for(wmax);
+            for (int k = 0; k < in; ++k)
+                ql->W[(size_t)j * in + k] = q8((float)(l->W.data[k * out + j] / ws));
+            ql->rq_mult[j] = ql->in_scale * ws / ql->z_scale;
+            ql->rq_bias[j] = (float)(l->b.data[j] / ql->z_scale);
+        }
+        /* Learned activation evaluated once per possible int8 pre-activation */
+        for (int k = 0; k < 256; ++k)
+        {
+            mat_t zr = (k - 128) * (mat_t)ql->z_scale, o;
+            act_eval(l->act.type, l->act.params, &zr, &o, 1);
+            ql->lut[k] = q8((float)(o / ql->out_scale));
+        }
+    }
+    free(in_max);
+    free(z_max);
+    free(out_max);
+    return q;
+}
+
+void free_qnet(QNet *q)
+{
+    for (int i = 0; i < q->n_layers; ++i)
+    {
+        free(q->layers[i].W);
+        free(q->layers[i].rq_mult);
+        free(q->layers[i].rq_bias);
+    }
+    free(q->layers);
+}
+
+void qnet_forward(QNet *q, Matrix x, Matrix out)
+{
+    int batch = x.rows;
+    int max_dim = q->input_dim;
+    for (int i = 0; i < q->n_layers; ++i)
+        if (q->layers[i].out_dim > max_dim)
+            max_dim = q->layers[i].out_dim;
+    int8_t *cur = malloc((size_t)batch * max_dim);
+    int8_t *nxt = malloc((size_t)batch * max_dim);
+    float inv = 1.0f / q->layers[0].in_scale;
+    for (size_t i = 0; i < (size_t)batch * x.cols; ++i)
+        cur[i] = q8((float)x.data[i] * inv);
+    for (int li = 0; li < q->n_layers; ++li)
+    {
+        QLayer *ql = &q->layers[li];
+        int in = ql->in_dim, od = ql->out_dim;
+        for (int b = 0; b < batch; ++b)
+        {
+            const int8_t *xr = cur + (size_t)b * in;
+            int8_t *orow = nxt + (size_t)b * od;
+            for (int j = 0; j < od; ++j)
+            {
+                /* int8 x int8 -> int32 dot product, then requantize + LUT */
+                const int8_t *w = ql->W + (size_t)j * in;
+                int32_t acc = 0;
+                for (int k = 0; k < in; ++k)
+                    acc += (int32_t)xr[k] * w[k];
+                int zq = q8(acc * ql->rq_mult[j] + ql->rq_bias[j]);
+                orow[j] = ql->lut[zq + 128];
+            }
+        }
+        int8_t *t = cur;
+        cur = nxt;
+        nxt = t;
+    }
+    QLayer *last = &q->layers[q->n_layers - 1];
+    for (size_t i = 0; i < (size_t)batch * last->out_dim; ++i)
+        out.data[i] = cur[i] * (mat_t)last->out_scale;
+    free(cur);
+    free(nxt);
+}
+
+mat_t qnet_eval_acc(QNet *q, Matrix x, Matrix y)
+{
+    QLayer *last = &q->layers[q->n_layers - 1];
+    Matrix out = alloc_matrix(x.rows, last->out_dim);
+    qnet_forward(q, x, out);
+    int correct = count_correct(out, y, last->act_type);
+    free_matrix(out);
+    return (mat_t)correct / x.rows;
+}
+
+size_t qnet_bytes(QNet *q)
+{
+    size_t bytes = 0;
+    for (int i = 0; i < q->n_layers; ++i)
+    {
+        QLayer *ql = &q->layers[i];
+        bytes += (size_t)ql->in_dim * ql->out_dim + 2 * ql->out_dim * sizeof(float) + sizeof(ql->lut);
+    }
+    return bytes;
+}
+
+void quant_report(Network *net, Matrix calib, Matrix x, Matrix y)
+{
+    for (int i = 0; i < net->n_layers; ++i)
+        if (net->layers[i].kind != LAYER_DENSE)
+        {
+            printf("[QUANT] skipped: layer %d is not dense (int8 path covers dense nets only)\n", i);
+            return;
+        }
+    mat_t acc = eval_acc(net, x, y);
+    QNet q = quantize_net(net, calib);
+    mat_t qacc = qnet_eval_acc(&q, x, y);
+    size_t fbytes = 0;
+    for (int i = 0; i < net->n_layers; ++i)
+        fbytes += ((size_t)net->layers[i].in_dim + 1) * net->layers[i].out_dim * sizeof(mat_t);
+    size_t qbytes = qnet_bytes(&q);
+    printf("[QUANT] int8 acc=%.4f float acc=%.4f delta=%+.4f | params %zu -> %zu bytes (%.1fx smaller)\n",
+           qacc, acc, qacc - acc, fbytes, qbytes, (double)fbytes / qbytes);
+    free_qnet(&q);
+}
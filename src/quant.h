@@ -0,0 +1,47 @@
+#ifndef QUANT_H
+#define QUANT_H
+
+#include "network.h"
+#include <stdint.h>
+
+/* Int8 inference for a trained Network.
+   Weights: symmetric int8 with one scale per output channel.
+   Activations: symmetric int8 with one scale per layer boundary, calibrated
+   on a sample of the training set. Each layer runs an int8 GEMM with int32
+   accumulation, requantizes to the pre-activation scale and maps the result
+   through a 256-entry lookup table holding the learned activation. */
+typedef struct
+{
+    int in_dim, out_dim;
+    int8_t *W;       // out_dim x in_dim (transposed so each output channel is contiguous)
+    float *rq_mult;  // per channel: in_scale * w_scale[j] / z_scale
+    float *rq_bias;  // per channel: b[j] / z_scale
+    float in_scale;  // real = q * in_scale for this layer's input
+    float z_scale;   // pre-activation scale (LUT index)
+    float out_scale; // post-activation scale (= next layer's in_scale)
+    int8_t lut[256]; // lut[zq + 128] = quantized act(zq * z_scale)
+    ActType act_type;
+} QLayer;
+
+typedef struct
+{
+    int n_layers, input_dim;
+    QLayer *layers;
+} QNet;
+
+// Calibrate scales on calib (rows of training inputs) and quantize net
+QNet quantize_net(Network *net, Matrix calib);
+void free_qnet(QNet *q);
+
+// Int8 forward of x; out (batch x out_dim) receives dequantized outputs
+void qnet_forward(QNet *q, Matrix x, Matrix out);
+
+mat_t qnet_eval_acc(QNet *q, Matrix x, Matrix y);
+
+// Bytes held by the quantized weights/biases/LUTs
+size_t qnet_bytes(QNet *q);
+
+// Quantize, evaluate on (x, y) and print accuracy delta vs eval_acc and footprint
+void quant_report(Network *net, Matrix calib, Matrix x, Matrix y);
+
+#endif
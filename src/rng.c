@@ -0,0 +1,99 @@
+#include "rng.h"
+
+#define RNG_GAMMA 0x9E3779B97F4A7C15ULL // golden-ratio Weyl increment
+
+static uint64_t rng_seed_val = 0;
+static uint64_t rng_global_ctr = 0; // next free draw of the default stream
+
+static inline uint64_t mix64(uint64_t z)
+{
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+static inline mat_t u64_to_unit(uint64_t x)
+{
+    return (mat_t)(x >> 11) * (1.0 / 9007199254740992.0); // 2^-53
+}
+
+void rng_seed(uint64_t seed)
+{
+    rng_seed_val = seed;
+    __atomic_store_n(&rng_global_ctr, 0, __ATOMIC_RELAXED);
+}
+
+uint64_t rng_get_seed(void)
+{
+    return rng_seed_val;
+}
+
+Rng rng_stream_seed(uint64_t seed, uint64_t stream)
+{
+    Rng r;
+    r.key = mix64(seed + RNG_GAMMA) ^ mix64(stream * 0xD1B54A32D192ED03ULL + 1);
+    r.ctr = 0;
+    return r;
+}
+
+Rng rng_stream(uint64_t stream)
+{
+    return rng_stream_seed(rng_seed_val, stream);
+}
+
+uint64_t rng_u64_at(const Rng *r, uint64_t i)
+{
+    return mix64(r->key + (i + 1) * RNG_GAMMA);
+}
+
+uint64_t rng_u64(Rng *r)
+{
+    return rng_u64_at(r, r->ctr++);
+}
+
+mat_t rng_uniform(Rng *r)
+{
+    return u64_to_unit(rng_u64(r));
+}
+
+uint64_t rng_below(Rng *r, uint64_t n)
+{
+    uint64_t limit = UINT64_MAX - UINT64_MAX % n; // reject the partial last bucket
+    uint64_t x;
+    do
+        x = rng_u64(r);
+    while (x >= limit);
+    return x % n;
+}
+
+void rng_fill_uniform_at(const Rng *r, uint64_t offset, mat_t *dst, size_t n, mat_t low, mat_t high)
+{
+    mat_t range = high - low;
+    uint64_t base = r->key + (r->ctr + offset + 1) * RNG_GAMMA;
+    for (size_t k = 0; k < n; ++k)
+        dst[k] = low + u64_to_unit(mix64(base + k * RNG_GAMMA)) * range;
+}
+
+void rng_fill_uniform(Rng *r, mat_t *dst, size_t n, mat_t low, mat_t high)
+{
+    rng_fill_uniform_at(r, 0, dst, n, low, high);
+    r->ctr += n;
+}
+
+void rng_shuffle(Rng *r, int *idx, int n)
+{
+    for (int i = n - 1; i > 0; --i)
+    {
+        int j = (int)rng_below(r, (uint64_t)i + 1);
+        int t = idx[i];
+        idx[i] = idx[j];
+        idx[j] = t;
+    }
+}
+
+Rng rng_global_take(uint64_t n)
+{
+    Rng r = rng_stream(RNG_STREAM_INIT);
+    r.ctr = __atomic_fetch_add(&rng_global_ctr, n, __ATOMIC_RELAXED);
+    return r;
+}
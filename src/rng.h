@@ -0,0 +1,56 @@
+#ifndef RNG_H
+#define RNG_H
+
+#include "utils.h"
+
+/* Counter-based generator (SplitMix64 finalizer over a Weyl sequence): draw i
+   of a stream is a pure function of (seed, stream, i), so any slice of a
+   stream can be generated independently. Threads that fill disjoint ranges of
+   one stream produce the same bits as a single thread, in any order.
+
+   srand_seed(seed) reseeds every stream and resets the default stream that
+   mat_rand_xavier / mat_rand_uniform (weight and activation init) draw from.
+   Other consumers use their own stream IDs so their values do not depend on
+   how many numbers were drawn elsewhere. */
+typedef struct
+{
+    uint64_t key; // derived from (seed, stream)
+    uint64_t ctr; // index of the next draw
+} Rng;
+
+#define RNG_STREAM_INIT 0    // default stream (parameter init)
+#define RNG_STREAM_DATA 1    // synthetic datasets (gen_spirals training set)
+#define RNG_STREAM_SHUFFLE 2 // batch order
+#define RNG_STREAM_SYNTH 3   // synth.c projections / cluster centers
+#define RNG_STREAM_DATA_VAL 4 // held-out draws of the synthetic datasets
+#define RNG_STREAM_WORKER 64 // + worker id: per-thread streams
+
+void rng_seed(uint64_t seed);
+uint64_t rng_get_seed(void);
+
+// Stream of the current seed (rng_seed / srand_seed), positioned at draw 0
+Rng rng_stream(uint64_t stream);
+Rng rng_stream_seed(uint64_t seed, uint64_t stream);
+
+uint64_t rng_u64(Rng *r);
+mat_t rng_uniform(Rng *r);             // [0, 1), 53 random bits
+uint64_t rng_below(Rng *r, uint64_t n); // [0, n), unbiased (n > 0)
+
+// Draw i of the stream (no state change)
+uint64_t rng_u64_at(const Rng *r, uint64_t i);
+
+// dst[k] = uniform [low, high) for draws r->ctr + offset + k; does not advance r.
+// Independent per element (no loop-carried state), so it vectorizes and splits
+// across threads
+void rng_fill_uniform_at(const Rng *r, uint64_t offset, mat_t *dst, size_t n, mat_t low, mat_t high);
+// Same starting at r->ctr, then advances r by n
+void rng_fill_uniform(Rng *r, mat_t *dst, size_t n, mat_t low, mat_t high);
+
+// Fisher-Yates shuffle of idx[0..n)
+void rng_shuffle(Rng *r, int *idx, int n);
+
+// Reserve n draws of the default stream (atomic, so callable from any thread)
+// and return a generator positioned at the first of them
+Rng rng_global_take(uint64_t n);
+
+#endif
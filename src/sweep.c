@@ -0,0 +1,247 @@
+#include "sweep.h"
+#include "optimizer.h"
+#include <ctype.h>
+#include <string.h>
+
+// Short names used in the per-run CSV param headers (l{layer}_{act}_p{idx})
+static const char *act_short_name(ActType t)
+{
+    switch (t)
+    {
+    case PRELU: return "prelu";
+    case POLY_CUBIC: return "poly";
+    case PIECEWISE: return "piecewise";
+    case SWISH: return "swish";
+    case FIXED_RELU: return "relu";
+    case FIXED_SIG: return "sig";
+    }
+    return "unknown";
+}
+
+static void lower_into(char *dst, const char *src)
+{
+    while (*src)
+        *dst++ = (char)tolower((unsigned char)*src++);
+    *dst = '\0';
+}
+
+static int net_total_act_params(Network *net)
+{
+    int tp = 0;
+    for (int i = 0; i < net->n_layers; ++i)
+        tp += act_get_nparams(&net->layers[i].act);
+    return tp;
+}
+
+static void run_log_header(SweepRun *r)
+{
+    int tp = net_total_act_params(&r->net);
+    const char **names = tp > 0 ? malloc(tp * sizeof(char *)) : NULL;
+    int idx = 0;
+    for (int i = 0; i < r->net.n_layers; ++i)
+    {
+        Activation *a = &r->net.layers[i].act;
+        for (int j = 0; j < act_get_nparams(a); ++j)
+        {
+            char *buf = malloc(64);
+            sprintf(buf, "l%d_%s_p%d", i, act_short_name(a->type), j);
+            names[idx++] = buf;
+        }
+    }
+    log_csv_header(r->logfile, tp, names);
+    for (int i = 0; i < tp; ++i)
+        free((void *)names[i]);
+    free(names);
+}
+
+static void run_log_epoch(SweepRun *r, mat_t acc)
+{
+    int tp = net_total_act_params(&r->net);
+    mat_t *params = tp > 0 ? malloc(tp * sizeof(mat_t)) : NULL;
+    int idx = 0;
+    for (int i = 0; i < r->net.n_layers; ++i)
+    {
+        Activation *a = &r->net.layers[i].act;
+        for (int j = 0; j < act_get_nparams(a); ++j)
+            params[idx++] = act_get_params(a)[j];
+    }
+    log_csv(r->logfile, r->epochs_done, r->loss, acc, tp, params);
+    free(params);
+}
+
+static void run_init(SweepRun *r, SweepSpec *spec, ActType act, ActInitStrategy strat)
+{
+    int n_layers = spec->n_arch - 1;
+    ActType *acts = malloc(n_layers * sizeof(ActType));
+    ActInitStrategy *strats = malloc(n_layers * sizeof(ActInitStrategy));
+    /* Same layout as scripts/run_ablation.py: hidden layers use the swept act
+       and init, the output layer is FIXED_SIG with identity init */
+    for (int i = 0; i < n_layers; ++i)
+    {
+        acts[i] = i < n_layers - 1 ? act : FIXED_SIG;
+        strats[i] = i < n_layers - 1 ? strat : ACT_INIT_IDENTITY;
+    }
+    /* Re-seed per configuration so every run starts from the same weights it
+       would get as a standalone binary */
+    srand_seed(spec->seed);
+    r->net = init_net(spec->arch[0], spec->arch, spec->n_arch, acts, strats);
+    r->fast = tiny_bind(&r->tiny, &r->net);
+    SGD opt = {0.01, 0.9, 0.01, 0.9, 1.0};
+    r->opt = opt;
+    r->act = act;
+    r->strat = strat;
+    r->loss = 0.0;
+    r->val_acc = 0.0;
+    r->test_acc = 0.0;
+    r->epochs_done = 0;
+    r->alive = 1;
+    bench_init(&r->clock);
+    char act_l[32], strat_l[32];
+    lower_into(act_l, act_type_name(act));
+    lower_into(strat_l, act_init_name(strat));
+    sprintf(r->logfile, "experiments/results/%s_%s_%s_results_%u.csv", spec->dataset, act_l, strat_l, spec->seed);
+    run_log_header(r);
+    free(acts);
+    free(strats);
+}
+
+static void run_train_epoch(SweepRun *r, SweepSpec *spec)
+{
+    int n = spec->X_train.rows;
+    int bs = spec->batch_size > 0 ? spec->batch_size : n;
+    mat_t epoch_loss = 0.0;
+    bench_epoch_begin(&r->clock);
+    for (int start = 0; start < n; start += bs)
+    {
+        int m = start + bs < n ? bs : n - start;
+        Matrix xb = {m, spec->X_train.cols, spec->X_train.data + (size_t)start * spec->X_train.cols};
+        Matrix yb = {m, spec->Y_train.cols, spec->Y_train.data + (size_t)start * spec->Y_train.cols};
+        epoch_loss += (r->fast ? tiny_train_step(&r->tiny, xb, yb, &r->opt, spec->is_ce)
+                               : train_step(&r->net, xb, yb, &r->opt, spec->is_ce)) * m;
+    }
+    bench_epoch_end(&r->clock, n);
+    r->loss = epoch_loss / n;
+    r->val_acc = r->fast ? tiny_eval_acc(&r->tiny, spec->X_val, spec->Y_val) : eval_acc(&r->net, spec->X_val, spec->Y_val);
+    r->epochs_done++;
+    tiny_sync(&r->tiny, &r->net); // act params for the log
+    run_log_epoch(r, r->val_acc);
+}
+
+// A run stops: score it on the test set (if any) for the final report
+static void run_free(SweepRun *r, SweepSpec *spec)
+{
+    r->test_acc = r->val_acc;
+    if (spec->X_test.rows > 0)
+        r->test_acc = r->fast ? tiny_eval_acc(&r->tiny, spec->X_test, spec->Y_test)
+                              : eval_acc(&r->net, spec->X_test, spec->Y_test);
+    if (r->fast)
+        tiny_free(&r->tiny);
+    free_net(&r->net);
+}
+
+// Better first: higher held-out accuracy, then lower training loss
+static int run_cmp(const void *pa, const void *pb)
+{
+    const SweepRun *a = *(const SweepRun *const *)pa, *b = *(const SweepRun *const *)pb;
+    if (a->val_acc != b->val_acc)
+        return a->val_acc > b->val_acc ? -1 : 1;
+    if (a->loss != b->loss)
+        return a->loss < b->loss ? -1 : 1;
+    return 0;
+}
+
+static int run_cmp_loss(const void *pa, const void *pb)
+{
+    const SweepRun *a = *(const SweepRun *const *)pa, *b = *(const SweepRun *const *)pb;
+    if (a->loss != b->loss)
+        return a->loss < b->loss ? -1 : 1;
+    return 0;
+}
+
+// One successive-halving bracket over runs[0..n); returns epochs trained
+static long sweep_bracket(SweepSpec *spec, SweepRun **runs, int n)
+{
+    long epochs = 0;
+    int budget = spec->min_epochs < spec->max_epochs ? spec->min_epochs : spec->max_epochs;
+    int alive = n;
+    for (;;)
+    {
+        for (int i = 0; i < alive; ++i)
+        {
+            while (runs[i]->epochs_done < budget)
+            {
+                run_train_epoch(runs[i], spec);
+                ++epochs;
+            }
+        }
+        qsort(runs, alive, sizeof(SweepRun *), spec->rank_by_loss ? run_cmp_loss : run_cmp);
+        printf("[SWEEP] %s rung @%d epochs:", spec->dataset, budget);
+        for (int i = 0; i < alive; ++i)
+            printf(" %s/%s=%.3f", act_type_name(runs[i]->act), act_init_name(runs[i]->strat), runs[i]->val_acc);
+        printf("\n");
+        if (budget >= spec->max_epochs)
+            break;
+        int keep = (alive + spec->eta - 1) / spec->eta;
+        for (int i = keep; i < alive; ++i)
+        {
+            runs[i]->alive = 0;
+            run_free(runs[i], spec); // losers stop here; their rows keep the last rung's metrics
+        }
+        alive = keep;
+        /* A lone survivor goes straight to the full budget */
+        budget = alive == 1 ? spec->max_epochs : budget * spec->eta;
+        if (budget > spec->max_epochs)
+            budget = spec->max_epochs;
+    }
+    return epochs;
+}
+
+long sweep_successive_halving(SweepSpec *spec, ActType *acts, int n_acts,
+                              ActInitStrategy *strats, int n_strats, const char *out_csv)
+{
+    int n = n_acts * n_strats;
+    SweepRun *runs = malloc(n * sizeof(SweepRun));
+    SweepRun **order = malloc(n * sizeof(SweepRun *));
+    for (int s = 0; s < n_strats; ++s)
+        for (int a = 0; a < n_acts; ++a)
+        {
+            int k = s * n_acts + a;
+            run_init(&runs[k], spec, acts[a], strats[s]);
+            order[k] = &runs[k];
+        }
+    long epochs = 0;
+    if (spec->group_by_init)
+    {
+        for (int s = 0; s < n_strats; ++s)
+            epochs += sweep_bracket(spec, order + s * n_acts, n_acts);
+    }
+    else
+    {
+        epochs = sweep_bracket(spec, order, n);
+    }
+    printf("[SWEEP] %s: %ld epochs trained (full grid: %d)\n", spec->dataset, epochs, n * spec->max_epochs);
+
+    for (int k = 0; k < n; ++k)
+        if (runs[k].alive)
+            run_free(&runs[k], spec);
+
+    FILE *f = fopen(out_csv, "a");
+    if (f)
+    {
+        fseek(f, 0, SEEK_END);
+        if (ftell(f) == 0)
+            fprintf(f, "dataset,act_hidden,act_init,seed,final_loss,final_acc,logfile,epochs\n");
+        for (int k = 0; k < n; ++k)
+            fprintf(f, "%s,%s,%s,%u,%.6f,%.6f,%s,%d\n", spec->dataset, act_type_name(runs[k].act),
+                    act_init_name(runs[k].strat), spec->seed, runs[k].loss, runs[k].test_acc,
+                    runs[k].logfile, runs[k].epochs_done);
+        fclose(f);
+    }
+    else
+    {
+        fprintf(stderr, "Failed to open %s\n", out_csv);
+    }
+    free(order);
+    free(runs);
+    return epochs;
+}
@@ -0,0 +1,48 @@
+#ifndef SWEEP_H
+#define SWEEP_H
+
+#include "network.h"
+#include "bench.h"
+#include "tiny.h"
+
+/* Successive-halving sweep over activation x init configurations.
+   All configurations train for min_epochs, are ranked on held-out accuracy
+   and only the top 1/eta continue (from their in-memory state) to a budget
+   eta times larger, until one is left or max_epochs is reached. */
+typedef struct
+{
+    const char *dataset; // used for log names and the CSV dataset column
+    int *arch;
+    int n_arch;
+    int is_ce;
+    Matrix X_train, Y_train, X_val, Y_val;
+    Matrix X_test, Y_test; // final_acc of each run once it stops (rows 0: report val_acc);
+                           // never used for ranking
+    int batch_size; // <= 0: full batch per epoch
+    int min_epochs, max_epochs, eta;
+    int group_by_init; // run one bracket per init strategy (matches print_winners)
+    int rank_by_loss;  // rank on training loss instead (held-out set too small to
+                       // separate configs by accuracy, e.g. the 4 XOR points)
+    unsigned int seed;
+} SweepSpec;
+
+typedef struct
+{
+    ActType act;
+    ActInitStrategy strat;
+    Network net;
+    SGD opt;
+    mat_t loss, val_acc, test_acc;
+    int epochs_done, alive;
+    BenchClock clock; // training time of this configuration (BENCH_LOG columns)
+    TinyNet tiny;     // compiled instance of net (tiny.c), when there is one
+    int fast;         // training runs on tiny; net is synced before logging
+    char logfile[256];
+} SweepRun;
+
+// Runs the sweep and appends one row per configuration to out_csv
+// (ablations.csv columns plus 'epochs'). Returns the number of epochs trained.
+long sweep_successive_halving(SweepSpec *spec, ActType *acts, int n_acts,
+                              ActInitStrategy *strats, int n_strats, const char *out_csv);
+
+#endif
@@ -0,0 +1,235 @@
+#include "synth.h"
+#include "rng.h"
+#include <pthread.h>
+#include <string.h>
+
+#define SYNTH_PI 3.141592653589793
+
+static const char *synth_names[] = {"spirals", "moons", "xor", "blobs"};
+
+const char *synth_kind_name(SynthKind k)
+{
+    return k >= SYNTH_SPIRALS && k <= SYNTH_BLOBS ? synth_names[k] : "unknown";
+}
+
+int synth_kind_from_name(const char *s, SynthKind *k)
+{
+    for (int i = 0; i <= SYNTH_BLOBS; ++i)
+        if (strcmp(s, synth_names[i]) == 0)
+        {
+            *k = (SynthKind)i;
+            return 1;
+        }
+    return 0;
+}
+
+// Box-Muller pair from two draws (1 - u keeps the log argument in (0, 1])
+static void gauss2(Rng *r, mat_t *a, mat_t *b)
+{
+    mat_t u = 1.0 - rng_uniform(r), v = rng_uniform(r);
+    mat_t m = sqrt(-2.0 * log(u));
+    *a = m * cos(2.0 * SYNTH_PI * v);
+    *b = m * sin(2.0 * SYNTH_PI * v);
+}
+
+// n Gaussians into dst (n rounded up to pairs internally)
+static void gauss_fill(Rng *r, mat_t *dst, int n)
+{
+    for (int j = 0; j + 1 < n; j += 2)
+        gauss2(r, &dst[j], &dst[j + 1]);
+    if (n & 1)
+    {
+        mat_t spare;
+        gauss2(r, &dst[n - 1], &spare);
+    }
+}
+
+SynthGen synth_init(const SynthSpec *spec)
+{
+    if (spec->n < 1 || spec->classes < 2 || spec->dim < 2 || spec->noise < 0.0)
+    {
+        fprintf(stderr, "synth: need n >= 1, classes >= 2, dim >= 2, noise >= 0\n");
+        exit(1);
+    }
+    SynthGen g;
+    g.spec = *spec;
+    g.proj = NULL;
+    g.centers = NULL;
+    g.stride = 4 + 2 * (uint64_t)((spec->dim + 1) / 2); // base point + one Gaussian per feature
+    Rng r = rng_stream_seed(spec->seed, RNG_STREAM_SYNTH);
+    if (spec->kind == SYNTH_BLOBS)
+    {
+        g.centers = malloc((size_t)spec->classes * spec->dim * sizeof(mat_t));
+        if (!g.centers)
+        {
+            fprintf(stderr, "Alloc fail\n");
+            exit(1);
+        }
+        rng_fill_uniform(&r, g.centers, (size_t)spec->classes * spec->dim, -4.0, 4.0);
+    }
+    else if (spec->dim > 2)
+    {
+        g.proj = malloc(2 * (size_t)spec->dim * sizeof(mat_t));
+        if (!g.proj)
+        {
+            fprintf(stderr, "Alloc fail\n");
+            exit(1);
+        }
+        gauss_fill(&r, g.proj, 2 * spec->dim);
+    }
+    return g;
+}
+
+void synth_free(SynthGen *g)
+{
+    free(g->proj);
+    free(g->centers);
+    g->proj = g->centers = NULL;
+}
+
+void synth_rows(const SynthGen *g, long start, long count, mat_t *x, mat_t *y)
+{
+    const SynthSpec *s = &g->spec;
+    int dim = s->dim, k = s->classes;
+    Rng base = rng_stream_seed(s->seed, RNG_STREAM_DATA);
+    for (long i = 0; i < count; ++i)
+    {
+        long row = start + i;
+        int c = (int)(row % k);
+        mat_t *xr = x + (size_t)i * dim;
+        Rng r = base;
+        r.ctr = (uint64_t)row * g->stride;
+        y[i] = c;
+        if (s->kind == SYNTH_BLOBS)
+        {
+            gauss_fill(&r, xr, dim);
+            for (int j = 0; j < dim; ++j)
+                xr[j] = g->centers[(size_t)c * dim + j] + s->noise * xr[j];
+            continue;
+        }
+        mat_t p0, p1, u = rng_uniform(&r), v = rng_uniform(&r);
+        switch (s->kind)
+        {
+        case SYNTH_SPIRALS:
+        {
+            mat_t a = 1.75 * SYNTH_PI * u + 2.0 * SYNTH_PI * c / k;
+            p0 = 5.0 * u * cos(a);
+            p1 = 5.0 * u * sin(a);
+            break;
+        }
+        case SYNTH_MOONS:
+        {
+            mat_t t = SYNTH_PI * u;
+            p0 = (c & 1 ? 1.0 - cos(t) : cos(t)) + 3.0 * (c / 2);
+            p1 = c & 1 ? 0.5 - sin(t) : sin(t);
+            break;
+        }
+        default: // SYNTH_XOR
+        {
+            int ix = (int)(u * k);
+            ix = ix < k ? ix : k - 1;
+            int iy = ((c - ix) % k + k) % k;
+            p0 = (ix + v) / k * 2.0 - 1.0;
+            p1 = (iy + rng_uniform(&r)) / k * 2.0 - 1.0;
+            break;
+        }
+        }
+        r.ctr = (uint64_t)row * g->stride + 4; // feature noise starts after the base-point draws
+        gauss_fill(&r, xr, dim);
+        for (int j = 0; j < dim; ++j)
+        {
+            mat_t b = g->proj ? p0 * g->proj[j] + p1 * g->proj[dim + j] : (j == 0 ? p0 : p1);
+            xr[j] = b + s->noise * xr[j];
+        }
+    }
+}
+
+typedef struct
+{
+    const SynthGen *g;
+    long start, count;
+    mat_t *x, *y;
+} SynthTask;
+
+static void *synth_worker(void *arg)
+{
+    SynthTask *t = arg;
+    synth_rows(t->g, t->start, t->count, t->x, t->y);
+    return NULL;
+}
+
+// Rows [start, start + count) split across n_threads (the caller runs the last share)
+static void synth_rows_par(const SynthGen *g, long start, long count, mat_t *x, mat_t *y, int n_threads)
+{
+    if (n_threads < 1)
+        n_threads = 1;
+    if (n_threads > count)
+        n_threads = (int)count;
+    n_threads = n_threads < GEMM_MAX_THREADS ? n_threads : GEMM_MAX_THREADS;
+    pthread_t th[GEMM_MAX_THREADS];
+    int started[GEMM_MAX_THREADS] = {0};
+    SynthTask tasks[GEMM_MAX_THREADS];
+    long share = (count + n_threads - 1) / n_threads;
+    for (int t = 0; t < n_threads; ++t)
+    {
+        long lo = t * share, hi = lo + share < count ? lo + share : count;
+        if (lo >= hi)
+            break;
+        tasks[t] = (SynthTask){g, start + lo, hi - lo, x + (size_t)lo * g->spec.dim, y + lo};
+        started[t] = hi < count && pthread_create(&th[t], NULL, synth_worker, &tasks[t]) == 0;
+        if (!started[t])
+            synth_worker(&tasks[t]); // last share, or no thread available: run inline
+    }
+    for (int t = 0; t < n_threads; ++t)
+        if (started[t])
+            pthread_join(th[t], NULL);
+}
+
+void synth_generate(const SynthSpec *spec, Matrix *X, Matrix *Y, int n_threads)
+{
+    SynthGen g = synth_init(spec);
+    *X = alloc_matrix_tag((int)spec->n, spec->dim, MEM_DATA);
+    *Y = alloc_matrix_tag((int)spec->n, 1, MEM_DATA);
+    synth_rows_par(&g, 0, spec->n, X->data, Y->data, n_threads);
+    synth_free(&g);
+}
+
+int synth_write(const SynthSpec *spec, const char *path, int n_threads)
+{
+    if (spec->n > 2147483647L)
+    {
+        fprintf(stderr, "synth: the dataset header stores n as int32\n");
+        return 0;
+    }
+    FILE *f = fopen(path, "wb");
+    if (!f)
+        return 0;
+    SynthGen g = synth_init(spec);
+    int hdr[3] = {(int)spec->n, spec->dim, 1};
+    int ok = fwrite(hdr, sizeof(int), 3, f) == 3;
+    long chunk = SYNTH_CHUNK_ROWS;
+    mat_t *x = malloc((size_t)chunk * spec->dim * sizeof(mat_t)), *y = malloc((size_t)chunk * sizeof(mat_t));
+    if (!x || !y)
+    {
+        fprintf(stderr, "Alloc fail\n");
+        exit(1);
+    }
+    /* X for all rows, then Y (labels are i % classes, so no second generation pass) */
+    for (long s = 0; ok && s < spec->n; s += chunk)
+    {
+        long m = spec->n - s < chunk ? spec->n - s : chunk;
+        synth_rows_par(&g, s, m, x, y, n_threads);
+        ok = fwrite(x, sizeof(mat_t), (size_t)m * spec->dim, f) == (size_t)m * spec->dim;
+    }
+    for (long s = 0; ok && s < spec->n; s += chunk)
+    {
+        long m = spec->n - s < chunk ? spec->n - s : chunk;
+        for (long i = 0; i < m; ++i)
+            y[i] = (mat_t)((s + i) % spec->classes);
+        ok = fwrite(y, sizeof(mat_t), (size_t)m, f) == (size_t)m;
+    }
+    free(x);
+    free(y);
+    synth_free(&g);
+    return fclose(f) == 0 && ok;
+}
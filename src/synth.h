@@ -0,0 +1,59 @@
+#ifndef SYNTH_H
+#define SYNTH_H
+
+#include "utils.h"
+
+/* Synthetic classification data at any size. Row i is a pure function of
+   (spec, i): its label is i % classes and its features come from draws
+   i * stride .. of one RNG stream, so rows can be generated in any order, by
+   any number of threads, with identical results.
+
+   The 2-D families (spirals, moons, XOR) are lifted to dim > 2 inputs by a
+   fixed random projection (2 x dim, from the seed) plus isotropic noise on
+   every feature; blobs are Gaussian clusters directly in dim dimensions. */
+typedef enum
+{
+    SYNTH_SPIRALS, // one arm per class
+    SYNTH_MOONS,   // interleaved half circles, pairs shifted along x
+    SYNTH_XOR,     // classes x classes checkerboard, label (ix + iy) % classes (2 classes: XOR)
+    SYNTH_BLOBS    // one Gaussian cluster per class, centers in [-4, 4]^dim
+} SynthKind;
+
+typedef struct
+{
+    SynthKind kind;
+    long n;      // rows
+    int classes;
+    int dim;     // input features (>= 2)
+    mat_t noise; // Gaussian std added to features
+    uint64_t seed;
+} SynthSpec;
+
+typedef struct
+{
+    SynthSpec spec;
+    mat_t *proj;    // 2 x dim projection (NULL when dim == 2 or blobs)
+    mat_t *centers; // blobs: classes x dim
+    uint64_t stride; // draws reserved per row
+} SynthGen;
+
+#define SYNTH_CHUNK_ROWS 65536 // rows per parallel chunk when streaming to a file
+
+const char *synth_kind_name(SynthKind k);
+int synth_kind_from_name(const char *s, SynthKind *k); // 0 if unknown
+
+// Validates spec (exits on bad sizes) and draws the projection / centers
+SynthGen synth_init(const SynthSpec *spec);
+void synth_free(SynthGen *g);
+
+// Rows [start, start + count) into x (count x dim) and y (count x 1)
+void synth_rows(const SynthGen *g, long start, long count, mat_t *x, mat_t *y);
+
+// All rows in memory, generated by n_threads threads
+void synth_generate(const SynthSpec *spec, Matrix *X, Matrix *Y, int n_threads);
+
+// Stream all rows into the load_data format (header, X, then Y) chunk by chunk;
+// memory stays O(SYNTH_CHUNK_ROWS * dim). Returns 0 on I/O failure.
+int synth_write(const SynthSpec *spec, const char *path, int n_threads);
+
+#endif
@@ -0,0 +1,84 @@
+#include "tiny.h"
+#include "tiny_net.h"
+
+struct TinyEntry
+{
+    size_t size;
+    int (*load)(void *t, const Network *net);
+    void (*store)(const void *t, Network *net);
+    mat_t (*step)(void *t, const mat_t *x, const mat_t *y, int rows, int y_cols, const SGD *opt, int is_ce);
+    int (*correct)(const void *t, const mat_t *x, const mat_t *y, int rows, int y_cols);
+};
+
+// An instance plus void-pointer adapters and its table row
+#define TINY_ENTRY(name, IN, HID, OUT, ACT0, ACT1)                                                          \
+    TINY_NET_DEFINE(name, IN, HID, OUT, ACT0, ACT1)                                                         \
+    static int name##_load_v(void *t, const Network *net) { return name##_load(t, net); }                  \
+    static void name##_store_v(const void *t, Network *net) { name##_store(t, net); }                       \
+    static mat_t name##_step_v(void *t, const mat_t *x, const mat_t *y, int rows, int y_cols, const SGD *opt, \
+                               int is_ce)                                                                   \
+    {                                                                                                       \
+        return name##_train_step(t, x, y, rows, y_cols, opt, is_ce);                                        \
+    }                                                                                                       \
+    static int name##_correct_v(const void *t, const mat_t *x, const mat_t *y, int rows, int y_cols)        \
+    {                                                                                                       \
+        return name##_correct(t, x, y, rows, y_cols);                                                       \
+    }                                                                                                       \
+    static const TinyEntry name##_entry = {sizeof(name), name##_load_v, name##_store_v, name##_step_v,      \
+                                           name##_correct_v};
+
+/* XOR / spirals drivers and their sweeps: 2-4-1, swept hidden act, FIXED_SIG out */
+TINY_ENTRY(tiny_241_prelu, 2, 4, 1, PRELU, FIXED_SIG)
+TINY_ENTRY(tiny_241_poly, 2, 4, 1, POLY_CUBIC, FIXED_SIG)
+TINY_ENTRY(tiny_241_piecewise, 2, 4, 1, PIECEWISE, FIXED_SIG)
+TINY_ENTRY(tiny_241_swish, 2, 4, 1, SWISH, FIXED_SIG)
+TINY_ENTRY(tiny_241_relu, 2, 4, 1, FIXED_RELU, FIXED_SIG)
+TINY_ENTRY(tiny_241_sig, 2, 4, 1, FIXED_SIG, FIXED_SIG)
+
+static const TinyEntry *const tiny_entries[] = {&tiny_241_prelu_entry, &tiny_241_poly_entry,
+                                                &tiny_241_piecewise_entry, &tiny_241_swish_entry,
+                                                &tiny_241_relu_entry, &tiny_241_sig_entry};
+#define TINY_N_ENTRIES ((int)(sizeof(tiny_entries) / sizeof(tiny_entries[0])))
+
+int tiny_bind(TinyNet *t, const Network *net)
+{
+    t->e = NULL;
+    t->state = NULL;
+    if (ACT_MEM_BUDGET > 0 || ACT_STASH_BF16 || ACT_STASH_MASK || net->grad_ready)
+        return 0;
+    for (int i = 0; i < TINY_N_ENTRIES; ++i)
+    {
+        void *s = mem_alloc(tiny_entries[i]->size, MEM_WEIGHTS);
+        if (tiny_entries[i]->load(s, net))
+        {
+            t->e = tiny_entries[i];
+            t->state = s;
+            return 1;
+        }
+        mem_free(s);
+    }
+    return 0;
+}
+
+mat_t tiny_train_step(TinyNet *t, Matrix x, Matrix y, SGD *opt, int is_ce)
+{
+    return t->e->step(t->state, x.data, y.data, x.rows, y.cols, opt, is_ce);
+}
+
+mat_t tiny_eval_acc(TinyNet *t, Matrix x, Matrix y)
+{
+    return (mat_t)t->e->correct(t->state, x.data, y.data, x.rows, y.cols) / x.rows;
+}
+
+void tiny_sync(TinyNet *t, Network *net)
+{
+    if (t->e)
+        t->e->store(t->state, net);
+}
+
+void tiny_free(TinyNet *t)
+{
+    mem_free(t->state);
+    t->e = NULL;
+    t->state = NULL;
+}
@@ -0,0 +1,30 @@
+#ifndef TINY_H
+#define TINY_H
+
+#include "network.h"
+#include "optimizer.h"
+
+/* Runtime front end for the tiny_net.h instances compiled into tiny.c: the
+   2-4-1 nets of the XOR / spirals drivers and sweeps, one instance per hidden
+   ActType with a FIXED_SIG output. tiny_bind copies a matching net into its
+   instance; from then on tiny_train_step / tiny_eval_acc stand in for
+   train_step / eval_acc bit for bit, and the Network itself is stale until
+   tiny_sync writes params and optimizer state back. */
+
+typedef struct TinyEntry TinyEntry;
+
+typedef struct
+{
+    const TinyEntry *e; // NULL: not bound
+    void *state;        // the instance's struct
+} TinyNet;
+
+// 1 when net has a compiled instance and train_step would run on it as is
+// (no ACT_MEM_BUDGET micro-batches, stashes, pruning or grad_ready hook)
+int tiny_bind(TinyNet *t, const Network *net);
+mat_t tiny_train_step(TinyNet *t, Matrix x, Matrix y, SGD *opt, int is_ce);
+mat_t tiny_eval_acc(TinyNet *t, Matrix x, Matrix y);
+void tiny_sync(TinyNet *t, Network *net);
+void tiny_free(TinyNet *t);
+
+#endif
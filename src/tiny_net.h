@@ -0,0 +1,468 @@
+#ifndef TINY_NET_H
+#define TINY_NET_H
+
+#include "network.h"
+#include "config.h"
+#include <string.h>
+
+/* Compile-time specialized training for tiny fixed-shape nets (XOR, spirals:
+   2-4-1). TINY_NET_DEFINE(name, IN, HID, OUT, ACT0, ACT1) generates a struct
+   holding an IN-HID-OUT dense net by value (W, b, velocities, act params) and
+   static inline functions for it:
+
+     int   name_load(name *t, const Network *net)  // 0: net has another shape
+     void  name_store(const name *t, Network *net) // params + optimizer state back
+     mat_t name_train_step(name *t, const mat_t *x, const mat_t *y, int rows, int y_cols,
+                           const SGD *opt, int is_ce)
+     int   name_correct(const name *t, const mat_t *x, const mat_t *y, int rows, int y_cols)
+
+   Every loop bound is a constant and the activations are picked by token
+   pasting (tiny_f_##ACT0 ...), so a step has no allocation, no shape checks
+   and no ActType switch; rows stream through forward, loss and backward one
+   at a time with their values in stack arrays. The arithmetic mirrors
+   train_step operation for operation (k-ordered sums, grads scaled by
+   1 / batch, per-tensor clipping, momentum, act clipping, bounds), so a step
+   is bit-identical to train_step on the same net, including the CSR path
+   layer 0 takes for sparse batches. Not covered: micro-batching
+   (ACT_MEM_BUDGET), stashes, pruning masks, grad_ready hooks - tiny.c checks
+   for them before binding - and the [DEBUG] act-clip lines on stderr. */
+
+/* ---- per-activation pieces: the same expressions as act_eval / act_backward_z ----
+   k: constants derived once per step by tiny_prep_T; g: param grads, plus
+   the tau grads of PIECEWISE in g[7..9] until tiny_bend_T maps them */
+
+#define TINY_NP_PRELU 1
+#define TINY_NP_POLY_CUBIC 4
+#define TINY_NP_PIECEWISE 7
+#define TINY_NP_SWISH 1
+#define TINY_NP_FIXED_RELU 0
+#define TINY_NP_FIXED_SIG 0
+#define TINY_NK 12 // PIECEWISE: taus[3], slopes[4], c[4], clip bound
+
+static inline void tiny_prep_copy(const mat_t *p, mat_t *k, int n)
+{
+    for (int i = 0; i < n; ++i)
+        k[i] = p[i];
+}
+static inline void tiny_prep_PRELU(const mat_t *p, mat_t *k) { tiny_prep_copy(p, k, 1); }
+static inline void tiny_prep_POLY_CUBIC(const mat_t *p, mat_t *k) { tiny_prep_copy(p, k, 4); }
+static inline void tiny_prep_SWISH(const mat_t *p, mat_t *k) { tiny_prep_copy(p, k, 1); }
+static inline void tiny_prep_FIXED_RELU(const mat_t *p, mat_t *k) { (void)p, (void)k; }
+static inline void tiny_prep_FIXED_SIG(const mat_t *p, mat_t *k) { (void)p, (void)k; }
+static inline void tiny_prep_PIECEWISE(const mat_t *p, mat_t *k)
+{
+    k[0] = p[0];
+    k[1] = p[0] + exp(p[1]);
+    k[2] = k[1] + exp(p[2]);
+    for (int s = 0; s < 4; ++s)
+        k[3 + s] = p[3 + s];
+    for (int seg = 0; seg < 4; ++seg) // continuity constants, summed as in act_eval
+    {
+        mat_t c = 0.0;
+        for (int m = 0; m < seg; ++m)
+            c += (k[3 + m] - k[4 + m]) * k[m];
+        k[7 + seg] = c;
+    }
+    k[11] = ACT_Z_CLIP_B;
+}
+
+static inline mat_t tiny_f_PRELU(const mat_t *k, mat_t z) { return z >= 0 ? z : k[0] * z; }
+static inline mat_t tiny_f_POLY_CUBIC(const mat_t *k, mat_t z)
+{
+    mat_t z2 = z * z, z3 = z2 * z;
+    return k[0] + k[1] * z + k[2] * z2 + k[3] * z3;
+}
+static inline mat_t tiny_f_PIECEWISE(const mat_t *k, mat_t z)
+{
+    z = fmin(k[11], fmax(-k[11], z));
+    int seg = 0;
+    if (z > k[0])
+        seg = 1;
+    if (z > k[1])
+        seg = 2;
+    if (z > k[2])
+        seg = 3;
+    return k[3 + seg] * z + k[7 + seg];
+}
+static inline mat_t tiny_f_SWISH(const mat_t *k, mat_t z) { return z * sigmoid(k[0] * z); }
+static inline mat_t tiny_f_FIXED_RELU(const mat_t *k, mat_t z) { (void)k; return fmax(0, z); }
+static inline mat_t tiny_f_FIXED_SIG(const mat_t *k, mat_t z) { (void)k; return sigmoid(z); }
+
+// Returns delta_z for upstream delta d (o: the forward output) and accumulates
+// the param grads into g
+static inline mat_t tiny_b_PRELU(const mat_t *k, mat_t z, mat_t o, mat_t d, mat_t *g)
+{
+    (void)o;
+    mat_t dfdz = (z >= 0 ? 1.0 : k[0]);
+    g[0] += d * z * (z < 0 ? 1.0 : 0.0);
+    return d * dfdz;
+}
+static inline mat_t tiny_b_POLY_CUBIC(const mat_t *k, mat_t z, mat_t o, mat_t d, mat_t *g)
+{
+    (void)o;
+    mat_t z2 = z * z;
+    mat_t dfdz = k[1] + 2 * k[2] * z + 3 * k[3] * z2;
+    g[0] += d; // act_backward's d * 1.0 (z^0): exact, same bits
+    g[1] += d * z;
+    g[2] += d * z2;
+    g[3] += d * z2 * z;
+    return d * dfdz;
+}
+static inline mat_t tiny_b_PIECEWISE(const mat_t *k, mat_t z, mat_t o, mat_t d, mat_t *g)
+{
+    (void)o;
+    z = fmin(k[11], fmax(-k[11], z)); // segments the clipped z, like act_backward_z
+    int seg = 0;
+    if (z > k[0])
+        seg = 1;
+    if (z > k[1])
+        seg = 2;
+    if (z > k[2])
+        seg = 3;
+    for (int m = 0; m < seg; ++m)
+        g[7 + m] += d * (k[3 + m] - k[4 + m]);
+    for (int s = 0; s < 4; ++s)
+    {
+        mat_t contrib = 0.0;
+        if (s == seg)
+            contrib += z;
+        mat_t left = 0.0, right = 0.0;
+        if (s < seg)
+            left = k[s];
+        if ((s - 1) >= 0 && (s - 1) < seg)
+            right = k[s - 1];
+        contrib += (left - right);
+        g[3 + s] += d * contrib;
+    }
+    return d * k[3 + seg];
+}
+static inline mat_t tiny_b_SWISH(const mat_t *k, mat_t z, mat_t o, mat_t d, mat_t *g)
+{
+    (void)o;
+    mat_t s = sigmoid(k[0] * z);
+    mat_t s_prime = s * (1 - s);
+    mat_t dfdz = s + z * k[0] * s_prime;
+    g[0] += d * (z * z * s_prime);
+    return d * dfdz;
+}
+static inline mat_t tiny_b_FIXED_RELU(const mat_t *k, mat_t z, mat_t o, mat_t d, mat_t *g)
+{
+    (void)k, (void)o, (void)g;
+    return d * (z > 0 ? 1.0 : 0.0);
+}
+static inline mat_t tiny_b_FIXED_SIG(const mat_t *k, mat_t z, mat_t o, mat_t d, mat_t *g)
+{
+    (void)k, (void)z, (void)g;
+    return d * (o * (1 - o)); // sigmoid_deriv(z), reusing the forward's sigmoid(z)
+}
+
+// Finish a step's param grads (PIECEWISE: tau grads -> p0..p2)
+static inline void tiny_bend_none(const mat_t *p, mat_t *g) { (void)p, (void)g; }
+#define tiny_bend_PRELU tiny_bend_none
+#define tiny_bend_POLY_CUBIC tiny_bend_none
+#define tiny_bend_SWISH tiny_bend_none
+#define tiny_bend_FIXED_RELU tiny_bend_none
+#define tiny_bend_FIXED_SIG tiny_bend_none
+static inline void tiny_bend_PIECEWISE(const mat_t *p, mat_t *g)
+{
+    g[0] += g[7] + g[8] + g[9];
+    g[1] += exp(p[1]) * (g[8] + g[9]);
+    g[2] += exp(p[2]) * (g[9]);
+}
+
+/* ---- shared step pieces (fixed n, inlined into each instance) ---- */
+
+/* Batch means as layer_backward_scaled forms them (gscale = 1) into grads that
+   start at +0.0. The `0.0 +` stands for that accumulation: it turns a -0.0 sum
+   into +0.0. grad_b divides by the batch, grad_W scales by 1 / batch (they round
+   differently). Keep both as they are: check_tiny compares them bit for bit */
+static inline mat_t tiny_mean_b(mat_t sum, int rows) { return 0.0 + sum / rows; }
+static inline mat_t tiny_mean_W(mat_t sum, mat_t scale) { return 0.0 + sum * scale; }
+
+// mat_clip_grad
+static inline void tiny_clip(mat_t *g, int n, mat_t max_norm)
+{
+    mat_t norm = 0;
+    for (int i = 0; i < n; ++i)
+        norm += g[i] * g[i];
+    norm = sqrt(norm);
+    if (norm > max_norm)
+        for (int i = 0; i < n; ++i)
+            g[i] *= max_norm / norm;
+}
+
+// sgd_update_dense (grads live on the stack, so nothing to reset)
+static inline void tiny_sgd(mat_t *p, mat_t *v, const mat_t *g, int n, const SGD *opt)
+{
+    for (int i = 0; i < n; ++i)
+    {
+        v[i] = opt->momentum * v[i] - opt->lr * g[i];
+        p[i] += v[i];
+    }
+}
+
+// sgd_update_act without the stderr line
+static inline void tiny_sgd_act(mat_t *p, mat_t *v, const mat_t *lr_mult, mat_t *g, int n, const SGD *opt)
+{
+    if (n == 0)
+        return;
+    mat_t gnorm = 0;
+    for (int i = 0; i < n; ++i)
+        gnorm += g[i] * g[i];
+    gnorm = sqrt(gnorm);
+    mat_t max_g = opt->act_grad_clip > 0 ? opt->act_grad_clip : ACT_GRAD_CLIP_NORM;
+    if (gnorm > max_g)
+        for (int i = 0; i < n; ++i)
+            g[i] *= max_g / gnorm;
+    mat_t act_lr = opt->act_lr > 0 ? opt->act_lr : opt->lr;
+    mat_t act_mom = opt->act_momentum >= 0 ? opt->act_momentum : opt->momentum;
+    for (int i = 0; i < n; ++i)
+    {
+        v[i] = act_mom * v[i] - act_lr * lr_mult[i] * g[i];
+        p[i] = fmin(ACT_PARAM_MAX, fmax(ACT_PARAM_MIN, p[i] + v[i]));
+    }
+}
+
+// act_reg on a by-value param array
+static inline mat_t tiny_reg(ActType type, mat_t *p, int n)
+{
+    Activation a = {type, n, p, NULL, {0, 0, NULL}, {0, 0, NULL}};
+    return act_reg(&a, 1e-4);
+}
+
+// Layer i of net has the expected shape / act and no feature the instances skip
+static inline int tiny_layer_fits(const Layer *l, int in, int out, ActType type)
+{
+    return l->kind == LAYER_DENSE && l->in_dim == in && l->out_dim == out && l->act.type == type && !l->w_mask &&
+           !l->b_mask;
+}
+
+static inline void tiny_get(mat_t *dst, const mat_t *src, int n, mat_t fill)
+{
+    for (int i = 0; i < n; ++i)
+        dst[i] = src ? src[i] : fill;
+}
+
+/* Params, velocities and act lr multipliers are stored one slot wider than
+   needed so parameterless activations still get legal arrays. */
+#define TINY_NET_DEFINE(name, IN, HID, OUT, ACT0, ACT1)                                                            \
+    typedef struct                                                                                                 \
+    {                                                                                                              \
+        mat_t W0[(IN) * (HID)], b0[HID], W1[(HID) * (OUT)], b1[OUT];                                               \
+        mat_t vW0[(IN) * (HID)], vb0[HID], vW1[(HID) * (OUT)], vb1[OUT];                                           \
+        mat_t p0[TINY_NP_##ACT0 + 1], v0[TINY_NP_##ACT0 + 1], lr0[TINY_NP_##ACT0 + 1];                             \
+        mat_t p1[TINY_NP_##ACT1 + 1], v1[TINY_NP_##ACT1 + 1], lr1[TINY_NP_##ACT1 + 1];                             \
+        int sparse_input;                                                                                          \
+    } name;                                                                                                        \
+                                                                                                                   \
+    static inline int name##_load(name *t, const Network *net)                                                     \
+    {                                                                                                              \
+        if (net->n_layers != 2 || net->input_dim != (IN) || !tiny_layer_fits(&net->layers[0], IN, HID, ACT0) ||    \
+            !tiny_layer_fits(&net->layers[1], HID, OUT, ACT1))                                                     \
+            return 0;                                                                                              \
+        const Layer *l0 = &net->layers[0], *l1 = &net->layers[1];                                                  \
+        int n0 = TINY_NP_##ACT0, n1 = TINY_NP_##ACT1;                                                              \
+        tiny_get(t->W0, l0->W.data, (IN) * (HID), 0.0);                                                            \
+        tiny_get(t->b0, l0->b.data, HID, 0.0);                                                                     \
+        tiny_get(t->W1, l1->W.data, (HID) * (OUT), 0.0);                                                           \
+        tiny_get(t->b1, l1->b.data, OUT, 0.0);                                                                     \
+        tiny_get(t->vW0, l0->v_W.data, (IN) * (HID), 0.0);                                                         \
+        tiny_get(t->vb0, l0->v_b.data, HID, 0.0);                                                                  \
+        tiny_get(t->vW1, l1->v_W.data, (HID) * (OUT), 0.0);                                                        \
+        tiny_get(t->vb1, l1->v_b.data, OUT, 0.0);                                                                  \
+        tiny_get(t->p0, l0->act.params, n0, 0.0);                                                                  \
+        tiny_get(t->p1, l1->act.params, n1, 0.0);                                                                  \
+        tiny_get(t->v0, l0->v_act.rows * l0->v_act.cols >= n0 ? l0->v_act.data : NULL, n0, 0.0);                   \
+        tiny_get(t->v1, l1->v_act.rows * l1->v_act.cols >= n1 ? l1->v_act.data : NULL, n1, 0.0);                   \
+        tiny_get(t->lr0, l0->act_lr.rows * l0->act_lr.cols >= n0 ? l0->act_lr.data : NULL, n0, 1.0);               \
+        tiny_get(t->lr1, l1->act_lr.rows * l1->act_lr.cols >= n1 ? l1->act_lr.data : NULL, n1, 1.0);               \
+        t->sparse_input = l0->sparse_input;                                                                        \
+        return 1;                                                                                                  \
+    }                                                                                                              \
+                                                                                                                   \
+    static inline void name##_store(const name *t, Network *net)                                                   \
+    {                                                                                                              \
+        Layer *l0 = &net->layers[0], *l1 = &net->layers[1];                                                        \
+        int n0 = TINY_NP_##ACT0, n1 = TINY_NP_##ACT1;                                                              \
+        memcpy(l0->W.data, t->W0, sizeof(t->W0));                                                                  \
+        memcpy(l0->b.data, t->b0, sizeof(t->b0));                                                                  \
+        memcpy(l1->W.data, t->W1, sizeof(t->W1));                                                                  \
+        memcpy(l1->b.data, t->b1, sizeof(t->b1));                                                                  \
+        memcpy(l0->v_W.data, t->vW0, sizeof(t->vW0));                                                              \
+        memcpy(l0->v_b.data, t->vb0, sizeof(t->vb0));                                                              \
+        memcpy(l1->v_W.data, t->vW1, sizeof(t->vW1));                                                              \
+        memcpy(l1->v_b.data, t->vb1, sizeof(t->vb1));                                                              \
+        if (n0)                                                                                                    \
+            memcpy(l0->act.params, t->p0, n0 * sizeof(mat_t));                                                     \
+        if (n1)                                                                                                    \
+            memcpy(l1->act.params, t->p1, n1 * sizeof(mat_t));                                                     \
+        if (n0 && l0->v_act.rows * l0->v_act.cols >= n0)                                                           \
+            memcpy(l0->v_act.data, t->v0, n0 * sizeof(mat_t));                                                     \
+        if (n1 && l1->v_act.rows * l1->v_act.cols >= n1)                                                           \
+            memcpy(l1->v_act.data, t->v1, n1 * sizeof(mat_t));                                                     \
+    }                                                                                                              \
+                                                                                                                   \
+    /* Layer 0 would take its CSR path for this batch (dense_forward) */                                           \
+    static inline int name##_sparse(const name *t, const mat_t *x, int rows)                                       \
+    {                                                                                                              \
+        int nnz = 0;                                                                                               \
+        for (int i = 0; i < rows * (IN); ++i)                                                                      \
+            nnz += x[i] != 0.0;                                                                                    \
+        return t->sparse_input && SPARSE_INPUT_DENSITY > 0 && nnz < SPARSE_INPUT_DENSITY * rows * (IN);            \
+    }                                                                                                              \
+                                                                                                                   \
+    /* Forward of one row: z0 / z1 pre-activations, h / o outputs */                                               \
+    static inline void name##_row(const name *t, const mat_t *k0, const mat_t *k1, const mat_t *x, int sparse,     \
+                                  mat_t *z0, mat_t *h, mat_t *z1, mat_t *o)                                        \
+    {                                                                                                              \
+        for (int j = 0; j < (HID); ++j)                                                                            \
+        {                                                                                                          \
+            mat_t s = 0.0;                                                                                         \
+            for (int k = 0; k < (IN); ++k)                                                                         \
+                if (!sparse || x[k] != 0.0)                                                                        \
+                    s += x[k] * t->W0[k * (HID) + j];                                                              \
+            z0[j] = s + t->b0[j];                                                                                  \
+            h[j] = tiny_f_##ACT0(k0, z0[j]);                                                                       \
+        }                                                                                                          \
+        for (int j = 0; j < (OUT); ++j)                                                                            \
+        {                                                                                                          \
+            mat_t s = 0.0;                                                                                         \
+            for (int k = 0; k < (HID); ++k)                                                                        \
+                s += h[k] * t->W1[k * (OUT) + j];                                                                  \
+            z1[j] = s + t->b1[j];                                                                                  \
+            o[j] = tiny_f_##ACT1(k1, z1[j]);                                                                       \
+        }                                                                                                          \
+    }                                                                                                              \
+                                                                                                                   \
+    static inline mat_t name##_train_step(name *t, const mat_t *x, const mat_t *y, int rows, int y_cols,           \
+                                          const SGD *opt, int is_ce)                                               \
+    {                                                                                                              \
+        mat_t k0[TINY_NK], k1[TINY_NK];                                                                            \
+        tiny_prep_##ACT0(t->p0, k0);                                                                               \
+        tiny_prep_##ACT1(t->p1, k1);                                                                               \
+        mat_t gW0[(IN) * (HID)] = {0}, gb0[HID] = {0}, gW1[(HID) * (OUT)] = {0}, gb1[OUT] = {0};                   \
+        mat_t g0[TINY_NP_##ACT0 + 3] = {0}, g1[TINY_NP_##ACT1 + 3] = {0};                                          \
+        int sparse = name##_sparse(t, x, rows);                                                                    \
+        mat_t scale = 1.0 / rows; /* gscale / batch */                                                             \
+        mat_t loss = 0.0;                                                                                          \
+        for (int b = 0; b < rows; ++b)                                                                             \
+        {                                                                                                          \
+            const mat_t *xb = x + (size_t)b * (IN);                                                                \
+            mat_t z0[HID], h[HID], z1[OUT], o[OUT], d[OUT], dh[HID];                                               \
+            name##_row(t, k0, k1, xb, sparse, z0, h, z1, o);                                                       \
+            if (is_ce) /* loss_softmax_ce, one row */                                                              \
+            {                                                                                                      \
+                int label = (int)y[(size_t)b * y_cols];                                                            \
+                mat_t m = o[0], sum_exp = 0.0;                                                                     \
+                for (int j = 1; j < (OUT); ++j)                                                                    \
+                    m = o[j] > m ? o[j] : m;                                                                       \
+                for (int j = 0; j < (OUT); ++j)                                                                    \
+                {                                                                                                  \
+                    d[j] = exp(o[j] - m);                                                                          \
+                    sum_exp += d[j];                                                                               \
+                }                                                                                                  \
+                mat_t inv = 1.0 / sum_exp;                                                                         \
+                for (int j = 0; j < (OUT); ++j)                                                                    \
+                    d[j] *= inv;                                                                                   \
+                d[label] -= 1.0;                                                                                   \
+                loss += log(sum_exp) + m - o[label];                                                               \
+            }                                                                                                      \
+            else /* loss_mse */                                                                                    \
+            {                                                                                                      \
+                for (int j = 0; j < (OUT); ++j)                                                                    \
+                {                                                                                                  \
+                    d[j] = o[j] - y[(size_t)b * y_cols + (y_cols == 1 ? 0 : j)];                                   \
+                    loss += d[j] * d[j];                                                                           \
+                }                                                                                                  \
+            }                                                                                                      \
+            /* Layer 1: delta_z, grads, delta into h */                                                            \
+            for (int j = 0; j < (OUT); ++j)                                                                        \
+            {                                                                                                      \
+                d[j] = tiny_b_##ACT1(k1, z1[j], o[j], d[j], g1);                                                   \
+                gb1[j] += d[j];                                                                                    \
+            }                                                                                                      \
+            for (int k = 0; k < (HID); ++k)                                                                        \
+                for (int j = 0; j < (OUT); ++j)                                                                    \
+                    gW1[k * (OUT) + j] += h[k] * d[j];                                                             \
+            for (int k = 0; k < (HID); ++k)                                                                        \
+            {                                                                                                      \
+                mat_t s = 0.0;                                                                                     \
+                for (int j = 0; j < (OUT); ++j)                                                                    \
+                    s += d[j] * t->W1[k * (OUT) + j];                                                              \
+                dh[k] = s;                                                                                         \
+            }                                                                                                      \
+            /* Layer 0 (CSR path: grad_W scaled per row, as spmm_tn_accum) */                                      \
+            for (int j = 0; j < (HID); ++j)                                                                        \
+            {                                                                                                      \
+                dh[j] = tiny_b_##ACT0(k0, z0[j], h[j], dh[j], g0);                                                 \
+                gb0[j] += dh[j];                                                                                   \
+            }                                                                                                      \
+            for (int k = 0; k < (IN); ++k)                                                                         \
+            {                                                                                                      \
+                if (sparse && xb[k] == 0.0)                                                                        \
+                    continue;                                                                                      \
+                mat_t v = sparse ? scale * xb[k] : xb[k];                                                          \
+                for (int j = 0; j < (HID); ++j)                                                                    \
+                    gW0[k * (HID) + j] += v * dh[j];                                                               \
+            }                                                                                                      \
+        }                                                                                                          \
+        tiny_bend_##ACT0(t->p0, g0);                                                                               \
+        tiny_bend_##ACT1(t->p1, g1);                                                                               \
+        /* Means over the batch (net_backward), then train_step's reg, clip, update */                             \
+        for (int i = 0; i < (IN) * (HID); ++i) /* the CSR path scaled while accumulating */                        \
+            gW0[i] = sparse ? gW0[i] : tiny_mean_W(gW0[i], scale);                                                 \
+        for (int i = 0; i < (HID) * (OUT); ++i)                                                                    \
+            gW1[i] = tiny_mean_W(gW1[i], scale);                                                                   \
+        for (int j = 0; j < (HID); ++j)                                                                            \
+            gb0[j] = tiny_mean_b(gb0[j], rows);                                                                    \
+        for (int j = 0; j < (OUT); ++j)                                                                            \
+            gb1[j] = tiny_mean_b(gb1[j], rows);                                                                    \
+        loss = is_ce ? loss / rows : loss / (rows * (OUT));                                                        \
+        mat_t reg = 0.0;                                                                                           \
+        reg += tiny_reg(ACT0, t->p0, TINY_NP_##ACT0);                                                              \
+        reg += tiny_reg(ACT1, t->p1, TINY_NP_##ACT1);                                                              \
+        loss += reg;                                                                                               \
+        tiny_clip(gW0, (IN) * (HID), GRAD_CLIP_NORM);                                                              \
+        tiny_clip(gb0, HID, GRAD_CLIP_NORM);                                                                       \
+        tiny_clip(gW1, (HID) * (OUT), GRAD_CLIP_NORM);                                                             \
+        tiny_clip(gb1, OUT, GRAD_CLIP_NORM);                                                                       \
+        tiny_sgd(t->W0, t->vW0, gW0, (IN) * (HID), opt);                                                           \
+        tiny_sgd(t->b0, t->vb0, gb0, HID, opt);                                                                    \
+        tiny_sgd_act(t->p0, t->v0, t->lr0, g0, TINY_NP_##ACT0, opt);                                               \
+        tiny_sgd(t->W1, t->vW1, gW1, (HID) * (OUT), opt);                                                          \
+        tiny_sgd(t->b1, t->vb1, gb1, OUT, opt);                                                                    \
+        tiny_sgd_act(t->p1, t->v1, t->lr1, g1, TINY_NP_##ACT1, opt);                                               \
+        if (isnan(loss) || isinf(loss))                                                                            \
+        {                                                                                                          \
+            fprintf(stderr, "Invalid loss in " #name "_train_step: %f\n", loss);                                   \
+            exit(1);                                                                                               \
+        }                                                                                                          \
+        return loss;                                                                                               \
+    }                                                                                                              \
+                                                                                                                   \
+    /* count_correct on the net's outputs */                                                                       \
+    static inline int name##_correct(const name *t, const mat_t *x, const mat_t *y, int rows, int y_cols)          \
+    {                                                                                                              \
+        mat_t k0[TINY_NK], k1[TINY_NK];                                                                            \
+        tiny_prep_##ACT0(t->p0, k0);                                                                               \
+        tiny_prep_##ACT1(t->p1, k1);                                                                               \
+        int correct = 0, sparse = name##_sparse(t, x, rows);                                                       \
+        for (int b = 0; b < rows; ++b)                                                                             \
+        {                                                                                                          \
+            mat_t z0[HID], h[HID], z1[OUT], o[OUT];                                                                \
+            name##_row(t, k0, k1, x + (size_t)b * (IN), sparse, z0, h, z1, o);                                     \
+            int pred = 0;                                                                                          \
+            if ((OUT) == 1 && y_cols == 1)                                                                         \
+            {                                                                                                      \
+                mat_t score = (ACT1) == FIXED_SIG || (ACT1) == SWISH ? o[0] : sigmoid(o[0]);                       \
+                pred = score >= 0.5;                                                                               \
+            }                                                                                                      \
+            else                                                                                                   \
+                for (int j = 1; j < (OUT); ++j)                                                                    \
+                    pred = o[j] > o[pred] ? j : pred;                                                              \
+            correct += pred == (y_cols == 1 ? (int)y[b] : 0);                                                      \
+        }                                                                                                          \
+        return correct;                                                                                            \
+    }
+
+#endif
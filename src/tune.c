@@ -0,0 +1,227 @@
+#define _POSIX_C_SOURCE 200809L
+#include "tune.h"
+#include "config.h"
+#include <string.h>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <time.h>
+#include <unistd.h>
+#endif
+
+/* Block shapes tried once the thread count is fixed (0 = unblocked) */
+static const int tune_blocks[][3] = {{0, 0, 0}, {16, 64, 512}, {32, 128, 128}, {64, 256, 256}, {128, 512, 512}};
+#define TUNE_N_BLOCKS ((int)(sizeof(tune_blocks) / sizeof(tune_blocks[0])))
+
+static int n_cores(void)
+{
+#ifdef _WIN32
+    SYSTEM_INFO si;
+    GetSystemInfo(&si);
+    return (int)si.dwNumberOfProcessors;
+#else
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+    return n > 0 ? (int)n : 1;
+#endif
+}
+
+static void cpu_model(char *buf, size_t n)
+{
+    snprintf(buf, n, "unknown");
+#ifdef _WIN32
+    const char *id = getenv("PROCESSOR_IDENTIFIER");
+    if (id)
+        snprintf(buf, n, "%s", id);
+#else
+    FILE *f = fopen("/proc/cpuinfo", "r");
+    if (!f)
+        return;
+    char line[512];
+    while (fgets(line, sizeof(line), f))
+    {
+        char *colon = strchr(line, ':');
+        if (colon && strncmp(line, "model name", 10) == 0)
+        {
+            char *v = colon + 1;
+            while (*v == ' ' || *v == '\t')
+                ++v;
+            v[strcspn(v, "\r\n")] = '\0';
+            snprintf(buf, n, "%s", v);
+            break;
+        }
+    }
+    fclose(f);
+#endif
+    for (char *p = buf; *p; ++p) // the cache file is tab/line separated
+        if (*p == '\t' || *p == ';')
+            *p = ' ';
+}
+
+TuneConfig tune_current(int batch_size)
+{
+    TuneConfig c = {batch_size, GEMM_BLOCK_M, GEMM_BLOCK_K, GEMM_BLOCK_N, GEMM_THREADS, 0.0};
+    return c;
+}
+
+void tune_key(Network *net, char *buf, size_t n)
+{
+    char model[256];
+    cpu_model(model, sizeof(model));
+    int len = snprintf(buf, n, "cpu=%s;cores=%d;net=%d", model, n_cores(), net->input_dim);
+    for (int i = 0; i < net->n_layers && len > 0 && (size_t)len < n; ++i)
+    {
+        Layer *l = &net->layers[i];
+        if (l->kind == LAYER_CONV)
+            len += snprintf(buf + len, n - len, "xc%dk%dp%dq%d", l->conv.out_c, l->conv.k, l->conv.pad,
+                            l->conv.pool);
+        else
+            len += snprintf(buf + len, n - len, "x%d", l->out_dim);
+    }
+}
+
+int tune_cache_load(const char *path, const char *key, TuneConfig *c)
+{
+    FILE *f = fopen(path, "r");
+    if (!f)
+        return 0;
+    char line[1024];
+    size_t kl = strlen(key);
+    int found = 0;
+    while (!found && fgets(line, sizeof(line), f))
+    {
+        if (strncmp(line, key, kl) != 0 || line[kl] != '\t')
+            continue;
+        found = sscanf(line + kl + 1, "%d %d %d %d %d %lf", &c->batch_size, &c->block_m, &c->block_k,
+                       &c->block_n, &c->threads, &c->samples_per_s) == 6;
+    }
+    fclose(f);
+    return found;
+}
+
+int tune_cache_save(const char *path, const char *key, const TuneConfig *c)
+{
+    /* Keep every other key's line, then append this one */
+    char *kept = NULL;
+    size_t kept_len = 0;
+    FILE *f = fopen(path, "r");
+    if (f)
+    {
+        char line[1024];
+        size_t kl = strlen(key);
+        while (fgets(line, sizeof(line), f))
+        {
+            if (strncmp(line, key, kl) == 0 && line[kl] == '\t')
+                continue;
+            size_t ll = strlen(line);
+            kept = realloc(kept, kept_len + ll + 1);
+            memcpy(kept + kept_len, line, ll + 1);
+            kept_len += ll;
+        }
+        fclose(f);
+    }
+    f = fopen(path, "w");
+    if (!f)
+    {
+        free(kept);
+        return 0;
+    }
+    if (kept)
+        fputs(kept, f);
+    fprintf(f, "%s\t%d %d %d %d %d %.1f\n", key, c->batch_size, c->block_m, c->block_k, c->block_n, c->threads,
+            c->samples_per_s);
+    fclose(f);
+    free(kept);
+    return 1;
+}
+
+void tune_apply(const TuneConfig *c)
+{
+    config_set_gemm(c->block_m, c->block_k, c->block_n, c->threads);
+}
+
+void tune_print(const char *origin, const TuneConfig *c)
+{
+    printf("[TUNE] %s: batch=%d gemm_blocks=%dx%dx%d threads=%d", origin, c->batch_size, c->block_m, c->block_k,
+           c->block_n, c->threads);
+    if (c->samples_per_s > 0)
+        printf(" (%.0f samples/s)", c->samples_per_s);
+    printf("\n");
+}
+
+/* Training throughput of clone under c: one warm-up step, then consecutive
+   batches of x/y (wrapping) until TUNE_BENCH_S of wall time has passed */
+static double bench(Network *clone, Matrix x, Matrix y, int is_ce, const TuneConfig *c)
+{
+    SGD opt = {0.0, 0.0, 0.0, 0.0, 1e300}; // lr 0: params stay put; no act-grad clipping
+    tune_apply(c);
+    int bs = c->batch_size, n_full = x.rows / bs;
+    long samples = 0;
+    double t0 = 0.0, t = 0.0;
+    for (int step = 0;; ++step)
+    {
+        int start = (step % n_full) * bs;
+        Matrix xb = {bs, x.cols, x.data + (size_t)start * x.cols};
+        Matrix yb = {bs, y.cols, y.data + (size_t)start * y.cols};
+        train_step(clone, xb, yb, &opt, is_ce);
+        t = wall_seconds();
+        if (step == 0)
+            t0 = t; // warm-up (buffers sized, caches hot)
+        else
+            samples += bs;
+        if (step >= 3 && t - t0 >= TUNE_BENCH_S)
+            break;
+    }
+    return samples / (t - t0);
+}
+
+TuneConfig autotune(Network *net, Matrix x, Matrix y, int is_ce, const int *batches, int n_batches,
+                    const char *cache_path)
+{
+    char key[1024];
+    tune_key(net, key, sizeof(key));
+    TuneConfig best = tune_current(n_batches > 0 ? batches[0] : 32);
+    if (cache_path && tune_cache_load(cache_path, key, &best))
+    {
+        tune_apply(&best);
+        tune_print("cached", &best);
+        return best;
+    }
+
+    printf("[TUNE] benchmarking for %s\n", key);
+    Network clone = net_clone(net);
+    int max_threads = n_cores() < GEMM_MAX_THREADS ? n_cores() : GEMM_MAX_THREADS;
+    best.samples_per_s = 0.0;
+    for (int bi = 0; bi < n_batches; ++bi)
+    {
+        if (batches[bi] < 1 || batches[bi] > x.rows)
+            continue;
+        /* Coordinate search: thread count on the default blocks, then blocks */
+        TuneConfig c = {batches[bi], 64, 256, 256, 1, 0.0}, top = c;
+        for (int th = 1; th <= max_threads; th *= 2)
+        {
+            c.threads = th;
+            c.samples_per_s = bench(&clone, x, y, is_ce, &c);
+            if (c.samples_per_s > top.samples_per_s)
+                top = c;
+        }
+        c = top;
+        for (int b = 0; b < TUNE_N_BLOCKS; ++b)
+        {
+            c.block_m = tune_blocks[b][0];
+            c.block_k = tune_blocks[b][1];
+            c.block_n = tune_blocks[b][2];
+            c.samples_per_s = bench(&clone, x, y, is_ce, &c);
+            if (c.samples_per_s > top.samples_per_s)
+                top = c;
+        }
+        tune_print("candidate", &top);
+        if (top.samples_per_s > best.samples_per_s)
+            best = top;
+    }
+    free_net(&clone);
+    tune_apply(&best);
+    if (best.samples_per_s > 0 && cache_path && !tune_cache_save(cache_path, key, &best))
+        fprintf(stderr, "autotune: cannot write %s\n", cache_path);
+    tune_print("selected", &best);
+    return best;
+}
@@ -0,0 +1,44 @@
+#ifndef TUNE_H
+#define TUNE_H
+
+#include "network.h"
+
+/* Startup auto-tuner: times train_step on a clone of the network for a few
+   batch sizes, matmul block shapes and thread counts, and keeps the fastest
+   (samples/s). The choice is cached in a text file, one line per key
+   (CPU model, logical cores and layer shapes), so later runs on the same
+   machine and architecture skip the benchmark. */
+typedef struct
+{
+    int batch_size;
+    int block_m, block_k, block_n; // see GEMM_BLOCK_* in config.h
+    int threads;
+    double samples_per_s; // measured training throughput (0 if unknown)
+} TuneConfig;
+
+#define TUNE_CACHE_FILE "experiments/tune_cache.txt"
+#define TUNE_BENCH_S 0.05 // timed train_step wall time per candidate
+
+// Current config (GEMM_* globals) with the given batch size
+TuneConfig tune_current(int batch_size);
+
+// Cache key for net on this machine, e.g. "cpu=...;cores=8;net=784x256x128x10"
+void tune_key(Network *net, char *buf, size_t n);
+
+// 1 and *c filled when path has a line for key, else 0
+int tune_cache_load(const char *path, const char *key, TuneConfig *c);
+// Replace (or append) key's line; returns 0 when the file cannot be written
+int tune_cache_save(const char *path, const char *key, const TuneConfig *c);
+
+// Set the GEMM_* globals (batch_size is the caller's to use)
+void tune_apply(const TuneConfig *c);
+// One "[TUNE] ..." line naming the settings and where they came from
+void tune_print(const char *origin, const TuneConfig *c);
+
+// Cached config for net if present, else benchmark the candidate batch sizes
+// on rows of x/y (is_ce as for train_step) and cache the winner. The result is
+// applied and printed. net is not modified, but cloning it draws from the default RNG stream.
+TuneConfig autotune(Network *net, Matrix x, Matrix y, int is_ce, const int *batches, int n_batches,
+                    const char *cache_path);
+
+#endif
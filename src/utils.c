@@ -1,23 +1,48 @@
+#define _POSIX_C_SOURCE 200809L
 #include "utils.h"
+#include "config.h"
+#include "rng.h"
+#include "bench.h"
+#include <pthread.h>
 #include <stdarg.h>
+#include <errno.h>
 #include <string.h> // For memcpy
 #include <math.h>   // For sqrt, exp, fmax, fmin
+#ifdef _WIN32
+#include <windows.h>
+#endif
 
-Matrix alloc_matrix(int r, int c)
+Matrix alloc_matrix_tag(int r, int c, MemTag tag)
 {
-    Matrix m = {r, c, malloc(r * c * sizeof(mat_t))};
-    if (!m.data)
-    {
-        fprintf(stderr, "Alloc fail\n");
-        exit(1);
-    }
+    Matrix m = {r, c, mem_alloc((size_t)r * c * sizeof(mat_t), tag)};
     return m;
 }
 
+Matrix alloc_matrix(int r, int c)
+{
+    return alloc_matrix_tag(r, c, MEM_TEMP);
+}
+
 void free_matrix(Matrix m)
 {
-    if (m.data)
-        free(m.data);
+    mem_free(m.data);
+}
+
+void *alloc_aligned(size_t bytes, size_t align, MemTag tag)
+{
+    /* Over-allocate and stash the raw pointer just before the aligned block
+       (C99 has no aligned_alloc and MinGW lacks posix_memalign). */
+    void *raw = mem_calloc(1, bytes + align + sizeof(void *), tag);
+    size_t addr = (size_t)raw + sizeof(void *);
+    addr = (addr + align - 1) & ~(align - 1);
+    ((void **)addr)[-1] = raw;
+    return (void *)addr;
+}
+
+void free_aligned(void *p)
+{
+    if (p)
+        mem_free(((void **)p)[-1]);
 }
 
 void copy_matrix(Matrix dst, Matrix src)
@@ -35,23 +60,92 @@ void copy_matrix(Matrix dst, Matrix src)
     memcpy(dst.data, src.data, (size_t)rows_to_copy * src.cols * sizeof(mat_t));
 }
 
-void matmul(Matrix a, Matrix b, Matrix out)
+/* Rows [r0, r1) of out = a @ b, cache-blocked per config (GEMM_BLOCK_*).
+   i-k-j order keeps a row of b streaming through the inner loop while each
+   out[i][j] still accumulates its k products in ascending k, exactly as the
+   unblocked triple loop does. */
+static void gemm_rows(Matrix a, Matrix b, Matrix out, int r0, int r1)
 {
-    if (a.cols != b.rows || a.rows != out.rows || b.cols != out.cols)
-        return;
-    for (int i = 0; i < out.rows; ++i)
+    int K = a.cols, N = b.cols;
+    int bm = GEMM_BLOCK_M > 0 ? GEMM_BLOCK_M : r1 - r0;
+    int bk = GEMM_BLOCK_K > 0 ? GEMM_BLOCK_K : K;
+    int bn = GEMM_BLOCK_N > 0 ? GEMM_BLOCK_N : N;
+    memset(out.data + (size_t)r0 * N, 0, (size_t)(r1 - r0) * N * sizeof(mat_t));
+    for (int i0 = r0; i0 < r1; i0 += bm)
     {
-        for (int j = 0; j < out.cols; ++j)
+        int i1 = i0 + bm < r1 ? i0 + bm : r1;
+        for (int k0 = 0; k0 < K; k0 += bk)
         {
-            out.data[i * out.cols + j] = 0;
-            for (int k = 0; k < a.cols; ++k)
+            int k1 = k0 + bk < K ? k0 + bk : K;
+            for (int j0 = 0; j0 < N; j0 += bn)
             {
-                out.data[i * out.cols + j] += a.data[i * a.cols + k] * b.data[k * b.cols + j];
+                int j1 = j0 + bn < N ? j0 + bn : N;
+                for (int i = i0; i < i1; ++i)
+                {
+                    mat_t *o = out.data + (size_t)i * N;
+                    const mat_t *ai = a.data + (size_t)i * K;
+                    for (int k = k0; k < k1; ++k)
+                    {
+                        mat_t aik = ai[k];
+                        const mat_t *bk_row = b.data + (size_t)k * N;
+                        for (int j = j0; j < j1; ++j)
+                            o[j] += aik * bk_row[j];
+                    }
+                }
             }
         }
     }
 }
 
+typedef struct
+{
+    Matrix a, b, out;
+    int r0, r1;
+} GemmTask;
+
+static void *gemm_worker(void *arg)
+{
+    GemmTask *t = arg;
+    gemm_rows(t->a, t->b, t->out, t->r0, t->r1);
+    return NULL;
+}
+
+void matmul(Matrix a, Matrix b, Matrix out)
+{
+    if (a.cols != b.rows || a.rows != out.rows || b.cols != out.cols)
+        return;
+    /* Threads split the rows of out; small products stay on the caller */
+    int nt = GEMM_THREADS;
+    if ((double)out.rows * out.cols * a.cols < GEMM_PAR_MIN_FLOPS)
+        nt = 1;
+    if (nt > out.rows)
+        nt = out.rows;
+    if (nt > GEMM_MAX_THREADS)
+        nt = GEMM_MAX_THREADS;
+    if (nt <= 1)
+    {
+        gemm_rows(a, b, out, 0, out.rows);
+        return;
+    }
+    GemmTask tasks[GEMM_MAX_THREADS];
+    pthread_t th[GEMM_MAX_THREADS];
+    int started[GEMM_MAX_THREADS] = {0};
+    for (int t = 0; t < nt; ++t)
+    {
+        tasks[t] = (GemmTask){a, b, out, (int)((long)out.rows * t / nt), (int)((long)out.rows * (t + 1) / nt)};
+        if (t > 0)
+            started[t] = pthread_create(&th[t], NULL, gemm_worker, &tasks[t]) == 0;
+    }
+    gemm_rows(a, b, out, tasks[0].r0, tasks[0].r1);
+    for (int t = 1; t < nt; ++t)
+    {
+        if (started[t])
+            pthread_join(th[t], NULL);
+        else
+            gemm_rows(a, b, out, tasks[t].r0, tasks[t].r1); // could not spawn: do it here
+    }
+}
+
 void mat_add_bias(Matrix x, Matrix b)
 {
     if (x.cols != b.cols || b.rows != 1) // Enforce 1 x d
@@ -119,18 +213,179 @@ void mat_clip_grad(Matrix m, mat_t max_norm)
 void mat_rand_xavier(Matrix m, int fan_in)
 {
     mat_t bound = sqrt(6.0 / fan_in);
+    size_t n = (size_t)m.rows * m.cols;
+    Rng r = rng_global_take(n);
+    rng_fill_uniform(&r, m.data, n, -bound, bound);
+}
+
+void mat_rand_uniform(Matrix m, mat_t low, mat_t high)
+{
+    size_t n = (size_t)m.rows * m.cols;
+    Rng r = rng_global_take(n);
+    rng_fill_uniform(&r, m.data, n, low, high);
+}
+
+int mat_count_nonzero(Matrix m)
+{
+    int nnz = 0;
     for (int i = 0; i < m.rows * m.cols; ++i)
+        nnz += m.data[i] != 0.0;
+    return nnz;
+}
+
+void sparse_from_dense(SparseMatrix *s, Matrix m)
+{
+    int nnz = mat_count_nonzero(m);
+    if (!s->row_ptr || s->rows < m.rows)
+    {
+        mem_free(s->row_ptr);
+        s->row_ptr = mem_alloc((m.rows + 1) * sizeof(int), MEM_CACHE);
+    }
+    if (nnz > s->cap)
+    {
+        mem_free(s->col_idx);
+        mem_free(s->vals);
+        s->cap = nnz;
+        s->col_idx = mem_alloc(nnz * sizeof(int), MEM_CACHE);
+        s->vals = mem_alloc(nnz * sizeof(mat_t), MEM_CACHE);
+    }
+    if (!s->row_ptr || (nnz && (!s->col_idx || !s->vals)))
+    {
+        fprintf(stderr, "Alloc fail\n");
+        exit(1);
+    }
+    s->rows = m.rows;
+    s->cols = m.cols;
+    s->nnz = nnz;
+    int k = 0;
+    for (int i = 0; i < m.rows; ++i)
+    {
+        s->row_ptr[i] = k;
+        const mat_t *row = m.data + (size_t)i * m.cols;
+        for (int j = 0; j < m.cols; ++j)
+        {
+            if (row[j] != 0.0)
+            {
+                s->col_idx[k] = j;
+                s->vals[k++] = row[j];
+            }
+        }
+    }
+    s->row_ptr[m.rows] = k;
+}
+
+void free_sparse(SparseMatrix *s)
+{
+    mem_free(s->row_ptr);
+    mem_free(s->col_idx);
+    mem_free(s->vals);
+    s->row_ptr = s->col_idx = NULL;
+    s->vals = NULL;
+    s->rows = s->cols = s->nnz = s->cap = 0;
+}
+
+void spmm(SparseMatrix a, Matrix b, Matrix out)
+{
+    if (a.cols != b.rows || a.rows != out.rows || b.cols != out.cols)
+        return;
+    int n = out.cols;
+    for (int i = 0; i < a.rows; ++i)
     {
-        m.data[i] = (mat_t)rand() / RAND_MAX * 2 * bound - bound;
+        mat_t *o = out.data + (size_t)i * n;
+        for (int j = 0; j < n; ++j)
+            o[j] = 0;
+        for (int p = a.row_ptr[i]; p < a.row_ptr[i + 1]; ++p)
+        {
+            mat_t v = a.vals[p];
+            const mat_t *brow = b.data + (size_t)a.col_idx[p] * n;
+            for (int j = 0; j < n; ++j)
+                o[j] += v * brow[j];
+        }
     }
 }
 
-void mat_rand_uniform(Matrix m, mat_t low, mat_t high)
+void spmm_tn_accum(SparseMatrix a, Matrix b, Matrix out, mat_t scale)
 {
-    mat_t range = high - low;
-    for (int i = 0; i < m.rows * m.cols; ++i)
+    // a (rows x K) sparse, b (rows x n) -> out (K x n): scatter each non-zero's row of b
+    if (a.rows != b.rows || a.cols != out.rows || b.cols != out.cols)
+        return;
+    int n = out.cols;
+    for (int i = 0; i < a.rows; ++i)
+    {
+        const mat_t *brow = b.data + (size_t)i * n;
+        for (int p = a.row_ptr[i]; p < a.row_ptr[i + 1]; ++p)
+        {
+            mat_t v = scale * a.vals[p];
+            mat_t *o = out.data + (size_t)a.col_idx[p] * n;
+            for (int j = 0; j < n; ++j)
+                o[j] += v * brow[j];
+        }
+    }
+}
+
+void dense_spmm(Matrix a, SparseMatrix b, Matrix out)
+{
+    // a (rows x K) dense, b (K x n) sparse: each a[i][k] scales row k's non-zeros
+    if (a.cols != b.rows || a.rows != out.rows || b.cols != out.cols)
+        return;
+    int n = out.cols;
+    for (int i = 0; i < a.rows; ++i)
+    {
+        mat_t *o = out.data + (size_t)i * n;
+        const mat_t *ai = a.data + (size_t)i * a.cols;
+        for (int j = 0; j < n; ++j)
+            o[j] = 0;
+        for (int k = 0; k < a.cols; ++k)
+        {
+            mat_t v = ai[k];
+            for (int p = b.row_ptr[k]; p < b.row_ptr[k + 1]; ++p)
+                o[b.col_idx[p]] += v * b.vals[p];
+        }
+    }
+}
+
+void dense_spmm_t(Matrix a, SparseMatrix b, Matrix out)
+{
+    // a (rows x n) dense, b (K x n) sparse -> out (rows x K): sparse dot per (i, k)
+    if (a.cols != b.cols || a.rows != out.rows || b.rows != out.cols)
+        return;
+    int K = out.cols;
+    for (int i = 0; i < a.rows; ++i)
+    {
+        const mat_t *ai = a.data + (size_t)i * a.cols;
+        mat_t *o = out.data + (size_t)i * K;
+        for (int k = 0; k < K; ++k)
+        {
+            mat_t sum = 0;
+            for (int p = b.row_ptr[k]; p < b.row_ptr[k + 1]; ++p)
+                sum += ai[b.col_idx[p]] * b.vals[p];
+            o[k] = sum;
+        }
+    }
+}
+
+void bf16_pack(const mat_t *src, uint16_t *dst, size_t n)
+{
+    for (size_t i = 0; i < n; ++i)
+    {
+        float f = (float)src[i];
+        uint32_t u;
+        memcpy(&u, &f, sizeof(u));
+        if ((u & 0x7fffffffu) > 0x7f800000u)
+            dst[i] = (uint16_t)((u >> 16) | 0x40); // keep NaN a (quiet) NaN
+        else
+            dst[i] = (uint16_t)((u + 0x7fffu + ((u >> 16) & 1u)) >> 16);
+    }
+}
+
+void bf16_unpack(const uint16_t *src, mat_t *dst, size_t n)
+{
+    for (size_t i = 0; i < n; ++i)
     {
-        m.data[i] = low + (mat_t)rand() / RAND_MAX * range;
+        uint32_t u = (uint32_t)src[i] << 16;
+        float f;
+        memcpy(&f, &u, sizeof(f));
+        dst[i] = f;
     }
 }
 
@@ -154,6 +409,11 @@ void log_csv(const char *fname, int epoch, mat_t loss, mat_t acc, int n_params,
         return;
     }
     fprintf(f, "%d,%.6f,%.6f", epoch, loss, acc);
+    if (BENCH_LOG)
+    {
+        BenchEpoch b = bench_last();
+        bench_csv_fields(f, &b);
+    }
     if (n_params > 0 && params)
     {
         for (int i = 0; i < n_params; ++i)
@@ -165,7 +425,8 @@ void log_csv(const char *fname, int epoch, mat_t loss, mat_t acc, int n_params,
 
 void srand_seed(unsigned int seed)
 {
-    srand(seed);
+    rng_seed(seed);
+    srand(seed); // test harnesses still pick shapes with rand()
 }
 
 void log_csv_header(const char *fname, int n_params, const char **names)
@@ -176,7 +437,7 @@ void log_csv_header(const char *fname, int n_params, const char **names)
         fprintf(stderr, "Failed to open %s for header: %s\n", fname, strerror(errno));
         return;
     }
-    fprintf(f, "epoch,loss,acc");
+    fprintf(f, "epoch,loss,acc%s", BENCH_LOG ? BENCH_CSV_HEADER : "");
     if (n_params > 0 && names)
     {
         for (int i = 0; i < n_params; ++i)
@@ -184,4 +445,41 @@ void log_csv_header(const char *fname, int n_params, const char **names)
     }
     fprintf(f, "\n");
     fclose(f);
-}
\ No newline at end of file
+}
+static int cmp_double(const void *a, const void *b)
+{
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+double percentile(double *v, int n, double q)
+{
+    if (n <= 0)
+        return 0.0;
+    qsort(v, n, sizeof(double), cmp_double);
+    int k = (int)ceil(q * n) - 1;
+    if (k < 0)
+        k = 0;
+    if (k >= n)
+        k = n - 1;
+    return v[k];
+}
+
+double wall_seconds(void)
+{
+#ifdef _WIN32
+    LARGE_INTEGER f, t;
+    QueryPerformanceFrequency(&f);
+    QueryPerformanceCounter(&t);
+    return (double)t.QuadPart / (double)f.QuadPart;
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+#endif
+}
+
+double cpu_seconds(void)
+{
+    return (double)clock() / CLOCKS_PER_SEC;
+}
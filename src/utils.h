@@ -5,6 +5,8 @@
 #include <stdlib.h>
 #include <math.h>
 #include <time.h>
+#include <stdint.h>
+#include "mem.h"
 
 typedef double mat_t;
 typedef struct
@@ -12,10 +14,25 @@ typedef struct
     int rows, cols;
     mat_t *data;
 } Matrix;
+// Compressed sparse row batch (e.g. mostly-zero MNIST pixels); buffers grow on demand
+typedef struct
+{
+    int rows, cols, nnz, cap;
+    int *row_ptr, *col_idx;
+    mat_t *vals;
+} SparseMatrix;
+// Accounted under MEM_TEMP; alloc_matrix_tag names the subsystem (mem.h)
 Matrix alloc_matrix(int r, int c);
+Matrix alloc_matrix_tag(int r, int c, MemTag tag);
 void free_matrix(Matrix m);
+// Aligned, zeroed allocation (used for contiguous parameter slabs); release with free_aligned
+void *alloc_aligned(size_t bytes, size_t align, MemTag tag);
+void free_aligned(void *p);
 void copy_matrix(Matrix dst, Matrix src);
+// out = a @ b; blocked and optionally threaded per GEMM_* in config.h
 void matmul(Matrix a, Matrix b, Matrix out);
+#define GEMM_MAX_THREADS 64
+#define GEMM_PAR_MIN_FLOPS 65536.0 // m*k*n below this runs single-threaded
 void mat_add_bias(Matrix x, Matrix b);
 void mat_scale(Matrix m, mat_t s);
 void mat_transpose(Matrix a, Matrix out);
@@ -25,12 +42,30 @@ mat_t mat_l2_norm(Matrix m);
 void mat_clip_grad(Matrix m, mat_t max_norm);
 void mat_rand_xavier(Matrix m, int fan_in);
 void mat_rand_uniform(Matrix m, mat_t low, mat_t high);
+int mat_count_nonzero(Matrix m);
+void sparse_from_dense(SparseMatrix *s, Matrix m); // (re)fill s from m
+void free_sparse(SparseMatrix *s);
+void spmm(SparseMatrix a, Matrix b, Matrix out);                     // out = a @ b (only rows of b at a's non-zeros)
+void spmm_tn_accum(SparseMatrix a, Matrix b, Matrix out, mat_t scale); // out += scale * a^T @ b
+// Dense x sparse (b in CSR, e.g. a pruned W); same summation order as matmul minus the zero terms
+void dense_spmm(Matrix a, SparseMatrix b, Matrix out);   // out = a @ b
+void dense_spmm_t(Matrix a, SparseMatrix b, Matrix out); // out = a @ b^T
+// bfloat16 storage (8-bit mantissa, round to nearest even); compute stays in mat_t
+void bf16_pack(const mat_t *src, uint16_t *dst, size_t n);
+void bf16_unpack(const uint16_t *src, mat_t *dst, size_t n);
 mat_t sigmoid(mat_t x);
 mat_t sigmoid_deriv(mat_t x);
 // Write CSV row with optional activation parameters.
 // params: pointer to array of mat_t of length n_params (may be NULL if n_params==0)
+// With BENCH_LOG the timings of the last closed bench epoch follow acc (bench.h).
 void log_csv(const char *fname, int epoch, mat_t loss, mat_t acc, int n_params, mat_t *params);
 // Write CSV header with human-readable parameter names (names array of length n_params)
 void log_csv_header(const char *fname, int n_params, const char **names);
 void srand_seed(unsigned int seed);
+// q-quantile (0..1, nearest rank) of v[0..n); sorts v in place
+double percentile(double *v, int n, double q);
+// Monotonic wall clock in seconds (for throughput reports)
+double wall_seconds(void);
+// Process CPU time in seconds (all threads)
+double cpu_seconds(void);
 #endif
\ No newline at end of file
@@ -1,15 +1,17 @@
 import numpy as np
 import matplotlib.pyplot as plt
 import pandas as pd
+import re
 
 # Assume CSV has cols for params, e.g., param0,param1,... per epoch
 def plot_act_evol(csv_file, act_type):
     df = pd.read_csv(csv_file)
-    # param columns are assumed to be the columns after 'acc'
+    # param columns are named l{layer}_{act}_p{idx} (other columns such as
+    # test_acc may sit between 'acc' and the params)
     cols = list(df.columns)
     if 'epoch' not in cols or 'loss' not in cols or 'acc' not in cols:
         raise ValueError('CSV must contain epoch,loss,acc columns')
-    param_cols = cols[3:]
+    param_cols = [c for c in cols if re.search(r'_p\d+$', c)]
     z = np.linspace(-5, 5, 200)
     fig, ax = plt.subplots()
     sample_epochs = [df['epoch'].iloc[0]]
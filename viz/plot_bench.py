@@ -0,0 +1,67 @@
+from pathlib import Path
+import pandas as pd
+import seaborn as sns
+import matplotlib.pyplot as plt
+
+# Benchmark-mode plots (scripts/run_ablation.py --bench). Reads
+# experiments/ablations.csv, which then carries train_s, samples_per_s,
+# target_acc, time_to_target_s and acc_per_s per configuration, and the
+# per-run logs it points to (elapsed_s column) for accuracy-vs-time curves.
+ROOT = Path(__file__).resolve().parents[1]
+ABL = ROOT / 'experiments' / 'ablations.csv'
+OUT = ROOT / 'viz' / 'results'
+OUT.mkdir(parents=True, exist_ok=True)
+
+if not ABL.exists():
+	print(f"Ablations CSV not found at {ABL}; skipping plot_bench")
+	raise SystemExit(0)
+
+df = pd.read_csv(ABL)
+if 'train_s' not in df.columns:
+	print('ablations.csv has no benchmark columns (run scripts/run_ablation.py --bench); skipping plot_bench')
+	raise SystemExit(0)
+
+
+def read_log(path):
+	p = Path(path)
+	if not p.is_absolute():
+		p = ROOT / p
+	if not p.exists():
+		return None
+	log = pd.read_csv(p)
+	if 'elapsed_s' not in log.columns:
+		return None
+	acc = log['test_acc'] if 'test_acc' in log.columns and log['test_acc'].notna().any() else log['acc']
+	return log['elapsed_s'], acc
+
+
+for ds in df['dataset'].unique():
+	sub = df[df['dataset'] == ds].copy()
+	# Best init per activation: fastest to target, else highest accuracy per second
+	sub['ttt'] = sub['time_to_target_s'].fillna(float('inf'))
+	best = sub.sort_values(['ttt', 'acc_per_s'], ascending=[True, False]).groupby('act_hidden').head(1)
+	target = best['target_acc'].iloc[0]
+
+	fig, axes = plt.subplots(1, 2, figsize=(12, 4))
+	bars = best.sort_values('ttt')
+	reached = bars[bars['ttt'] != float('inf')]
+	sns.barplot(x='act_hidden', y='time_to_target_s', data=reached, ax=axes[0])
+	axes[0].set_title(f'{ds} — training seconds to acc >= {target} (best init)')
+	axes[0].set_ylabel('seconds')
+	axes[0].tick_params(axis='x', rotation=45)
+	for _, row in best.iterrows():
+		curve = read_log(row['logfile'])
+		if curve is not None:
+			axes[1].plot(curve[0], curve[1], label=f"{row['act_hidden']} ({row['act_init']})")
+	axes[1].axhline(target, color='gray', linestyle='--', linewidth=1)
+	axes[1].set_xlabel('training seconds')
+	axes[1].set_ylabel('accuracy')
+	axes[1].set_title(f'{ds} — accuracy vs training time')
+	axes[1].legend(fontsize=7)
+	out = OUT / f'{ds}_bench.png'
+	plt.tight_layout()
+	plt.savefig(out)
+	plt.close()
+	print('Wrote', out)
+
+print('plot_bench: done')
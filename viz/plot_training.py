@@ -9,6 +9,8 @@ if __name__ == "__main__":
     plt.figure()
     plt.plot(df["epoch"], df["loss"], label="Loss")
     plt.plot(df["epoch"], df["acc"], label="Acc")
+    if "test_acc" in df.columns:  # written by the async evaluator (main_mnist.c)
+        plt.plot(df["epoch"], df["test_acc"], label="Test acc")
     plt.xlabel("Epoch")
     plt.ylabel("Value")
     plt.legend()
@@ -11,6 +11,7 @@ It calls the following scripts (if present):
   - plot_training.py
   - plot_acts.py (skipped unless provided with CSV+act args)
   - plot_ablation.py
+  - plot_bench.py (skips itself unless ablations.csv has --bench columns)
 
 Notes:
 - Requires Python and the plotting dependencies used by the individual scripts
@@ -29,7 +30,8 @@ SAFE_SCRIPTS = [
     'viz/make_plots.py',
     'viz/plot_best_by_init.py',
     'viz/plot_detailed_by_dataset.py',
-    'viz/plot_ablation.py'
+    'viz/plot_ablation.py',
+    'viz/plot_bench.py'
 ]
 
 # Scripts that are present but need arguments or a different ablations schema.